@@ -0,0 +1,97 @@
+// Loopback round-trip benchmark of the Modbus TCP client backends.
+//
+//   bench_tcp_client [requests] [registers] [window] [latency_ms]
+//
+// Starts an in-process server on 127.0.0.1 and issues sequential FC3 reads
+// through the built-in client and, when the library was built with
+// WITH_LIBMODBUS, through the libmodbus client. With a window > 1 the
+// built-in client also runs pipelined batches of that many reads.
+// `latency_ms` delays every server reply to model a slow link.
+
+#include "TcpModbusClient.hpp"
+#include "../tests/support/loopback_modbus_server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static void run(const char* name, wiq::IModbusClient* c, int requests, int regs, int window) {
+  if (!c) {
+    std::printf("%-10s  (not built)\n", name);
+    return;
+  }
+  c->set_timeout_ms(1000);
+  if (c->connect() != 0) {
+    std::printf("%-10s  connect failed\n", name);
+    return;
+  }
+  std::vector<std::uint16_t> buf(static_cast<std::size_t>(regs));
+  std::vector<double> lat;
+  lat.reserve(static_cast<std::size_t>(requests));
+  int errors = 0;
+  for (int i = 0; i < 10; ++i) (void)c->read_holding_regs(1, 0, regs, buf.data());  // warm-up
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<wiq::ReadRequest> batch(static_cast<std::size_t>(window));
+  for (int i = 0; i < requests; i += window) {
+    const int n = std::min(window, requests - i);
+    for (int k = 0; k < n; ++k) {
+      batch[k] = wiq::ReadRequest{};
+      batch[k].function = 3; batch[k].unit = 1; batch[k].count = regs; batch[k].regs = buf.data();
+    }
+    auto a = std::chrono::steady_clock::now();
+    if (window == 1) {
+      if (c->read_holding_regs(1, 0, regs, buf.data()) != 0) ++errors;
+    } else {
+      c->read_batch(batch.data(), n);
+      for (int k = 0; k < n; ++k) if (batch[k].rc != 0) ++errors;
+    }
+    auto b = std::chrono::steady_clock::now();
+    // Every read of a batch completes within the batch's round trip.
+    for (int k = 0; k < n; ++k) lat.push_back(std::chrono::duration<double, std::micro>(b - a).count());
+  }
+  double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::sort(lat.begin(), lat.end());
+  double mean = 0;
+  for (double v : lat) mean += v;
+  mean /= lat.size();
+  std::printf("%-10s  %8.0f req/s  mean %7.1f us  p50 %7.1f us  p99 %7.1f us  errors %d\n",
+              name, requests / total, mean, lat[lat.size() / 2], lat[lat.size() * 99 / 100], errors);
+  c->close();
+}
+
+int main(int argc, char** argv) {
+  int requests = argc > 1 ? std::atoi(argv[1]) : 20000;
+  int regs = argc > 2 ? std::atoi(argv[2]) : 10;
+  if (requests < 1) requests = 1;
+  int window = argc > 3 ? std::atoi(argv[3]) : 8;
+  int latency = argc > 4 ? std::atoi(argv[4]) : 0;
+  if (regs < 1 || regs > 125) regs = 10;
+  if (window < 1 || window > 16) window = 8;
+  if (latency < 0) latency = 0;
+
+  std::printf("%d FC3 reads of %d register(s) over loopback, %d ms added latency\n", requests, regs, latency);
+  {
+    LoopbackModbusServer server;
+    server.set_latency(latency);
+    auto native = wiq::make_tcp_client("127.0.0.1", server.port());
+    run("native", native.get(), requests, regs, 1);
+  }
+  if (window > 1) {
+    LoopbackModbusServer server;
+    server.set_latency(latency);
+    auto native = wiq::make_tcp_client("127.0.0.1", server.port());
+    native->set_pipeline_window(window);
+    std::string name = "native/w" + std::to_string(window);
+    run(name.c_str(), native.get(), requests, regs, window);
+  }
+  {
+    LoopbackModbusServer server;
+    server.set_latency(latency);
+    auto lib = wiq::make_libmodbus_tcp_client("127.0.0.1", server.port());
+    run("libmodbus", lib.get(), requests, regs, 1);
+  }
+  return 0;
+}
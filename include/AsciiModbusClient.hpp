@@ -17,11 +17,10 @@ struct AsciiConfig {
   int frame_silence_ms{5};
 };
 
-std::unique_ptr<IModbusClient> make_ascii_client(const AsciiConfig& cfg,
-                                                 int coils_size = 200,
-                                                 int discrete_inputs_size = 200,
-                                                 int holding_regs_size = 200,
-                                                 int input_regs_size = 200);
+// Built-in Modbus ASCII client on a termios serial line (POSIX): ':'...CRLF
+// frames, streamed hex decoding and LRC validation (unless `lrc_check` is
+// off). `frame_silence_ms` is kept between frames.
+WIQ_IOH_API std::unique_ptr<IModbusClient> make_ascii_client(const AsciiConfig& cfg);
 
 } // namespace wiq
 
@@ -20,6 +20,18 @@ enum class ModbusErr : int {
   LRC_ERROR      = -9,
 };
 
+// One read of a batch submitted through IModbusClient::read_batch. `bits`
+// receives FC1/FC2 results, `regs` FC3/FC4 results; `rc` is filled in.
+struct ReadRequest {
+  int function{};
+  int unit{};
+  int addr{};
+  int count{};
+  std::uint8_t* bits{nullptr};
+  std::uint16_t* regs{nullptr};
+  int rc{0};
+};
+
 class IModbusClient {
 public:
   virtual ~IModbusClient() {}
@@ -41,8 +53,24 @@ public:
   virtual int write_multiple_coils(int unit, int addr, int count, const std::uint8_t* v) = 0; // FC15
   virtual int write_multiple_regs(int unit, int addr, int count, const std::uint16_t* v) = 0; // FC16
 
+  // Issue several reads. Transports able to keep requests in flight (TCP with
+  // a pipeline window > 1) overlap them; the default runs them in order.
+  virtual void read_batch(ReadRequest* reqs, int n) {
+    for (int i = 0; i < n; ++i) {
+      ReadRequest& r = reqs[i];
+      switch (r.function) {
+        case 1: r.rc = read_coils(r.unit, r.addr, r.count, r.bits); break;
+        case 2: r.rc = read_discrete_inputs(r.unit, r.addr, r.count, r.bits); break;
+        case 3: r.rc = read_holding_regs(r.unit, r.addr, r.count, r.regs); break;
+        case 4: r.rc = read_input_regs(r.unit, r.addr, r.count, r.regs); break;
+        default: r.rc = static_cast<int>(ModbusErr::UNSUPPORTED); break;
+      }
+    }
+  }
+
   // optional hooks for transports requiring frame timing/diagnostics
   virtual void set_frame_silence_ms(int /*ms*/) {}
+  virtual void set_pipeline_window(int /*requests*/) {}
   virtual int read_diagnostics(int /*unit*/, int /*addr*/, std::uint16_t* /*out*/, int /*count*/) {
     return static_cast<int>(ModbusErr::UNSUPPORTED);
   }
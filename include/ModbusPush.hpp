@@ -0,0 +1,27 @@
+#pragma once
+
+#include "export.hpp"
+
+// Change-only push of polled item values to the host.
+//
+// After every poll tick each device's engine compares the raw data of each
+// polled item with the value it last delivered and hands all changed items
+// to the registered callback in one call. Values use the same JSON text as ReadItem;
+// a failed read is delivered once as its `{"error":{...}}` object.
+
+extern "C" {
+
+struct wiq_item_value {
+  const char* item;        // item name from the configuration
+  const char* value_json;  // valid only for the duration of the callback
+};
+
+// Invoked on the poll thread; must not call SetReadCallback itself.
+typedef void (*wiq_read_batch_callback)(const wiq_item_value* values, int count, void* user);
+
+// Register (or clear with cb=nullptr) the batch callback of an instance. The
+// first tick after registering delivers every polled item that has a value.
+// Once the call returns, the previous callback is no longer running.
+WIQ_IOH_API int SetReadCallback(void* h, wiq_read_batch_callback cb, void* user);
+
+}
@@ -0,0 +1,209 @@
+/*
+ * Reader side of the shared-memory process image (`shared_memory` in the
+ * configuration). Plain C; include it in any local process that wants the
+ * polled values without opening its own Modbus connection.
+ *
+ * The handler creates the object, writes the layout once and then keeps the
+ * segments current from its poll engines. Each segment holds one configured
+ * address range of one device, unit and function, one uint16_t slot per
+ * register or bit, and is published under a seqlock: `seq` is odd while the
+ * handler writes it. wiq_shm_read_segment() copies a segment consistently;
+ * readers never block the handler.
+ *
+ *   wiq_shm_view v;
+ *   if (wiq_shm_open("/ioh_modbus", &v) == 0) {
+ *     const wiq_shm_item* it = wiq_shm_find_item(&v, "tank.level");
+ *     uint16_t regs[4];
+ *     uint64_t gen, ns;
+ *     if (it && wiq_shm_read_segment(&v, it->segment, regs, 4, &gen, &ns) > 0) ...
+ *     wiq_shm_close(&v);
+ *   }
+ *
+ * Readers must check `alive`: it drops to 0 when the handler instance is
+ * destroyed, after which the object name is unlinked and the data no longer
+ * changes. A newer handler may then create the name again with a new layout.
+ * A handler that dies while writing leaves its segment odd for good, so
+ * wiq_shm_read_segment() gives up with WIQ_SHM_EDEAD or WIQ_SHM_EBUSY
+ * instead of spinning on it.
+ */
+#ifndef WIQ_MODBUS_SHM_H
+#define WIQ_MODBUS_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+# include <errno.h>
+# include <fcntl.h>
+# include <sched.h>
+# include <signal.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIQ_SHM_MAGIC   0x4D515749u /* "WIQM" */
+#define WIQ_SHM_VERSION 1u
+
+/* wiq_shm_read_segment() errors. */
+#define WIQ_SHM_EINVAL (-1) /* bad segment index or too small buffer */
+#define WIQ_SHM_EDEAD  (-2) /* segment mid-update and its writer is gone */
+#define WIQ_SHM_EBUSY  (-3) /* segment still mid-update after WIQ_SHM_READ_RETRIES */
+
+/* Attempts at a consistent copy; a live writer needs a few microseconds. */
+#define WIQ_SHM_READ_RETRIES 10000u
+
+/* At offset 0 of the object. Offsets are in bytes from the start. */
+typedef struct wiq_shm_header {
+  uint32_t magic;           /* WIQ_SHM_MAGIC */
+  uint32_t version;         /* WIQ_SHM_VERSION; readers reject others */
+  uint32_t header_size;     /* sizeof(wiq_shm_header) */
+  uint32_t segment_size;    /* sizeof(wiq_shm_segment) */
+  uint32_t item_size;       /* sizeof(wiq_shm_item) */
+  uint32_t segment_count;
+  uint32_t item_count;
+  uint32_t writer_pid;
+  uint32_t alive;           /* 1 while the handler instance exists */
+  uint32_t reserved;
+  uint64_t total_size;
+  uint64_t segments_offset; /* wiq_shm_segment[segment_count] */
+  uint64_t items_offset;    /* wiq_shm_item[item_count], sorted by name */
+  uint64_t data_offset;     /* uint16_t slots of all segments */
+} wiq_shm_header;
+
+typedef struct wiq_shm_segment {
+  uint32_t seq;           /* seqlock; odd while being written */
+  uint16_t device;        /* index in the configuration's devices */
+  uint8_t unit_id;
+  uint8_t function;       /* 1-4; FC1/FC2 slots hold 0 or 1 */
+  uint32_t address;
+  uint32_t count;         /* registers or bits */
+  uint32_t data;          /* index of the first slot in the data area */
+  uint32_t reserved;
+  uint64_t generation;    /* block reads published by the device; 0: never polled */
+  uint64_t monotonic_ns;  /* CLOCK_MONOTONIC time of the read */
+} wiq_shm_segment;
+
+/* A configured readable item and the segment holding its raw data. The
+ * decoding fields mirror the item configuration. */
+typedef struct wiq_shm_item {
+  char name[64];
+  char type[16];          /* bool|int16|uint16|int32|uint32|float|double */
+  char word_order[8];     /* for double: ABCD|BADC|CDAB|DCBA */
+  uint32_t segment;
+  uint16_t device;
+  uint8_t swap_words;     /* for 32-bit types */
+  uint8_t reserved;
+  double scale;
+  double offset;
+} wiq_shm_item;
+
+typedef struct wiq_shm_view {
+  const wiq_shm_header* header;
+  size_t size;
+} wiq_shm_view;
+
+static inline const wiq_shm_segment* wiq_shm_segments(const wiq_shm_view* v) {
+  return (const wiq_shm_segment*)((const char*)v->header + v->header->segments_offset);
+}
+
+static inline const wiq_shm_item* wiq_shm_items(const wiq_shm_view* v) {
+  return (const wiq_shm_item*)((const char*)v->header + v->header->items_offset);
+}
+
+static inline const wiq_shm_item* wiq_shm_find_item(const wiq_shm_view* v, const char* name) {
+  const wiq_shm_item* items = wiq_shm_items(v);
+  uint32_t lo = 0, hi = v->header->item_count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    int c = strncmp(items[mid].name, name, sizeof(items[mid].name));
+    if (c == 0) return &items[mid];
+    if (c < 0) lo = mid + 1; else hi = mid;
+  }
+  return NULL;
+}
+
+#if !defined(_WIN32)
+
+static inline int wiq_shm_alive(const wiq_shm_view* v) {
+  return __atomic_load_n(&v->header->alive, __ATOMIC_ACQUIRE) != 0;
+}
+
+/* Whether the handler that created the object still exists: `alive` is set
+ * and its process is running. */
+static inline int wiq_shm_writer_alive(const wiq_shm_view* v) {
+  if (!wiq_shm_alive(v)) return 0;
+  pid_t pid = (pid_t)__atomic_load_n(&v->header->writer_pid, __ATOMIC_RELAXED);
+  return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/* Copy segment `index` into `out` (at most `max` slots). Returns the number
+ * of slots copied, 0 if the segment was never polled, or a WIQ_SHM_E* error.
+ * `generation`/`monotonic_ns` may be NULL. */
+static inline int wiq_shm_read_segment(const wiq_shm_view* v, uint32_t index, uint16_t* out, uint32_t max,
+                                       uint64_t* generation, uint64_t* monotonic_ns) {
+  if (index >= v->header->segment_count) return WIQ_SHM_EINVAL;
+  const wiq_shm_segment* s = &wiq_shm_segments(v)[index];
+  if (s->count > max) return WIQ_SHM_EINVAL;
+  const uint16_t* data = (const uint16_t*)((const char*)v->header + v->header->data_offset) + s->data;
+  for (uint32_t attempt = 0; attempt < WIQ_SHM_READ_RETRIES; ++attempt) {
+    uint32_t before = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+    if (before & 1u) {
+      /* Mid-update: only worth waiting for if someone will finish it. */
+      if (!wiq_shm_writer_alive(v)) return WIQ_SHM_EDEAD;
+      sched_yield();
+    } else {
+      for (uint32_t i = 0; i < s->count; ++i) out[i] = __atomic_load_n(&data[i], __ATOMIC_RELAXED);
+      uint64_t gen = __atomic_load_n(&s->generation, __ATOMIC_RELAXED);
+      uint64_t ns = __atomic_load_n(&s->monotonic_ns, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == before) {
+        if (generation) *generation = gen;
+        if (monotonic_ns) *monotonic_ns = ns;
+        return gen == 0 ? 0 : (int)s->count;
+      }
+    }
+  }
+  return WIQ_SHM_EBUSY;
+}
+
+/* Map the object read-only. Returns 0, or -1 if it does not exist or its
+ * layout is not one this header understands. */
+static inline int wiq_shm_open(const char* name, wiq_shm_view* out) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(wiq_shm_header)) { close(fd); return -1; }
+  void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return -1;
+  const wiq_shm_header* h = (const wiq_shm_header*)p;
+  if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != WIQ_SHM_MAGIC || h->version != WIQ_SHM_VERSION || h->header_size != sizeof(wiq_shm_header) ||
+      h->segment_size != sizeof(wiq_shm_segment) || h->item_size != sizeof(wiq_shm_item) ||
+      h->total_size > (uint64_t)st.st_size) {
+    munmap(p, (size_t)st.st_size);
+    return -1;
+  }
+  out->header = h;
+  out->size = (size_t)st.st_size;
+  return 0;
+}
+
+static inline void wiq_shm_close(wiq_shm_view* v) {
+  if (v->header) munmap((void*)v->header, v->size);
+  v->header = NULL;
+  v->size = 0;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIQ_MODBUS_SHM_H */
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "IModbusClient.hpp"
+
+namespace wiq {
+
+struct RtuConfig {
+  std::string port;          // e.g. /dev/ttyUSB0
+  int baud{9600};
+  char parity{'N'};          // 'N', 'E', 'O'
+  int data_bits{8};
+  int stop_bits{1};
+  int timeout_ms{1000};      // response timeout, counted from the end of the request
+  int frame_silence_ms{0};   // inter-frame gap; 0 derives t3.5 from the baud rate
+  int char_gap_allowance_ms{0};  // added to t1.5 inside a frame, e.g. for USB adapter latency
+};
+
+// Built-in Modbus RTU client on a termios serial line (POSIX). Responses are
+// sized from their function code and byte count, so a read returns as soon
+// as the last byte arrives instead of waiting out the inter-frame silence.
+WIQ_IOH_API std::unique_ptr<IModbusClient> make_rtu_client(const RtuConfig& cfg);
+
+} // namespace wiq
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "IModbusClient.hpp"
+
+namespace wiq {
+
+// Built-in Modbus TCP (MBAP) client: non-blocking socket driven by poll(),
+// fixed per-connection frame buffers, no libmodbus dependency.
+WIQ_IOH_API std::unique_ptr<IModbusClient> make_tcp_client(const std::string& host, int port);
+
+// libmodbus-backed client; returns nullptr when built without WITH_LIBMODBUS.
+WIQ_IOH_API std::unique_ptr<IModbusClient> make_libmodbus_tcp_client(const std::string& host, int port);
+
+} // namespace wiq
@@ -2,6 +2,19 @@
 #include "IModbusClient.hpp"
 #include "AsciiModbusClient.hpp"
 #include "ModbusError.hpp"
+#include "ModbusPush.hpp"
+#include "TcpModbusClient.hpp"
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include "Prefetcher.hpp"
+#include "ProcessImage.hpp"
+#include "ReadBatcher.hpp"
+#include "ReadCoalescer.hpp"
+#include "ShmExport.hpp"
+#include "ValueCache.hpp"
+#include "poll/PollEngine.hpp"
+#include "poll/BusBudget.hpp"
+#include "modbus/TcpModbusServer.hpp"
 #include <nlohmann/json.hpp>
 #include <cstdio>
 #include <cstdlib>
@@ -13,6 +26,7 @@
 #include <vector>
 #include <fstream>
 #include <cmath>
+#include <map>
 #include <set>
 #include <deque>
 #include <ctime>
@@ -21,201 +35,12 @@
 #include <thread>
 #include <chrono>
 #include <utility>
-
-#if defined(_WIN32)
-# ifndef NOMINMAX
-#  define NOMINMAX
-# endif
-# include <winsock2.h>
-# include <ws2tcpip.h>
-# include <windows.h>
-#endif
-
-#if defined(WITH_LIBMODBUS)
-# include <modbus.h>
-#endif
+#include <mutex>
 
 using nlohmann::json;
 
 namespace wiq {
 
-#if defined(_WIN32)
-static std::pair<int, std::string> last_socket_error() {
-  int err = WSAGetLastError();
-  if (err == 0) return {0, {}};
-  LPSTR msg_buf = nullptr;
-  DWORD flags = FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
-  DWORD len = FormatMessageA(flags, nullptr, static_cast<DWORD>(err), 0, reinterpret_cast<LPSTR>(&msg_buf), 0, nullptr);
-  std::string message;
-  if (len != 0 && msg_buf) {
-    message.assign(msg_buf, len);
-    LocalFree(msg_buf);
-    while (!message.empty() && (message.back() == '\r' || message.back() == '\n')) message.pop_back();
-  }
-  return {err, message};
-}
-#endif
-
-#if defined(WITH_LIBMODBUS)
-class TcpModbusClient : public IModbusClient {
-public:
-  TcpModbusClient(std::string host, int port)
-  : host_(std::move(host)), port_(port), ctx_(nullptr), timeout_ms_(1000) {}
-  ~TcpModbusClient() override { close(); }
-
-  int connect() override {
-    close();
-    ctx_ = modbus_new_tcp(host_.c_str(), port_);
-    if (!ctx_) return static_cast<int>(ModbusErr::IO_ERROR);
-    // set timeouts
-    set_timeout_ms(timeout_ms_);
-    if (modbus_connect(ctx_) == -1) {
-#if defined(_WIN32)
-      auto wsa_info = last_socket_error();
-      int wsa_err = wsa_info.first;
-      const std::string& wsa_msg = wsa_info.second;
-      wiq::log::log_warn(__FILE__, __LINE__,
-                         "modbus_connect failed: %s (errno=%d, WSA=%d%s%s)",
-                         modbus_strerror(errno), errno,
-                         wsa_err,
-                         wsa_msg.empty() ? "" : ", ",
-                         wsa_msg.empty() ? "" : wsa_msg.c_str());
-#else
-      wiq::log::log_warn(__FILE__, __LINE__, "modbus_connect failed: %s (errno=%d)",
-                         modbus_strerror(errno), errno);
-#endif
-      modbus_free(ctx_); ctx_ = nullptr; return static_cast<int>(ModbusErr::IO_ERROR);
-    }
-    return 0;
-  }
-  void close() override {
-    if (ctx_) { modbus_close(ctx_); modbus_free(ctx_); ctx_ = nullptr; }
-  }
-  void set_timeout_ms(int ms) override {
-    timeout_ms_ = ms;
-    if (ctx_) {
-      struct timeval tv; tv.tv_sec = ms/1000; tv.tv_usec = (ms%1000)*1000;
-      modbus_set_response_timeout(ctx_, tv.tv_sec, tv.tv_usec);
-    }
-  }
-
-  int read_coils(int unit, int addr, int count, std::uint8_t* out) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_read_bits(ctx_, addr, count, out);
-    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int read_discrete_inputs(int unit, int addr, int count, std::uint8_t* out) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_read_input_bits(ctx_, addr, count, out);
-    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int read_holding_regs(int unit, int addr, int count, std::uint16_t* out) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_read_registers(ctx_, addr, count, out);
-    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int read_input_regs(int unit, int addr, int count, std::uint16_t* out) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_read_input_registers(ctx_, addr, count, out);
-    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int write_single_coil(int unit, int addr, bool on) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_write_bit(ctx_, addr, on ? 1 : 0);
-    return (rc == 1) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int write_single_reg(int unit, int addr, std::uint16_t value) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_write_register(ctx_, addr, value);
-    return (rc == 1) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int write_multiple_coils(int unit, int addr, int count, const std::uint8_t* v) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_write_bits(ctx_, addr, count, v);
-    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-  int write_multiple_regs(int unit, int addr, int count, const std::uint16_t* v) override {
-    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    modbus_set_slave(ctx_, unit);
-    int rc = modbus_write_registers(ctx_, addr, count, v);
-    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
-  }
-
-private:
-  std::string host_; int port_;
-  modbus_t* ctx_;
-  int timeout_ms_;
-};
-#endif
-
-struct ItemCfg {
-  std::string name;
-  int unit_id{};
-  int function{}; // 1/2/3/4/5/6/8/15/16
-  int address{};
-  int count{1};
-  std::string type; // bool|int16|uint16|int32|uint32|float|double
-  double scale{1.0};
-  double offset{0.0};
-  bool swap_words{false};
-  int poll_ms{0};
-  std::string word_order{"ABCD"}; // for 64-bit (double): ABCD|BADC|CDAB|DCBA
-  bool broadcast_allowed{false};
-};
-
-struct ExceptionLogEntry {
-  int function{};
-  int unit{};
-  std::uint8_t exception{};
-  std::string message;
-  std::chrono::system_clock::time_point timestamp;
-};
-
-struct DiagnosticsState {
-  std::uint64_t operations{0};
-  std::uint64_t retries{0};
-  std::uint64_t io_errors{0};
-  std::uint64_t timeouts{0};
-  std::uint64_t invalid_args{0};
-  std::uint64_t unsupported{0};
-  std::uint64_t broadcasts_sent{0};
-  std::uint64_t crc_errors{0};
-  std::uint64_t lrc_errors{0};
-  std::deque<ExceptionLogEntry> recent_exceptions;
-  void record_exception(const ExceptionLogEntry& e) {
-    recent_exceptions.push_front(e);
-    while (recent_exceptions.size() > 50) recent_exceptions.pop_back();
-  }
-  void reset() {
-    operations = retries = io_errors = timeouts = invalid_args = unsupported = broadcasts_sent = crc_errors = lrc_errors = 0;
-    recent_exceptions.clear();
-  }
-};
-
-struct IoContext {
-  std::unordered_map<std::string, ItemCfg> items;
-  std::unique_ptr<IModbusClient> client;
-  // tcp config
-  std::string host; int port{1502}; int timeout_ms{1000};
-  // transport
-  std::string transport; // tcp|rtu|ascii
-  bool has_ascii_cfg{false};
-  AsciiConfig ascii_cfg{};
-  // reconnect policy
-  int reconnect_retries{1};            // number of reconnect attempts upon NOT_CONNECTED
-  int reconnect_interval_ms{0};        // base wait before each reconnect attempt
-  double reconnect_backoff{1.0};       // multiplier applied after each attempt (>=1.0)
-  int reconnect_max_interval_ms{0};    // optional cap; 0 means uncapped
-  DiagnosticsState diagnostics;
-};
-
 static bool load_file(const char* path, std::string& out) {
   std::ifstream ifs(path, std::ios::binary);
   if (!ifs) return false;
@@ -223,175 +48,322 @@ static bool load_file(const char* path, std::string& out) {
   return true;
 }
 
-static std::uint32_t join_u32(std::uint16_t hi, std::uint16_t lo, bool swap_words) {
-  return swap_words ? (std::uint32_t(lo) << 16) | hi
-                    : (std::uint32_t(hi) << 16) | lo;
-}
-
-static void split_u32(std::uint32_t v, bool swap_words, std::uint16_t& hi, std::uint16_t& lo) {
-  std::uint16_t h = std::uint16_t((v >> 16) & 0xFFFF);
-  std::uint16_t l = std::uint16_t(v & 0xFFFF);
-  if (swap_words) { hi = l; lo = h; } else { hi = h; lo = l; }
-}
-
-static std::uint64_t join_u64_be(const std::uint16_t r[4]) {
-  return (std::uint64_t(r[0]) << 48) | (std::uint64_t(r[1]) << 32) |
-         (std::uint64_t(r[2]) << 16) | std::uint64_t(r[3]);
-}
-
-static void split_u64_be(std::uint64_t u, std::uint16_t out[4]) {
-  out[0] = (u >> 48) & 0xFFFF;
-  out[1] = (u >> 32) & 0xFFFF;
-  out[2] = (u >> 16) & 0xFFFF;
-  out[3] = u & 0xFFFF;
-}
-
-static void reorder_words4(const std::uint16_t in[4], const std::string& order, std::uint16_t out[4]) {
-  auto pick = [&](int idx)->std::uint16_t { return in[idx]; };
-  if (order == "ABCD") { out[0]=pick(0); out[1]=pick(1); out[2]=pick(2); out[3]=pick(3); return; }
-  if (order == "BADC") { out[0]=pick(1); out[1]=pick(0); out[2]=pick(3); out[3]=pick(2); return; }
-  if (order == "CDAB") { out[0]=pick(2); out[1]=pick(3); out[2]=pick(0); out[3]=pick(1); return; }
-  if (order == "DCBA") { out[0]=pick(3); out[1]=pick(2); out[2]=pick(1); out[3]=pick(0); return; }
-  // default
-  out[0]=pick(0); out[1]=pick(1); out[2]=pick(2); out[3]=pick(3);
+static std::unique_ptr<IModbusClient> make_client_for(const Device& dev) {
+  if (dev.transport == "tcp") {
+    if (dev.tcp_backend == "native") return make_tcp_client(dev.host, dev.port);
+    if (dev.tcp_backend == "libmodbus" || dev.tcp_backend == "auto") {
+      if (auto c = make_libmodbus_tcp_client(dev.host, dev.port)) return c;
+      if (dev.tcp_backend == "libmodbus") {
+        log::log_error(__FILE__, __LINE__, "tcp.backend=libmodbus but this build has no libmodbus support");
+        return nullptr;
+      }
+      log::log_debug(__FILE__, __LINE__, "tcp: built without libmodbus, using the native client");
+      return make_tcp_client(dev.host, dev.port);
+    }
+  }
+  if (dev.transport == "rtu") {
+    return wiq::make_rtu_client(dev.rtu_cfg);
+  }
+  if (dev.transport == "ascii" && dev.ascii_backend == "serial") {
+    return wiq::make_ascii_client(dev.ascii_cfg);
+  }
+  // fallback to stub
+  return make_stub_client();
 }
 
-static double apply_scale(double raw, double scale, double offset) { return raw * scale + offset; }
-static double unscale(double scaled, double scale, double offset) { return (scale == 0.0) ? 0.0 : (scaled - offset) / scale; }
-
-// Helper: perform a Modbus client operation; if NOT_CONNECTED, try reconnect once and retry
-static int call_with_reconnect(wiq::IoContext* ctx, const std::function<int()>& op) {
-  int rc = op();
-  if (!ctx || !ctx->client) return rc;
-  const int NOT_CONNECTED_RC = static_cast<int>(wiq::ModbusErr::NOT_CONNECTED);
-  if (rc != NOT_CONNECTED_RC) return rc;
-
-  int attempts = ctx->reconnect_retries;
-  if (attempts <= 0) return rc;
-
-  using namespace std::chrono;
-  double backoff = (ctx->reconnect_backoff < 1.0) ? 1.0 : ctx->reconnect_backoff;
-  int wait_ms = (ctx->reconnect_interval_ms < 0) ? 0 : ctx->reconnect_interval_ms;
-  int max_ms = (ctx->reconnect_max_interval_ms < 0) ? 0 : ctx->reconnect_max_interval_ms;
-
-  wiq::log::log_debug(__FILE__, __LINE__,
-                  "NOT_CONNECTED -> reconnect policy: retries=%d interval_ms=%d backoff=%.2f cap=%d",
-                  attempts, wait_ms, backoff, max_ms);
-  for (int attempt = 1; attempt <= attempts; ++attempt) {
-    if (wait_ms > 0) {
-      wiq::log::log_trace(__FILE__, __LINE__, "reconnect attempt %d/%d: sleep %d ms", attempt, attempts, wait_ms);
-      std::this_thread::sleep_for(milliseconds(wait_ms));
-    } else {
-      wiq::log::log_trace(__FILE__, __LINE__, "reconnect attempt %d/%d: no wait", attempt, attempts);
+// Configure `dev` from a device description laid out like the top level of a
+// single-device config (`transport`, `tcp`, `ascii`, `reconnect`) and create
+// its client. The client is connected later, together with the others.
+static bool configure_device(const json& cfg, Device& dev) {
+  dev.transport = cfg.value("transport", std::string("tcp"));
+  if (!(dev.transport == "tcp" || dev.transport == "rtu" || dev.transport == "ascii")) {
+    wiq::log::log_error(__FILE__, __LINE__, "invalid transport '%s' (expected tcp|rtu|ascii)", dev.transport.c_str());
+    return false;
+  }
+  if (cfg.contains("tcp")) {
+    auto t = cfg["tcp"]; dev.host = t.value("host", std::string("127.0.0.1")); dev.port = t.value("port", 1502); dev.timeout_ms = t.value("timeout_ms", 1000);
+    dev.tcp_backend = t.value("backend", dev.tcp_backend);
+    if (!(dev.tcp_backend == "auto" || dev.tcp_backend == "native" || dev.tcp_backend == "libmodbus" || dev.tcp_backend == "stub")) {
+      wiq::log::log_error(__FILE__, __LINE__, "invalid tcp.backend '%s' (expected auto|native|libmodbus|stub)", dev.tcp_backend.c_str());
+      return false;
     }
-    if (ctx) ctx->diagnostics.retries += 1;
-    (void)ctx->client->connect();
-    rc = op();
-    if (rc != NOT_CONNECTED_RC) {
-      wiq::log::log_debug(__FILE__, __LINE__, "reconnect attempt %d/%d: operation returned %d", attempt, attempts, rc);
-      return rc; // success or different error
+    if (dev.port <= 0 || dev.port > 65535) return false;
+    dev.pipeline_window = t.value("pipeline_window", dev.pipeline_window);
+    if (dev.pipeline_window < 1 || dev.pipeline_window > 16) {
+      wiq::log::log_error(__FILE__, __LINE__, "invalid tcp.pipeline_window %d (expected 1..16)", dev.pipeline_window);
+      return false;
     }
-
-    // prepare next wait with backoff
-    if (wait_ms > 0) {
-      double next = wait_ms * backoff;
-      if (next > static_cast<double>(INT32_MAX)) next = static_cast<double>(INT32_MAX);
-      int next_ms = static_cast<int>(next);
-      if (max_ms > 0 && next_ms > max_ms) next_ms = max_ms;
-      wait_ms = next_ms;
+  }
+  if (dev.transport == "ascii") {
+    dev.has_ascii_cfg = true;
+    wiq::AsciiConfig asciiCfg;
+    if (cfg.contains("ascii") && cfg["ascii"].is_object()) {
+      auto a = cfg["ascii"];
+      asciiCfg.port = a.value("port", std::string("/dev/ttyS10"));
+      asciiCfg.baud = a.value("baud", 9600);
+      std::string parity = a.value("parity", std::string("E"));
+      if (parity.empty()) parity = "E";
+      char p = static_cast<char>(std::toupper(parity[0]));
+      if (p != 'N' && p != 'E' && p != 'O') return false;
+      asciiCfg.parity = p;
+      asciiCfg.data_bits = a.value("data_bits", 7);
+      if (asciiCfg.data_bits != 7 && asciiCfg.data_bits != 8) return false;
+      asciiCfg.stop_bits = a.value("stop_bits", 1);
+      if (asciiCfg.stop_bits != 1 && asciiCfg.stop_bits != 2) return false;
+      asciiCfg.timeout_ms = a.value("timeout_ms", 1500);
+      asciiCfg.lrc_check = a.value("lrc_check", true);
+      asciiCfg.frame_silence_ms = a.value("frame_silence_ms", 5);
+      dev.ascii_backend = a.value("backend", dev.ascii_backend);
+      if (dev.ascii_backend != "serial" && dev.ascii_backend != "stub") {
+        wiq::log::log_error(__FILE__, __LINE__, "invalid ascii.backend '%s' (expected serial|stub)", dev.ascii_backend.c_str());
+        return false;
+      }
     }
+    dev.timeout_ms = asciiCfg.timeout_ms;
+    dev.ascii_cfg = asciiCfg;
   }
-  wiq::log::log_warn(__FILE__, __LINE__, "all reconnect attempts failed with NOT_CONNECTED");
-  return rc;
-}
-
-static std::unique_ptr<IModbusClient> make_client_for(const std::string& transport,
-                                                      const std::string& host,
-                                                      int port,
-                                                      const wiq::AsciiConfig* ascii_cfg) {
-#if defined(WITH_LIBMODBUS)
-  if (transport == "tcp") {
-    return std::unique_ptr<IModbusClient>(new TcpModbusClient(host, port));
+  if (dev.transport == "rtu") {
+    wiq::RtuConfig& rtuCfg = dev.rtu_cfg;
+    if (!cfg.contains("rtu") || !cfg["rtu"].is_object()) {
+      wiq::log::log_error(__FILE__, __LINE__, "transport=rtu requires an `rtu` section with a `port`");
+      return false;
+    }
+    const json& r = cfg["rtu"];
+    rtuCfg.port = r.value("port", std::string());
+    if (rtuCfg.port.empty()) {
+      wiq::log::log_error(__FILE__, __LINE__, "rtu.port is required");
+      return false;
+    }
+    rtuCfg.baud = r.value("baud", 9600);
+    std::string parity = r.value("parity", std::string("N"));
+    if (parity.empty()) parity = "N";
+    char p = static_cast<char>(std::toupper(parity[0]));
+    if (p != 'N' && p != 'E' && p != 'O') return false;
+    rtuCfg.parity = p;
+    rtuCfg.data_bits = r.value("data_bits", 8);
+    if (rtuCfg.data_bits != 7 && rtuCfg.data_bits != 8) return false;
+    rtuCfg.stop_bits = r.value("stop_bits", 1);
+    if (rtuCfg.stop_bits != 1 && rtuCfg.stop_bits != 2) return false;
+    rtuCfg.timeout_ms = r.value("timeout_ms", 1000);
+    rtuCfg.frame_silence_ms = r.value("frame_silence_ms", 0);
+    rtuCfg.char_gap_allowance_ms = r.value("char_gap_allowance_ms", 0);
+    if (rtuCfg.baud <= 0 || rtuCfg.timeout_ms <= 0 || rtuCfg.frame_silence_ms < 0 ||
+        rtuCfg.char_gap_allowance_ms < 0) return false;
+    dev.timeout_ms = rtuCfg.timeout_ms;
   }
-#endif
-  if (transport == "ascii" && ascii_cfg) {
-    return wiq::make_ascii_client(*ascii_cfg);
+  // reconnect policy (optional)
+  if (cfg.contains("reconnect") && cfg["reconnect"].is_object()) {
+    auto r = cfg["reconnect"];
+    dev.reconnect_retries = r.value("retries", dev.reconnect_retries);
+    dev.reconnect_interval_ms = r.value("interval_ms", dev.reconnect_interval_ms);
+    dev.reconnect_backoff = r.value("backoff_multiplier", dev.reconnect_backoff);
+    dev.reconnect_max_interval_ms = r.value("max_interval_ms", dev.reconnect_max_interval_ms);
   }
-  // fallback to stub
-  return make_stub_client();
+  dev.client = wiq::make_client_for(dev);
+  if (!dev.client) return false;
+  wiq::log::log_info(__FILE__, __LINE__,
+                 "CreateIoInstance: device=%s transport=%s host=%s port=%d timeout_ms=%d retries=%d interval_ms=%d backoff=%.2f cap=%d",
+                 dev.name.c_str(), dev.transport.c_str(), dev.host.c_str(), dev.port, dev.timeout_ms,
+                 dev.reconnect_retries, dev.reconnect_interval_ms, dev.reconnect_backoff, dev.reconnect_max_interval_ms);
+  dev.client->set_timeout_ms(dev.timeout_ms);
+  if (dev.transport == "tcp") dev.client->set_pipeline_window(dev.pipeline_window);
+  else dev.pipeline_window = 1;
+  if (dev.transport == "ascii" && dev.has_ascii_cfg) {
+    dev.client->set_frame_silence_ms(dev.ascii_cfg.frame_silence_ms);
+  }
+  return true;
 }
 
-} // namespace wiq
-
-static const char* message_for_rc(int rc) {
-  switch (rc) {
-    case 0: return "ok";
-    case static_cast<int>(wiq::ModbusErr::INVALID_ARG): return "invalid argument";
-    case static_cast<int>(wiq::ModbusErr::NOT_FOUND): return "not found";
-    case static_cast<int>(wiq::ModbusErr::IO_TIMEOUT): return "timeout";
-    case static_cast<int>(wiq::ModbusErr::IO_ERROR): return "io error";
-    case static_cast<int>(wiq::ModbusErr::NOT_CONNECTED): return "not connected";
-    case static_cast<int>(wiq::ModbusErr::UNSUPPORTED): return "unsupported";
-    case static_cast<int>(wiq::ModbusErr::PARSE_ERROR): return "parse error";
-    default: return "error";
+static int find_device(const IoContext& ctx, const std::string& name) {
+  for (std::size_t i = 0; i < ctx.devices.size(); ++i) {
+    if (ctx.devices[i]->name == name) return static_cast<int>(i);
   }
+  return -1;
 }
 
-static void record_success(wiq::IoContext* ctx) {
-  if (ctx) ctx->diagnostics.operations += 1;
+// One entry of an item's `burst` array; `when` is "change" (default) or a
+// single comparison such as {"ne": 0}.
+static bool parse_burst_rule(const json& r, BurstRule& rule) {
+  if (!r.is_object() || !r.contains("items") || !r["items"].is_array()) return false;
+  for (const auto& n : r["items"]) {
+    if (!n.is_string()) return false;
+    rule.items.push_back(n.get<std::string>());
+  }
+  rule.poll_ms = r.value("poll_ms", 0);
+  rule.duration_ms = r.value("duration_ms", 0);
+  if (rule.items.empty() || rule.poll_ms <= 0 || rule.duration_ms <= 0) return false;
+  if (!r.contains("when")) return true;
+  const json& w = r["when"];
+  if (w.is_string()) return w == "change";
+  if (!w.is_object() || w.size() != 1 || !w.begin().value().is_number()) return false;
+  static const std::map<std::string, BurstRule::When> ops = {
+    {"eq", BurstRule::When::Eq}, {"ne", BurstRule::When::Ne}, {"gt", BurstRule::When::Gt},
+    {"ge", BurstRule::When::Ge}, {"lt", BurstRule::When::Lt}, {"le", BurstRule::When::Le}
+  };
+  auto op = ops.find(w.begin().key());
+  if (op == ops.end()) return false;
+  rule.when = op->second;
+  rule.value = w.begin().value().get<double>();
+  return true;
 }
 
-static void record_error(wiq::IoContext* ctx, const wiq::ItemCfg& ic, int rc) {
-  if (!ctx) return;
-  ctx->diagnostics.operations += 1;
-  if (rc == static_cast<int>(wiq::ModbusErr::IO_TIMEOUT)) ctx->diagnostics.timeouts += 1;
-  else if (rc == static_cast<int>(wiq::ModbusErr::IO_ERROR)) ctx->diagnostics.io_errors += 1;
-  else if (rc == static_cast<int>(wiq::ModbusErr::INVALID_ARG)) ctx->diagnostics.invalid_args += 1;
-  else if (rc == static_cast<int>(wiq::ModbusErr::UNSUPPORTED)) ctx->diagnostics.unsupported += 1;
-  else if (rc == static_cast<int>(wiq::ModbusErr::CRC_ERROR)) ctx->diagnostics.crc_errors += 1;
-  else if (rc == static_cast<int>(wiq::ModbusErr::LRC_ERROR)) ctx->diagnostics.lrc_errors += 1;
-
-  if (wiq::is_modbus_exception(rc)) {
-    auto code = wiq::decode_modbus_exception(rc);
-    ctx->diagnostics.record_exception({ic.function, ic.unit_id, code, wiq::modbus_exception_to_string(code), std::chrono::system_clock::now()});
-    if (code == 4) ctx->diagnostics.io_errors += 1;
-    if (code == 3) ctx->diagnostics.invalid_args += 1;
+} // namespace wiq
+
+static std::string utc_timestamp(std::chrono::system_clock::time_point t) {
+  std::time_t tt = std::chrono::system_clock::to_time_t(t);
+  char buf[32];
+  if (std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&tt)) == 0) {
+    std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(tt));
   }
+  return buf;
 }
 
-static nlohmann::json diagnostics_snapshot_json(const wiq::DiagnosticsState& d) {
+static nlohmann::json diagnostics_snapshot_json(const wiq::IoContext& ctx) {
+  const wiq::DiagnosticsState& d = ctx.diagnostics;
   nlohmann::json snap;
   snap["counters"] = {
-    {"operations", d.operations},
-    {"retries", d.retries},
-    {"io_errors", d.io_errors},
-    {"timeouts", d.timeouts},
-    {"invalid_args", d.invalid_args},
-    {"unsupported", d.unsupported},
-    {"broadcasts_sent", d.broadcasts_sent},
-    {"crc_errors", d.crc_errors},
-    {"lrc_errors", d.lrc_errors}
+    {"operations", d.operations.load()},
+    {"retries", d.retries.load()},
+    {"io_errors", d.io_errors.load()},
+    {"timeouts", d.timeouts.load()},
+    {"invalid_args", d.invalid_args.load()},
+    {"unsupported", d.unsupported.load()},
+    {"broadcasts_sent", d.broadcasts_sent.load()},
+    {"crc_errors", d.crc_errors.load()},
+    {"lrc_errors", d.lrc_errors.load()},
+    {"poll_cycles", d.poll_cycles.load()},
+    {"poll_overruns", d.poll_overruns.load()},
+    {"deadline_misses", d.deadline_misses.load()},
+    {"adaptive_slowdowns", d.adaptive_slowdowns.load()},
+    {"adaptive_speedups", d.adaptive_speedups.load()},
+    {"shed_normal", d.shed_normal.load()},
+    {"shed_background", d.shed_background.load()},
+    {"trigger_fires", d.trigger_fires.load()},
+    {"trigger_holds", d.trigger_holds.load()},
+    {"burst_activations", d.burst_activations.load()},
+    {"burst_bus_us", d.burst_bus_us.load()}
   };
+  nlohmann::json units = nlohmann::json::array();
+  nlohmann::json devices = nlohmann::json::array();
+  for (const auto& dev : ctx.devices) {
+    const wiq::DeviceDiagnostics& dd = dev->diagnostics;
+    const std::uint64_t writes = dd.writes.load();
+    std::lock_guard<std::mutex> lk(dd.units_mu);
+    for (const auto& kv : dd.units) {
+      units.push_back({
+        {"device", dev->name},
+        {"unit", kv.first},
+        {"deadline_misses", kv.second.deadline_misses},
+        {"backoffs", kv.second.backoffs}
+      });
+    }
+    devices.push_back({
+      {"name", dev->name},
+      {"transport", dev->transport},
+      {"operations", dd.operations.load()},
+      {"errors", dd.errors.load()},
+      {"timeouts", dd.timeouts.load()},
+      {"reconnects", dd.reconnects.load()},
+      {"shed_level", dd.shed_level.load()},
+      {"batched_reads", dd.batched_reads.load()},
+      {"batch_transactions", dd.batch_transactions.load()},
+      {"coalesced_reads", dd.coalesced_reads.load()},
+      {"prefetch", {
+        {"hits", dd.prefetch_hits.load()},
+        {"misses", dd.prefetch_misses.load()},
+        {"stored", dd.prefetched.load()}
+      }},
+      {"cache", {
+        {"hits", dd.cache_hits.load()},
+        {"shared_reads", dd.shared_reads.load()}
+      }},
+      {"image", {
+        {"segments", dev->image ? dev->image->segments() : 0},
+        {"retries", dd.image_retries.load()}
+      }},
+      {"write_latency_us", {
+        {"count", writes},
+        {"last", dd.write_wait_us_last.load()},
+        {"max", dd.write_wait_us_max.load()},
+        {"avg", writes ? dd.write_wait_us_total.load() / writes : 0}
+      }}
+    });
+  }
+  nlohmann::json periods = nlohmann::json::array();
+  for (const auto& dev : ctx.devices) {
+    if (!dev->poller) continue;
+    for (auto& p : dev->poller->periods_json()) periods.push_back(std::move(p));
+  }
+  snap["periods"] = std::move(periods);
+  if (ctx.shm) {
+    snap["shared_memory"] = {
+      {"name", ctx.shm->name()},
+      {"segments", ctx.shm->segments()},
+      {"items", ctx.shm->items()},
+      {"bytes", ctx.shm->size()}
+    };
+  }
+  if (ctx.server) {
+    snap["server"] = {
+      {"port", ctx.server->port()},
+      {"clients", ctx.server->clients()},
+      {"requests", d.server_requests.load()},
+      {"exceptions", d.server_exceptions.load()},
+      {"writes", d.server_writes.load()},
+      {"mode", ctx.server_cfg.mode == wiq::ServerMode::Proxy ? "proxy" : "image"},
+      {"downstream", d.server_downstream.load()},
+      {"coalesced", d.server_coalesced.load()},
+      {"cache_hits", d.server_cache_hits.load()}
+    };
+  }
+  snap["units"] = std::move(units);
+  snap["devices"] = std::move(devices);
   nlohmann::json ex = nlohmann::json::array();
+  std::lock_guard<std::mutex> lk(d.exceptions_mu);
   for (const auto& e : d.recent_exceptions) {
-    std::time_t tt = std::chrono::system_clock::to_time_t(e.timestamp);
-    char buf[32];
-    if (std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&tt)) == 0) {
-      std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(tt));
-    }
     ex.push_back({
       {"function", e.function},
       {"unit", e.unit},
       {"exception", e.exception},
       {"name", wiq::modbus_exception_to_string(e.exception)},
       {"message", e.message},
-      {"timestamp", std::string(buf)}
+      {"timestamp", utc_timestamp(e.timestamp)}
     });
   }
   snap["exceptions"] = std::move(ex);
   return snap;
 }
 
+static nlohmann::json bus_budget_json(const wiq::IoContext& ctx) {
+  nlohmann::json devices = nlohmann::json::array();
+  for (const auto& dev : ctx.devices) {
+    const wiq::DeviceLoad load = wiq::estimate_bus_load(ctx, *dev);
+    nlohmann::json groups = nlohmann::json::array();
+    for (const auto& g : load.groups) {
+      groups.push_back({
+        {"poll_ms", g.poll_ms},
+        {"items", g.items},
+        {"blocks", g.blocks},
+        {"wire_us", static_cast<long long>(g.wire_us + 0.5)},
+        {"utilization_pct", g.utilization_pct}
+      });
+    }
+    devices.push_back({
+      {"device", dev->name},
+      {"transport", dev->transport},
+      {"serial", load.serial},
+      {"utilization_pct", load.utilization_pct},
+      {"overloaded", load.utilization_pct > ctx.max_utilization_pct},
+      {"groups", std::move(groups)}
+    });
+  }
+  return nlohmann::json{
+    {"max_utilization_pct", ctx.max_utilization_pct},
+    {"admission", ctx.reject_overload ? "reject" : "warn"},
+    {"devices", std::move(devices)}
+  };
+}
+
 static bool write_str(char* out, int outSize, const std::string& s) {
   if (!out || outSize <= 0) return false;
   size_t len = s.size();
@@ -405,27 +377,105 @@ static bool write_json(char* out, int outSize, const nlohmann::json& payload) {
   return write_str(out, outSize, payload.dump());
 }
 
-static int emit_error_response(wiq::IoContext* ctx, const wiq::ItemCfg& ic, int rc, char* outJson, int outSize) {
-  record_error(ctx, ic, rc);
+static int write_error_json(const wiq::ItemCfg& ic, int rc, char* outJson, int outSize) {
   if (!outJson || outSize <= 0) return rc;
-  nlohmann::json err = {
-    {"error", {
-      {"code", rc},
-      {"message", message_for_rc(rc)}
-    }}
-  };
-  if (wiq::is_modbus_exception(rc)) {
-    auto code = wiq::decode_modbus_exception(rc);
-    err["error"]["exception"] = {
-      {"code", code},
-      {"name", wiq::modbus_exception_to_string(code)}
-    };
+  (void)write_str(outJson, outSize, wiq::format_error(ic, rc));
+  return rc;
+}
+
+static int emit_error_response(wiq::IoContext* ctx, const wiq::ItemCfg& ic, int rc, char* outJson, int outSize) {
+  wiq::record_error(ctx, ic, rc);
+  return write_error_json(ic, rc, outJson, outSize);
+}
+
+// Apply `fn` to every named item; unknown names are skipped and reported as
+// NOT_FOUND once all known names have been processed.
+template <typename Fn>
+static int for_each_named_item(wiq::IoContext* ctx, const char** names, int count, Fn fn) {
+  if (!ctx || count < 0 || (count > 0 && !names)) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+  int rc = 0;
+  for (int i = 0; i < count; ++i) {
+    if (!names[i]) { rc = static_cast<int>(wiq::ModbusErr::INVALID_ARG); continue; }
+    auto it = ctx->items.find(names[i]);
+    if (it == ctx->items.end()) {
+      if (rc == 0) rc = static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+      continue;
+    }
+    fn(it->second);
   }
-  if (!ic.name.empty()) err["error"]["item"] = ic.name;
-  (void)write_json(outJson, outSize, err);
   return rc;
 }
 
+// ReadItem and ReadItemMaxAge. With max_age_ms < 0 a subscribed item is
+// answered from the poll cache and others from the ValueCache within the
+// item's cache_ttl_ms; otherwise only a value at most max_age_ms old is
+// served without a bus read.
+static int read_item(wiq::IoContext* ctx, const char* name, int max_age_ms, char* outJson, int outSize) {
+  if (!ctx || !name) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+  auto it = ctx->items.find(name);
+  if (it == ctx->items.end()) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+  const wiq::ItemCfg& ic = it->second;
+
+  if (ic.function == 8) {
+    auto snap = diagnostics_snapshot_json(*ctx);
+    (void)write_json(outJson, outSize, snap);
+    wiq::record_success(ctx, nullptr);
+    return 0;
+  }
+
+  wiq::Device& dev = ctx->device_of(ic);
+  if (!dev.client) return static_cast<int>(wiq::ModbusErr::NOT_CONNECTED);
+
+  if (!wiq::is_readable(ic)) return static_cast<int>(wiq::ModbusErr::UNSUPPORTED);
+
+  wiq::RawValue raw;
+  int rc = 0;
+  // An explicit max age also bounds prefetched values; ReadItem takes them
+  // within the prefetch ttl.
+  const wiq::Prefetcher::clock::duration prefetch_age =
+      max_age_ms >= 0 ? wiq::Prefetcher::clock::duration(std::chrono::milliseconds(max_age_ms))
+                      : wiq::Prefetcher::clock::duration::max();
+  if (max_age_ms < 0) {
+    if (dev.poller && dev.poller->lookup(ic, raw, rc)) {
+      // Served from the poll cache: no bus transaction took place.
+      if (rc != 0) return write_error_json(ic, rc, outJson, outSize);
+      (void)write_str(outJson, outSize, wiq::format_value(ic, raw));
+      return 0;
+    }
+    max_age_ms = ic.cache_ttl_ms >= 0 ? ic.cache_ttl_ms : ctx->on_demand.cache_ttl_ms;
+  }
+  wiq::ValueCache::Value cached;
+  if (max_age_ms > 0 && dev.cache->lookup(ic, std::chrono::milliseconds(max_age_ms), cached)) {
+    dev.diagnostics.cache_hits += 1;
+    (void)write_str(outJson, outSize, cached.json);
+    return 0;
+  }
+  if (dev.prefetcher && dev.prefetcher->lookup(ic, raw, prefetch_age)) {
+    // Read along with a neighbour a moment ago.
+    (void)write_str(outJson, outSize, wiq::format_value(ic, raw));
+    return 0;
+  }
+
+  bool led = false;
+  rc = dev.cache->read(ic, [&](wiq::RawValue& out) {
+    if (dev.batcher) return dev.batcher->read(ic, out);
+    if (dev.prefetcher) return dev.prefetcher->read(ic, out);
+    return wiq::read_raw(ctx, ic, out);
+  }, raw, led);
+  if (!led) {
+    // Another caller's transaction answered this one; it did the bookkeeping.
+    dev.diagnostics.shared_reads += 1;
+    if (rc != 0) return write_error_json(ic, rc, outJson, outSize);
+    (void)write_str(outJson, outSize, wiq::format_value(ic, raw));
+    return 0;
+  }
+  if (dev.poller) dev.poller->store(ic, raw, rc);
+  if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
+  wiq::record_success(ctx, &dev);
+  (void)write_str(outJson, outSize, wiq::format_value(ic, raw));
+  return 0;
+}
+
 extern "C" {
 
 using IoHandle = void*;
@@ -448,60 +498,122 @@ WIQ_IOH_API IoHandle CreateIoInstance(void* /*user_param*/, const char* jsonConf
   }
 
   std::unique_ptr<wiq::IoContext> ctx(new wiq::IoContext());
-  ctx->transport = cfg.value("transport", std::string("tcp"));
-  if (!(ctx->transport == "tcp" || ctx->transport == "rtu" || ctx->transport == "ascii")) {
-    wiq::log::log_error(__FILE__, __LINE__, "invalid transport '%s' (expected tcp|rtu|ascii)", ctx->transport.c_str());
-    return nullptr;
+  // Without a `devices` section the top-level transport settings describe a
+  // single device named "default". Device entries inherit the top-level
+  // `reconnect` policy unless they set their own.
+  if (cfg.contains("devices")) {
+    if (!cfg["devices"].is_array() || cfg["devices"].empty()) {
+      wiq::log::log_error(__FILE__, __LINE__, "CreateIoInstance: 'devices' must be a non-empty array");
+      return nullptr;
+    }
+    const json devices = cfg["devices"];
+    for (const auto& d : devices) {
+      if (!d.is_object()) return nullptr;
+      json dcfg = d;
+      if (!dcfg.contains("reconnect") && cfg.contains("reconnect")) dcfg["reconnect"] = cfg["reconnect"];
+      std::unique_ptr<wiq::Device> dev(new wiq::Device());
+      dev->name = d.value("name", std::string());
+      if (dev->name.empty() || wiq::find_device(*ctx, dev->name) >= 0) {
+        wiq::log::log_error(__FILE__, __LINE__, "CreateIoInstance: device names must be unique and non-empty ('%s')", dev->name.c_str());
+        return nullptr;
+      }
+      if (!wiq::configure_device(dcfg, *dev)) return nullptr;
+      ctx->devices.push_back(std::move(dev));
+    }
+  } else {
+    std::unique_ptr<wiq::Device> dev(new wiq::Device());
+    dev->name = "default";
+    if (!wiq::configure_device(cfg, *dev)) return nullptr;
+    ctx->devices.push_back(std::move(dev));
   }
-  if (cfg.contains("tcp")) {
-    auto t = cfg["tcp"]; ctx->host = t.value("host", std::string("127.0.0.1")); ctx->port = t.value("port", 1502); ctx->timeout_ms = t.value("timeout_ms", 1000);
-    if (ctx->port <= 0 || ctx->port > 65535) return nullptr;
+  // background polling (optional)
+  if (cfg.contains("poll") && cfg["poll"].is_object()) {
+    auto p = cfg["poll"];
+    ctx->poll_enabled = p.value("enabled", ctx->poll_enabled);
+    ctx->block_plan.max_gap = p.value("max_gap", ctx->block_plan.max_gap);
+    ctx->block_plan.max_gap_bits = p.value("max_gap_bits", ctx->block_plan.max_gap_bits);
+    ctx->block_plan.max_block_regs = p.value("max_block_regs", ctx->block_plan.max_block_regs);
+    ctx->block_plan.max_block_bits = p.value("max_block_bits", ctx->block_plan.max_block_bits);
+    ctx->block_plan.max_transaction_ms = p.value("max_transaction_ms", ctx->block_plan.max_transaction_ms);
+    if (ctx->block_plan.max_gap < 0 || ctx->block_plan.max_gap_bits < 0) return nullptr;
+    if (ctx->block_plan.max_block_regs < 1 || ctx->block_plan.max_block_bits < 1) return nullptr;
+    if (ctx->block_plan.max_transaction_ms < 0) return nullptr;
+    ctx->unit_backoff.base_ms = p.value("unit_backoff_ms", ctx->unit_backoff.base_ms);
+    ctx->unit_backoff.max_ms = p.value("unit_backoff_max_ms", ctx->unit_backoff.max_ms);
+    if (ctx->unit_backoff.base_ms < 0 || ctx->unit_backoff.max_ms < ctx->unit_backoff.base_ms) return nullptr;
+    ctx->poll_periods.harmonic_base_ms = p.value("harmonic_base_ms", ctx->poll_periods.harmonic_base_ms);
+    ctx->poll_periods.stagger = p.value("stagger", ctx->poll_periods.stagger);
+    if (ctx->poll_periods.harmonic_base_ms < 0) return nullptr;
+    ctx->shed.cycle_target_pct = p.value("cycle_target_pct", ctx->shed.cycle_target_pct);
+    ctx->shed.window_ms = p.value("shed_window_ms", ctx->shed.window_ms);
+    if (ctx->shed.cycle_target_pct < 0 || ctx->shed.window_ms < 1) return nullptr;
+    ctx->max_utilization_pct = p.value("max_utilization_pct", ctx->max_utilization_pct);
+    const std::string admission = p.value("admission", std::string("warn"));
+    if (!(ctx->max_utilization_pct > 0.0) || (admission != "warn" && admission != "reject")) return nullptr;
+    ctx->reject_overload = admission == "reject";
   }
-  if (ctx->transport == "ascii") {
-    ctx->has_ascii_cfg = true;
-    wiq::AsciiConfig asciiCfg;
-    if (cfg.contains("ascii") && cfg["ascii"].is_object()) {
-      auto a = cfg["ascii"];
-      asciiCfg.port = a.value("port", std::string("/dev/ttyS10"));
-      asciiCfg.baud = a.value("baud", 9600);
-      std::string parity = a.value("parity", std::string("E"));
-      if (parity.empty()) parity = "E";
-      char p = static_cast<char>(std::toupper(parity[0]));
-      if (p != 'N' && p != 'E' && p != 'O') return nullptr;
-      asciiCfg.parity = p;
-      asciiCfg.data_bits = a.value("data_bits", 7);
-      if (asciiCfg.data_bits != 7 && asciiCfg.data_bits != 8) return nullptr;
-      asciiCfg.stop_bits = a.value("stop_bits", 1);
-      if (asciiCfg.stop_bits != 1 && asciiCfg.stop_bits != 2) return nullptr;
-      asciiCfg.timeout_ms = a.value("timeout_ms", 1500);
-      asciiCfg.lrc_check = a.value("lrc_check", true);
-      asciiCfg.frame_silence_ms = a.value("frame_silence_ms", 5);
+
+  if (cfg.contains("on_demand")) {
+    const json& od = cfg["on_demand"];
+    if (!od.is_object()) return nullptr;
+    ctx->on_demand.batch_window_us = od.value("batch_window_us", ctx->on_demand.batch_window_us);
+    if (ctx->on_demand.batch_window_us < 0 || ctx->on_demand.batch_window_us > 100000) return nullptr;
+    if (od.contains("prefetch")) {
+      const json& pf = od["prefetch"];
+      if (!pf.is_object()) return nullptr;
+      wiq::PrefetchCfg& p = ctx->on_demand.prefetch;
+      p.enabled = pf.value("enabled", true);
+      p.max_gap = pf.value("max_gap", p.max_gap);
+      p.ttl_ms = pf.value("ttl_ms", p.ttl_ms);
+      if (p.max_gap < 0 || p.ttl_ms < 1) return nullptr;
     }
-    ctx->timeout_ms = asciiCfg.timeout_ms;
-    ctx->ascii_cfg = asciiCfg;
+    ctx->on_demand.cache_ttl_ms = od.value("cache_ttl_ms", ctx->on_demand.cache_ttl_ms);
+    if (ctx->on_demand.cache_ttl_ms < 0) return nullptr;
   }
-  // reconnect policy (optional)
-  if (cfg.contains("reconnect") && cfg["reconnect"].is_object()) {
-    auto r = cfg["reconnect"];
-    ctx->reconnect_retries = r.value("retries", ctx->reconnect_retries);
-    ctx->reconnect_interval_ms = r.value("interval_ms", ctx->reconnect_interval_ms);
-    ctx->reconnect_backoff = r.value("backoff_multiplier", ctx->reconnect_backoff);
-    ctx->reconnect_max_interval_ms = r.value("max_interval_ms", ctx->reconnect_max_interval_ms);
+
+  if (cfg.contains("shared_memory")) {
+    const json& sm = cfg["shared_memory"];
+    if (!sm.is_object() || !sm.contains("name") || !sm["name"].is_string()) return nullptr;
+    const std::string name = sm["name"].get<std::string>();
+    if (name.size() < 2 || name.size() > 255 || name[0] != '/' || name.find('/', 1) != std::string::npos) {
+      wiq::log::log_error(__FILE__, __LINE__, "shared_memory.name must look like \"/name\"");
+      return nullptr;
+    }
+    if (sm.value("enabled", true)) ctx->shm_name = name;
   }
 
-  ctx->client = wiq::make_client_for(ctx->transport, ctx->host, ctx->port,
-                                     ctx->has_ascii_cfg ? &ctx->ascii_cfg : nullptr);
-  wiq::log::log_info(__FILE__, __LINE__,
-                 "CreateIoInstance: transport=%s host=%s port=%d timeout_ms=%d retries=%d interval_ms=%d backoff=%.2f cap=%d",
-                 ctx->transport.c_str(), ctx->host.c_str(), ctx->port, ctx->timeout_ms,
-                 ctx->reconnect_retries, ctx->reconnect_interval_ms, ctx->reconnect_backoff, ctx->reconnect_max_interval_ms);
-  if (ctx->client) {
-    ctx->client->set_timeout_ms(ctx->timeout_ms);
-    if (ctx->transport == "ascii" && ctx->has_ascii_cfg) {
-      ctx->client->set_frame_silence_ms(ctx->ascii_cfg.frame_silence_ms);
+  if (cfg.contains("server")) {
+    const json& sv = cfg["server"];
+    if (!sv.is_object()) return nullptr;
+    wiq::ServerCfg& sc = ctx->server_cfg;
+    sc.enabled = sv.value("enabled", true);
+    sc.bind = sv.value("bind", sc.bind);
+    sc.port = sv.value("port", sc.port);
+    sc.max_clients = sv.value("max_clients", sc.max_clients);
+    sc.max_age_ms = sv.value("max_age_ms", sc.max_age_ms);
+    sc.write_queue = sv.value("write_queue", sc.write_queue);
+    sc.subscribe = sv.value("subscribe", sc.subscribe);
+    sc.cache_ms = sv.value("cache_ms", sc.cache_ms);
+    sc.read_queue = sv.value("read_queue", sc.read_queue);
+    const std::string mode = sv.value("mode", std::string("image"));
+    if (mode == "image") sc.mode = wiq::ServerMode::Image;
+    else if (mode == "proxy") sc.mode = wiq::ServerMode::Proxy;
+    else return nullptr;
+    if (sv.contains("device")) {
+      sc.device = sv["device"].is_string() ? wiq::find_device(*ctx, sv["device"].get<std::string>()) : -1;
+      if (sc.device < 0) return nullptr;
+    }
+    const std::string writes = sv.value("writes", std::string("forward"));
+    if (writes == "forward") sc.writes = wiq::ServerWrites::Forward;
+    else if (writes == "queue") sc.writes = wiq::ServerWrites::Queue;
+    else if (writes == "reject") sc.writes = wiq::ServerWrites::Reject;
+    else return nullptr;
+    if (sc.port < 0 || sc.port > 65535 || sc.max_clients < 1 || sc.max_age_ms < 0 || sc.write_queue < 1 ||
+        sc.cache_ms < 0 || sc.read_queue < 1) {
+      return nullptr;
     }
-    (void)ctx->client->connect();
   }
+
   // parse items
   if (!(cfg.contains("items") && cfg["items"].is_array() && !cfg["items"].empty())) {
     return nullptr;
@@ -561,12 +673,157 @@ WIQ_IOH_API IoHandle CreateIoInstance(void* /*user_param*/, const char* jsonConf
     if ((ic.type == std::string("double")) && ic.function == 6) return nullptr; // single reg not allowed for double
 
     ic.broadcast_allowed = it.value("broadcast_allowed", false);
+    if (it.contains("priority")) {
+      const std::string pr = it["priority"].is_string() ? it["priority"].get<std::string>() : std::string();
+      if (pr == "realtime") ic.priority = wiq::PollPriority::Realtime;
+      else if (pr == "normal") ic.priority = wiq::PollPriority::Normal;
+      else if (pr == "background") ic.priority = wiq::PollPriority::Background;
+      else return nullptr;
+    }
+    if (it.contains("adaptive")) {
+      const auto& a = it["adaptive"];
+      if (!a.is_object() || ic.poll_ms <= 0) return nullptr;
+      ic.adaptive.max_poll_ms = a.value("max_poll_ms", ic.adaptive.max_poll_ms);
+      ic.adaptive.stable_polls = a.value("stable_polls", ic.adaptive.stable_polls);
+      ic.adaptive.change_polls = a.value("change_polls", ic.adaptive.change_polls);
+      if (ic.adaptive.max_poll_ms <= ic.poll_ms || ic.adaptive.stable_polls < 1 || ic.adaptive.change_polls < 1) {
+        wiq::log::log_error(__FILE__, __LINE__, "item '%s': adaptive needs max_poll_ms > poll_ms and counts >= 1", ic.name.c_str());
+        return nullptr;
+      }
+    }
+    if (it.contains("cache_ttl_ms")) {
+      if (!it["cache_ttl_ms"].is_number_integer()) return nullptr;
+      ic.cache_ttl_ms = it["cache_ttl_ms"].get<int>();
+      if (ic.cache_ttl_ms < 0) return nullptr;
+    }
+    if (it.contains("trigger")) {
+      const auto& t = it["trigger"];
+      if (!t.is_object() || !t.contains("item") || !t["item"].is_string()) return nullptr;
+      ic.trigger.item = t["item"].get<std::string>();
+      const std::string mode = t.value("mode", std::string("change"));
+      if (mode == "change") ic.trigger.mode = wiq::TriggerMode::Change;
+      else if (mode == "gate") ic.trigger.mode = wiq::TriggerMode::Gate;
+      else return nullptr;
+    }
+    if (it.contains("burst")) {
+      if (!it["burst"].is_array()) return nullptr;
+      for (const auto& r : it["burst"]) {
+        wiq::BurstRule rule;
+        if (!wiq::parse_burst_rule(r, rule)) {
+          wiq::log::log_error(__FILE__, __LINE__, "item '%s': invalid burst rule", ic.name.c_str());
+          return nullptr;
+        }
+        ic.bursts.push_back(rule);
+      }
+    }
+    if (it.contains("device")) {
+      int d = it["device"].is_string() ? wiq::find_device(*ctx, it["device"].get<std::string>()) : -1;
+      if (d < 0) {
+        wiq::log::log_error(__FILE__, __LINE__, "item '%s' references an unknown device", ic.name.c_str());
+        return nullptr;
+      }
+      ic.device = static_cast<std::size_t>(d);
+    }
     ctx->items.emplace(ic.name, ic);
   }
 
-  // Connect to backend
-  if (ctx->client) {
-    (void)ctx->client->connect();
+  // Resolve triggers once every item is known. A gated item is read only on
+  // behalf of its trigger, which must be polled on the same device.
+  for (auto& kv : ctx->items) {
+    wiq::ItemCfg& ic = kv.second;
+    if (ic.trigger.item.empty()) continue;
+    auto found = ctx->items.find(ic.trigger.item);
+    const wiq::ItemCfg* src = found == ctx->items.end() ? nullptr : &found->second;
+    if (!src || src == &ic || !src->trigger.item.empty() || src->poll_ms <= 0 || !wiq::is_readable(*src) ||
+        src->device != ic.device || ic.poll_ms > 0 || !wiq::is_readable(ic)) {
+      wiq::log::log_error(__FILE__, __LINE__, "item '%s': trigger '%s' must be a polled, ungated item of the same device, "
+                          "and the gated item a readable one without poll_ms", ic.name.c_str(), ic.trigger.item.c_str());
+      return nullptr;
+    }
+    ic.trigger.source = src;
+  }
+  // Rules are evaluated on poll samples: their items and targets must be
+  // polled, on the same device.
+  for (auto& kv : ctx->items) {
+    wiq::ItemCfg& ic = kv.second;
+    if (!ic.bursts.empty() && ic.poll_ms <= 0 && !ic.trigger.source) {
+      wiq::log::log_error(__FILE__, __LINE__, "item '%s': burst rules need a polled or gated item", ic.name.c_str());
+      return nullptr;
+    }
+    for (auto& rule : ic.bursts) {
+      for (const auto& name : rule.items) {
+        auto found = ctx->items.find(name);
+        if (found == ctx->items.end() || found->second.poll_ms <= 0 || found->second.device != ic.device) {
+          wiq::log::log_error(__FILE__, __LINE__, "item '%s': burst target '%s' is not a polled item of the same device",
+                              ic.name.c_str(), name.c_str());
+          return nullptr;
+        }
+        rule.targets.push_back(&found->second);
+      }
+    }
+  }
+
+  // Admission control: a serial line whose polled items need more line time
+  // than it has never catches up; its values go stale one by one.
+  for (const auto& dev : ctx->devices) {
+    const wiq::DeviceLoad load = wiq::estimate_bus_load(*ctx, *dev);
+    if (!load.serial || load.utilization_pct <= ctx->max_utilization_pct) continue;
+    if (ctx->reject_overload) {
+      wiq::log::log_error(__FILE__, __LINE__, "CreateIoInstance: device '%s' poll demand is %.1f%% of the line, limit %.1f%%",
+                          dev->name.c_str(), load.utilization_pct, ctx->max_utilization_pct);
+      return nullptr;
+    }
+    wiq::log::log_warn(__FILE__, __LINE__, "device '%s' poll demand is %.1f%% of the line, limit %.1f%%; see poll.budget",
+                       dev->name.c_str(), load.utilization_pct, ctx->max_utilization_pct);
+  }
+
+  // Connect all devices at once: an unreachable one costs a single timeout
+  // instead of delaying the ones after it.
+  if (ctx->devices.size() == 1) {
+    (void)ctx->devices[0]->client->connect();
+  } else {
+    std::vector<std::thread> connecting;
+    for (auto& dev : ctx->devices) {
+      wiq::IModbusClient* client = dev->client.get();
+      connecting.emplace_back([client]{ (void)client->connect(); });
+    }
+    for (auto& t : connecting) t.join();
+  }
+
+  if (ctx->on_demand.batch_window_us > 0) {
+    for (auto& dev : ctx->devices) dev->batcher.reset(new wiq::ReadBatcher(*ctx, *dev));
+  }
+  if (ctx->on_demand.prefetch.enabled) {
+    for (auto& dev : ctx->devices) dev->prefetcher.reset(new wiq::Prefetcher(*ctx, *dev));
+  }
+
+  if (ctx->poll_enabled) {
+    for (auto& dev : ctx->devices) dev->image.reset(new wiq::ProcessImage(*ctx, *dev));
+  }
+  if (!ctx->shm_name.empty()) {
+    // The exported image is fed by the poll engines.
+    if (!ctx->poll_enabled) {
+      wiq::log::log_error(__FILE__, __LINE__, "CreateIoInstance: shared_memory needs poll.enabled");
+      return nullptr;
+    }
+    ctx->shm = wiq::ShmExport::create(ctx->shm_name, *ctx);
+    if (!ctx->shm) return nullptr;
+  }
+
+  if (ctx->poll_enabled) {
+    for (auto& dev : ctx->devices) {
+      dev->poller = wiq::make_poll_engine(*ctx, *dev);
+      if (dev->poller) dev->poller->start();
+    }
+  }
+  if (ctx->server_cfg.enabled) {
+    // Masters are served from the process images, kept current by polling.
+    if (ctx->server_cfg.mode == wiq::ServerMode::Image && !ctx->poll_enabled) {
+      wiq::log::log_error(__FILE__, __LINE__, "CreateIoInstance: server mode 'image' needs poll.enabled");
+      return nullptr;
+    }
+    ctx->server = wiq::TcpModbusServer::start(*ctx);
+    if (!ctx->server) return nullptr;
   }
 
   return reinterpret_cast<IoHandle>(ctx.release());
@@ -575,155 +832,54 @@ WIQ_IOH_API IoHandle CreateIoInstance(void* /*user_param*/, const char* jsonConf
 WIQ_IOH_API void DestroyIoInstance(IoHandle h) {
   auto* ctx = reinterpret_cast<wiq::IoContext*>(h);
   if (!ctx) return;
-  if (ctx->client) ctx->client->close();
+  ctx->server.reset();
+  for (auto& dev : ctx->devices) {
+    if (dev->poller) dev->poller->stop();
+    if (dev->client) dev->client->close();
+  }
   delete ctx;
 }
 
-WIQ_IOH_API int SubscribeItems(IoHandle h, const char** /*names*/, int /*count*/) {
+WIQ_IOH_API int SubscribeItems(IoHandle h, const char** names, int count) {
   auto* ctx = reinterpret_cast<wiq::IoContext*>(h);
-  if (!ctx) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
-  return 0; // no-op for now
+  // Items without poll_ms stay pull-only; subscribing them is accepted as a no-op.
+  // Each device's engine takes its share of the names in one step.
+  std::vector<std::vector<const wiq::ItemCfg*>> per_device(ctx ? ctx->devices.size() : 0);
+  const int rc = for_each_named_item(ctx, names, count, [&](const wiq::ItemCfg& ic) {
+    per_device[ic.device].push_back(&ic);
+  });
+  for (std::size_t d = 0; d < per_device.size(); ++d) {
+    wiq::Device& dev = *ctx->devices[d];
+    if (dev.poller && !per_device[d].empty()) dev.poller->subscribe(per_device[d]);
+  }
+  return rc;
+}
+
+WIQ_IOH_API int UnsubscribeItems(IoHandle h, const char** names, int count) {
+  auto* ctx = reinterpret_cast<wiq::IoContext*>(h);
+  return for_each_named_item(ctx, names, count, [&](const wiq::ItemCfg& ic) {
+    wiq::Device& dev = ctx->device_of(ic);
+    if (dev.poller) dev.poller->unsubscribe(ic);
+  });
 }
 
-WIQ_IOH_API int UnsubscribeItems(IoHandle h, const char** /*names*/, int /*count*/) {
+WIQ_IOH_API int SetReadCallback(IoHandle h, wiq_read_batch_callback cb, void* user) {
   auto* ctx = reinterpret_cast<wiq::IoContext*>(h);
   if (!ctx) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+  std::lock_guard<std::mutex> lk(ctx->push.mu);
+  ctx->push.cb = cb;
+  ctx->push.user = cb ? user : nullptr;
+  ctx->push.generation += 1;
   return 0;
 }
 
 WIQ_IOH_API int ReadItem(IoHandle h, const char* name, /*out*/char* outJson, int outSize) {
-  auto* ctx = reinterpret_cast<wiq::IoContext*>(h);
-  if (!ctx || !name) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
-  auto it = ctx->items.find(name);
-  if (it == ctx->items.end()) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
-  const wiq::ItemCfg& ic = it->second;
-
-  if (ic.function == 8) {
-    auto snap = diagnostics_snapshot_json(ctx->diagnostics);
-    (void)write_json(outJson, outSize, snap);
-    record_success(ctx);
-    return 0;
-  }
-
-  if (!ctx->client) return static_cast<int>(wiq::ModbusErr::NOT_CONNECTED);
+  return read_item(reinterpret_cast<wiq::IoContext*>(h), name, -1, outJson, outSize);
+}
 
-  if (ic.function == 1) {
-    int count = ic.count > 0 ? ic.count : 1;
-    if (count == 1) {
-      std::uint8_t v = 0; int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_coils(ic.unit_id, ic.address, 1, &v); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      return write_str(outJson, outSize, v ? "true" : "false") ? 0 : 0;
-    } else {
-      std::vector<std::uint8_t> buf(count);
-      int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_coils(ic.unit_id, ic.address, count, buf.data()); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      json arr = json::array();
-      for (int i = 0; i < count; ++i) arr.push_back(buf[i] != 0);
-      return write_str(outJson, outSize, arr.dump()) ? 0 : 0;
-    }
-  }
-  if (ic.function == 2) {
-    int count = ic.count > 0 ? ic.count : 1;
-    if (count == 1) {
-      std::uint8_t v = 0; int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_discrete_inputs(ic.unit_id, ic.address, 1, &v); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      return write_str(outJson, outSize, v ? "true" : "false") ? 0 : 0;
-    } else {
-      std::vector<std::uint8_t> buf(count);
-      int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_discrete_inputs(ic.unit_id, ic.address, count, buf.data()); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      json arr = json::array();
-      for (int i = 0; i < count; ++i) arr.push_back(buf[i] != 0);
-      return write_str(outJson, outSize, arr.dump()) ? 0 : 0;
-    }
-  }
-  if (ic.function == 3) {
-    if (ic.type == "float") {
-      std::uint16_t rr[2] = { static_cast<std::uint16_t>(0), static_cast<std::uint16_t>(0) };
-      int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_holding_regs(ic.unit_id, ic.address, 2, rr); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      std::uint32_t u = wiq::join_u32(rr[0], rr[1], ic.swap_words);
-      float f; std::memcpy(&f, &u, 4);
-      std::string s = std::to_string(static_cast<double>(f));
-      (void)write_str(outJson, outSize, s);
-      return 0;
-    } else if (ic.type == "double") {
-      std::uint16_t rr_dev[4] = { static_cast<std::uint16_t>(0), static_cast<std::uint16_t>(0), static_cast<std::uint16_t>(0), static_cast<std::uint16_t>(0) };
-      int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_holding_regs(ic.unit_id, ic.address, 4, rr_dev); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      std::uint16_t rr_be[4]; wiq::reorder_words4(rr_dev, ic.word_order, rr_be);
-      std::uint64_t u = wiq::join_u64_be(rr_be);
-      double d; std::memcpy(&d, &u, 8);
-      std::string s = std::to_string(d);
-      (void)write_str(outJson, outSize, s);
-      return 0;
-    }
-    int need = ic.count > 0 ? ic.count : 1;
-    if (need == 1) {
-      std::uint16_t r = 0; int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_holding_regs(ic.unit_id, ic.address, 1, &r); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      if (ic.type == "int16") {
-        double val = wiq::apply_scale(static_cast<int16_t>(r), ic.scale, ic.offset);
-        std::string s = std::to_string(val);
-        (void)write_str(outJson, outSize, s);
-      } else {
-        std::string s = std::to_string(static_cast<unsigned>(r));
-        (void)write_str(outJson, outSize, s);
-      }
-      return 0;
-    } else {
-      std::vector<std::uint16_t> rr(need);
-      int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_holding_regs(ic.unit_id, ic.address, need, rr.data()); });
-      if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-      record_success(ctx);
-      json arr = json::array();
-      for (int i = 0; i < need; ++i) arr.push_back(rr[i]);
-      return write_str(outJson, outSize, arr.dump()) ? 0 : 0;
-    }
-  }
-  if (ic.function == 4) {
-    int need = ic.count > 0 ? ic.count : 1; if (need < 1) need = 1;
-    std::vector<std::uint16_t> rr(need);
-    int rc = call_with_reconnect(ctx, [&]{ return ctx->client->read_input_regs(ic.unit_id, ic.address, need, rr.data()); });
-    if (rc != 0) return emit_error_response(ctx, ic, rc, outJson, outSize);
-    record_success(ctx);
-    if (ic.type == "double" && need >= 4) {
-      std::uint16_t rr_be[4] = { rr[0], rr.size()>1?rr[1]:static_cast<std::uint16_t>(0), rr.size()>2?rr[2]:static_cast<std::uint16_t>(0), rr.size()>3?rr[3]:static_cast<std::uint16_t>(0) };
-      // rr is device order already; convert to BE first
-      std::uint16_t rr_dev[4] = { rr_be[0], rr_be[1], rr_be[2], rr_be[3] };
-      std::uint16_t rr_be2[4]; wiq::reorder_words4(rr_dev, ic.word_order, rr_be2);
-      std::uint64_t u = wiq::join_u64_be(rr_be2);
-      double d; std::memcpy(&d, &u, 8);
-      std::string s = std::to_string(d);
-      (void)write_str(outJson, outSize, s);
-      return 0;
-    }
-    if (ic.type == "float") {
-      // interpret first 2 regs as float
-      std::uint32_t u = wiq::join_u32(rr[0], rr.size() > 1 ? rr[1] : 0, ic.swap_words);
-      float f;
-      std::memcpy(&f, &u, 4);
-      std::string s = std::to_string(static_cast<double>(f));
-      (void)write_str(outJson, outSize, s);
-      return 0;
-    } else if (need == 1) {
-      std::string s = std::to_string(static_cast<unsigned>(rr[0]));
-      (void)write_str(outJson, outSize, s);
-      return 0;
-    } else {
-      json arr = json::array();
-      for (int i = 0; i < need; ++i) arr.push_back(rr[i]);
-      return write_str(outJson, outSize, arr.dump()) ? 0 : 0;
-    }
-  }
-  return static_cast<int>(wiq::ModbusErr::UNSUPPORTED);
+WIQ_IOH_API int ReadItemMaxAge(IoHandle h, const char* name, int max_age_ms, /*out*/char* outJson, int outSize) {
+  if (max_age_ms < 0) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+  return read_item(reinterpret_cast<wiq::IoContext*>(h), name, max_age_ms, outJson, outSize);
 }
 
 WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
@@ -733,7 +889,8 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
   if (it == ctx->items.end()) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
   const wiq::ItemCfg& ic = it->second;
   if (ic.function == 8) return static_cast<int>(wiq::ModbusErr::UNSUPPORTED);
-  if (!ctx->client) return static_cast<int>(wiq::ModbusErr::NOT_CONNECTED);
+  wiq::Device& dev = ctx->device_of(ic);
+  if (!dev.client) return static_cast<int>(wiq::ModbusErr::NOT_CONNECTED);
 
   bool broadcast_write = (ic.unit_id == 0) && (ic.function == 5 || ic.function == 6 || ic.function == 15 || ic.function == 16);
   if (broadcast_write && !ic.broadcast_allowed) return static_cast<int>(wiq::ModbusErr::UNSUPPORTED);
@@ -743,10 +900,14 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
 
   auto finalize = [&](int rc) {
     if (rc == 0) {
-      record_success(ctx);
+      wiq::record_success(ctx, &dev);
       if (broadcast_write) ctx->diagnostics.broadcasts_sent += 1;
+      if (dev.poller) dev.poller->invalidate_written(ic);
+      if (dev.prefetcher) dev.prefetcher->invalidate();
+      dev.cache->invalidate();
+      dev.coalescer->invalidate();
     } else {
-      record_error(ctx, ic, rc);
+      wiq::record_error(ctx, ic, rc);
     }
     return rc;
   };
@@ -756,7 +917,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
     if (v.is_boolean()) on = v.get<bool>();
     else if (v.is_number_integer()) on = (v.get<int>() != 0);
     else return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
-    return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_single_coil(ic.unit_id, ic.address, on); }));
+    return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_single_coil(ic.unit_id, ic.address, on); }));
   }
 
   if (ic.function == 3) {
@@ -766,7 +927,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
       std::uint32_t u; std::memcpy(&u, &f, 4);
       std::uint16_t hi, lo; wiq::split_u32(u, ic.swap_words, hi, lo);
       std::uint16_t rr[2] = {hi, lo};
-      return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_multiple_regs(ic.unit_id, ic.address, 2, rr); }));
+      return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_multiple_regs(ic.unit_id, ic.address, 2, rr); }));
     }
     double d = 0.0;
     if (v.is_number()) d = v.get<double>(); else return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
@@ -774,7 +935,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
     double rawd = wiq::unscale(d, ic.scale, ic.offset);
     int32_t rawi = static_cast<int32_t>(llround(rawd));
     std::uint16_t reg = static_cast<std::uint16_t>(static_cast<int16_t>(rawi));
-    return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_single_reg(ic.unit_id, ic.address, reg); }));
+    return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_single_reg(ic.unit_id, ic.address, reg); }));
   }
 
   if (ic.function == 5) {
@@ -782,7 +943,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
     if (v.is_boolean()) on = v.get<bool>();
     else if (v.is_number_integer()) on = (v.get<int>() != 0);
     else return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
-    return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_single_coil(ic.unit_id, ic.address, on); }));
+    return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_single_coil(ic.unit_id, ic.address, on); }));
   }
   if (ic.function == 15) {
     if (!v.is_array()) return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
@@ -796,7 +957,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
       else if (e.is_number_integer()) buf[i] = (e.get<int>() != 0) ? 1 : 0;
       else return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
     }
-    return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_multiple_coils(ic.unit_id, ic.address, count, buf.data()); }));
+    return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_multiple_coils(ic.unit_id, ic.address, count, buf.data()); }));
   }
 
   if (ic.function == 6 && ic.type != std::string("float")) {
@@ -805,7 +966,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
     double rawd = wiq::unscale(d, ic.scale, ic.offset);
     int32_t rawi = static_cast<int32_t>(llround(rawd));
     std::uint16_t reg = static_cast<std::uint16_t>(static_cast<int16_t>(rawi));
-    return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_single_reg(ic.unit_id, ic.address, reg); }));
+    return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_single_reg(ic.unit_id, ic.address, reg); }));
   }
 
   if (ic.function == 16 || (ic.function == 6 && ic.type == std::string("float"))) {
@@ -816,13 +977,13 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
         std::uint64_t u; std::memcpy(&u, &dv, 8);
         std::uint16_t rr_be[4]; wiq::split_u64_be(u, rr_be);
         std::uint16_t rr_dev[4]; wiq::reorder_words4(rr_be, ic.word_order, rr_dev);
-        return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_multiple_regs(ic.unit_id, ic.address, 4, rr_dev); }));
+        return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_multiple_regs(ic.unit_id, ic.address, 4, rr_dev); }));
       }
       float f = static_cast<float>(dv);
       std::uint32_t u; std::memcpy(&u, &f, 4);
       std::uint16_t hi, lo; wiq::split_u32(u, ic.swap_words, hi, lo);
       std::uint16_t rr[2] = {hi, lo};
-      return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_multiple_regs(ic.unit_id, ic.address, 2, rr); }));
+      return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_multiple_regs(ic.unit_id, ic.address, 2, rr); }));
     }
     if (v.is_array()) {
       int count = static_cast<int>(v.size()); if (count <= 0) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
@@ -834,7 +995,7 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
         if (x < 0 || x > 65535) return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
         regs[i] = static_cast<std::uint16_t>(x);
       }
-      return finalize(call_with_reconnect(ctx, [&]{ return ctx->client->write_multiple_regs(ic.unit_id, ic.address, count, regs.data()); }));
+      return finalize(call_with_reconnect(ctx, dev, wiq::BusLane::Write, [&]{ return dev.client->write_multiple_regs(ic.unit_id, ic.address, count, regs.data()); }));
     }
     return static_cast<int>(wiq::ModbusErr::PARSE_ERROR);
   }
@@ -843,16 +1004,29 @@ WIQ_IOH_API int WriteItem(IoHandle h, const char* name, const char* valueJson) {
 }
 
 WIQ_IOH_API int CallMethod(IoHandle h, const char* method, const char* paramsJson, /*out*/char* outJson, int outSize) {
-  (void)paramsJson;
   auto* ctx = reinterpret_cast<wiq::IoContext*>(h);
   if (!ctx || !method) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
   std::string m(method);
   if (m == "connection.reconnect") {
-    if (ctx->client) {
-      ctx->client->close();
-      int rc = ctx->client->connect();
-      if (rc != 0) return rc;
+    // Optional {"device": "<name>"} limits the reconnect to one device.
+    int only = -1;
+    if (paramsJson && *paramsJson) {
+      nlohmann::json p = nlohmann::json::parse(paramsJson, nullptr, false);
+      if (p.is_object() && p.contains("device")) {
+        only = p["device"].is_string() ? wiq::find_device(*ctx, p["device"].get<std::string>()) : -1;
+        if (only < 0) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+      }
     }
+    int result = 0;
+    for (std::size_t i = 0; i < ctx->devices.size(); ++i) {
+      if (only >= 0 && static_cast<int>(i) != only) continue;
+      wiq::Device& dev = *ctx->devices[i];
+      wiq::BusLock bus_lock(dev.bus, wiq::BusLane::Write);
+      dev.client->close();
+      int rc = dev.client->connect();
+      if (rc != 0 && result == 0) result = rc;
+    }
+    if (result != 0) return result;
     if (outJson) (void)std::snprintf(outJson, outSize, "{\"ok\":true}");
     return 0;
   }
@@ -862,12 +1036,121 @@ WIQ_IOH_API int CallMethod(IoHandle h, const char* method, const char* paramsJso
   }
   if (m == "diagnostics.reset") {
     ctx->diagnostics.reset();
+    for (auto& dev : ctx->devices) {
+      dev->diagnostics.reset();
+      if (dev->poller) dev->poller->reset_stats();
+    }
     if (outJson) (void)std::snprintf(outJson, outSize, "{\"reset\":true}");
     return 0;
   }
+  if (m == "poll.plan") {
+    if (outJson) {
+      nlohmann::json groups = nlohmann::json::array();
+      for (auto& dev : ctx->devices) {
+        if (!dev->poller) continue;
+        nlohmann::json plan = dev->poller->plan_json();
+        for (auto& g : plan["groups"]) groups.push_back(std::move(g));
+      }
+      nlohmann::json payload{{"groups", std::move(groups)}};
+      (void)write_json(outJson, outSize, payload);
+    }
+    return 0;
+  }
+  if (m == "poll.rates") {
+    if (outJson) {
+      nlohmann::json items = nlohmann::json::array();
+      for (auto& dev : ctx->devices) {
+        if (!dev->poller) continue;
+        for (auto& it : dev->poller->rates_json()) items.push_back(std::move(it));
+      }
+      nlohmann::json payload{{"items", std::move(items)}};
+      (void)write_json(outJson, outSize, payload);
+    }
+    return 0;
+  }
+  if (m == "poll.budget") {
+    if (outJson) (void)write_json(outJson, outSize, bus_budget_json(*ctx));
+    return 0;
+  }
+  if (m == "cache.peek") {
+    // {"items": [...]}: cached values with their age; never reads the bus.
+    nlohmann::json p = nlohmann::json::parse(paramsJson ? paramsJson : "", nullptr, false);
+    if (!p.is_object() || !p.contains("items") || !p["items"].is_array()) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+    nlohmann::json items = nlohmann::json::array();
+    const auto now = wiq::ValueCache::clock::now();
+    for (const auto& n : p["items"]) {
+      if (!n.is_string()) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+      auto it = ctx->items.find(n.get<std::string>());
+      if (it == ctx->items.end()) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+      const wiq::ItemCfg& ic = it->second;
+      nlohmann::json entry{{"name", ic.name}, {"value", nullptr}};
+      wiq::ValueCache::Value v;
+      if (ic.function != 8 && ctx->device_of(ic).cache->peek(ic, v)) {
+        entry["value"] = nlohmann::json::parse(v.json, nullptr, false);
+        entry["age_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(now - v.at).count();
+        entry["timestamp"] = utc_timestamp(v.timestamp);
+      }
+      items.push_back(std::move(entry));
+    }
+    if (outJson) (void)write_json(outJson, outSize, nlohmann::json{{"items", std::move(items)}});
+    return 0;
+  }
+  if (m == "image.read") {
+    // {"items": [...]} decodes items; {"device"?, "unit", "function",
+    // "address", "count"} copies a raw range. Never reads the bus.
+    nlohmann::json p = nlohmann::json::parse(paramsJson ? paramsJson : "", nullptr, false);
+    if (!p.is_object()) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+    const auto now = wiq::ProcessImage::clock::now();
+    auto age_ms = [&](const wiq::ProcessImage::Stamp& st) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(now - st.at).count();
+    };
+    nlohmann::json payload;
+    if (p.contains("items")) {
+      if (!p["items"].is_array()) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+      nlohmann::json items = nlohmann::json::array();
+      for (const auto& n : p["items"]) {
+        if (!n.is_string()) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+        auto it = ctx->items.find(n.get<std::string>());
+        if (it == ctx->items.end()) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+        const wiq::ItemCfg& ic = it->second;
+        nlohmann::json entry{{"name", ic.name}, {"value", nullptr}};
+        const wiq::ProcessImage* image = ic.function == 8 ? nullptr : ctx->device_of(ic).image.get();
+        wiq::RawValue raw;
+        wiq::ProcessImage::Stamp st;
+        if (image && image->read_item(ic, raw, st)) {
+          entry["value"] = nlohmann::json::parse(wiq::format_value(ic, raw), nullptr, false);
+          entry["generation"] = st.generation;
+          entry["age_ms"] = age_ms(st);
+        }
+        items.push_back(std::move(entry));
+      }
+      payload["items"] = std::move(items);
+    } else {
+      int d = 0;
+      if (p.contains("device")) {
+        d = p["device"].is_string() ? wiq::find_device(*ctx, p["device"].get<std::string>()) : -1;
+        if (d < 0) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+      }
+      const int unit = p.value("unit", -1);
+      const int fn = p.value("function", 0);
+      const int address = p.value("address", -1);
+      const int count = p.value("count", 1);
+      if (unit < 0 || fn < 1 || fn > 4 || address < 0 || count < 1) return static_cast<int>(wiq::ModbusErr::INVALID_ARG);
+      const wiq::ProcessImage* image = ctx->devices[static_cast<std::size_t>(d)]->image.get();
+      wiq::RawValue raw;
+      wiq::ProcessImage::Stamp st;
+      if (!image || !image->read(unit, fn, address, count, raw, st)) return static_cast<int>(wiq::ModbusErr::NOT_FOUND);
+      nlohmann::json values = nlohmann::json::array();
+      if (fn == 1 || fn == 2) for (auto b : raw.bits) values.push_back(b != 0);
+      else for (auto w : raw.words) values.push_back(w);
+      payload = {{"values", std::move(values)}, {"generation", st.generation}, {"age_ms", age_ms(st)}};
+    }
+    if (outJson) (void)write_json(outJson, outSize, payload);
+    return 0;
+  }
   if (m == "diagnostics.snapshot") {
     if (outJson) {
-      auto payload = diagnostics_snapshot_json(ctx->diagnostics);
+      auto payload = diagnostics_snapshot_json(*ctx);
       (void)write_json(outJson, outSize, payload);
     }
     return 0;
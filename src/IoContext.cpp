@@ -0,0 +1,134 @@
+#include "IoContext.hpp"
+#include "ModbusError.hpp"
+#include "Prefetcher.hpp"
+#include "ProcessImage.hpp"
+#include "ReadCoalescer.hpp"
+#include "ReadBatcher.hpp"
+#include "ShmExport.hpp"
+#include "ValueCache.hpp"
+#include "poll/PollEngine.hpp"
+#include "modbus/TcpModbusServer.hpp"
+#include "log.hpp"
+#include <cstdint>
+#include <thread>
+
+namespace wiq {
+
+Device::Device() : cache(new ValueCache), coalescer(new ReadCoalescer) {}
+
+Device::~Device() {
+  // The engine thread uses `client`; stop it before members are torn down.
+  poller.reset();
+}
+
+IoContext::IoContext() {}
+
+IoContext::~IoContext() {
+  // The server reads the images and holds subscriptions on the engines.
+  server.reset();
+  // Engines report into the shared diagnostics and push target.
+  for (auto& dev : devices) dev->poller.reset();
+}
+
+void BusArbiter::lock(BusLane lane) {
+  const int l = static_cast<int>(lane);
+  std::unique_lock<std::mutex> lk(mu_);
+  waiting_[l] += 1;
+  cv_.wait(lk, [&] {
+    if (busy_) return false;
+    for (int i = 0; i < l; ++i) if (waiting_[i] > 0) return false;
+    return true;
+  });
+  waiting_[l] -= 1;
+  busy_ = true;
+}
+
+void BusArbiter::unlock() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    busy_ = false;
+  }
+  cv_.notify_all();
+}
+
+int call_with_reconnect(IoContext* ctx, Device& dev, BusLane lane, const std::function<int()>& op) {
+  const auto queued = std::chrono::steady_clock::now();
+  BusLock bus_lock(dev.bus, lane);
+  if (lane == BusLane::Write) {
+    auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queued);
+    dev.diagnostics.record_write_wait(static_cast<std::uint64_t>(waited.count()));
+  }
+  int rc = op();
+  if (!dev.client) return rc;
+  const int NOT_CONNECTED_RC = static_cast<int>(ModbusErr::NOT_CONNECTED);
+  if (rc != NOT_CONNECTED_RC) return rc;
+
+  int attempts = dev.reconnect_retries;
+  if (attempts <= 0) return rc;
+
+  using namespace std::chrono;
+  double backoff = (dev.reconnect_backoff < 1.0) ? 1.0 : dev.reconnect_backoff;
+  int wait_ms = (dev.reconnect_interval_ms < 0) ? 0 : dev.reconnect_interval_ms;
+  int max_ms = (dev.reconnect_max_interval_ms < 0) ? 0 : dev.reconnect_max_interval_ms;
+
+  log::log_debug(__FILE__, __LINE__,
+                 "device '%s' NOT_CONNECTED -> reconnect policy: retries=%d interval_ms=%d backoff=%.2f cap=%d",
+                 dev.name.c_str(), attempts, wait_ms, backoff, max_ms);
+  for (int attempt = 1; attempt <= attempts; ++attempt) {
+    if (wait_ms > 0) {
+      log::log_trace(__FILE__, __LINE__, "reconnect attempt %d/%d: sleep %d ms", attempt, attempts, wait_ms);
+      std::this_thread::sleep_for(milliseconds(wait_ms));
+    } else {
+      log::log_trace(__FILE__, __LINE__, "reconnect attempt %d/%d: no wait", attempt, attempts);
+    }
+    if (ctx) ctx->diagnostics.retries += 1;
+    dev.diagnostics.reconnects += 1;
+    (void)dev.client->connect();
+    rc = op();
+    if (rc != NOT_CONNECTED_RC) {
+      log::log_debug(__FILE__, __LINE__, "reconnect attempt %d/%d: operation returned %d", attempt, attempts, rc);
+      return rc; // success or different error
+    }
+
+    // prepare next wait with backoff
+    if (wait_ms > 0) {
+      double next = wait_ms * backoff;
+      if (next > static_cast<double>(INT32_MAX)) next = static_cast<double>(INT32_MAX);
+      int next_ms = static_cast<int>(next);
+      if (max_ms > 0 && next_ms > max_ms) next_ms = max_ms;
+      wait_ms = next_ms;
+    }
+  }
+  log::log_warn(__FILE__, __LINE__, "all reconnect attempts failed with NOT_CONNECTED");
+  return rc;
+}
+
+void record_success(IoContext* ctx, Device* dev) {
+  if (ctx) ctx->diagnostics.operations += 1;
+  if (dev) dev->diagnostics.operations += 1;
+}
+
+void record_error(IoContext* ctx, Device* dev, int function, int unit, int rc) {
+  if (dev) {
+    dev->diagnostics.operations += 1;
+    dev->diagnostics.errors += 1;
+    if (rc == static_cast<int>(ModbusErr::IO_TIMEOUT)) dev->diagnostics.timeouts += 1;
+  }
+  if (!ctx) return;
+  ctx->diagnostics.operations += 1;
+  if (rc == static_cast<int>(ModbusErr::IO_TIMEOUT)) ctx->diagnostics.timeouts += 1;
+  else if (rc == static_cast<int>(ModbusErr::IO_ERROR)) ctx->diagnostics.io_errors += 1;
+  else if (rc == static_cast<int>(ModbusErr::INVALID_ARG)) ctx->diagnostics.invalid_args += 1;
+  else if (rc == static_cast<int>(ModbusErr::UNSUPPORTED)) ctx->diagnostics.unsupported += 1;
+  else if (rc == static_cast<int>(ModbusErr::CRC_ERROR)) ctx->diagnostics.crc_errors += 1;
+  else if (rc == static_cast<int>(ModbusErr::LRC_ERROR)) ctx->diagnostics.lrc_errors += 1;
+
+  if (is_modbus_exception(rc)) {
+    auto code = decode_modbus_exception(rc);
+    ctx->diagnostics.record_exception({function, unit, code, modbus_exception_to_string(code), std::chrono::system_clock::now()});
+    if (code == 4) ctx->diagnostics.io_errors += 1;
+    if (code == 3) ctx->diagnostics.invalid_args += 1;
+  }
+}
+
+} // namespace wiq
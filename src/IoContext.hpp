@@ -0,0 +1,412 @@
+#pragma once
+
+#include "IModbusClient.hpp"
+#include "AsciiModbusClient.hpp"
+#include "RtuModbusClient.hpp"
+#include "ModbusPush.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wiq {
+
+class PollEngine;
+class ReadBatcher;
+class Prefetcher;
+class ProcessImage;
+class ReadCoalescer;
+class ShmExport;
+class TcpModbusServer;
+class ValueCache;
+
+// Poll priority class of an item; under overload (see ShedCfg) background
+// items are stretched and dropped first, then normal ones, realtime never.
+enum class PollPriority { Realtime = 0, Normal = 1, Background = 2 };
+
+// Opt-in adaptive rate of a polled item (`adaptive` in the item config).
+// An item whose value holds still backs off toward `max_poll_ms`; one that
+// changes returns to its `poll_ms`.
+struct AdaptivePollCfg {
+  int max_poll_ms{0};   // 0: fixed rate
+  int stable_polls{5};  // unchanged samples in a row before the period doubles
+  int change_polls{1};  // changes, with no stable run in between, that restore poll_ms
+};
+
+// Trigger gating of an item (`trigger` in the item config). Gated items are
+// not polled on a period of their own: their blocks are read after a sample
+// of the trigger item shows a change (Change, e.g. a "data changed" counter)
+// or a non-zero value (Gate, e.g. an enable bit).
+enum class TriggerMode { Change, Gate };
+
+struct ItemCfg;
+
+struct TriggerCfg {
+  std::string item;                // name of the trigger item; empty: not gated
+  TriggerMode mode{TriggerMode::Change};
+  const ItemCfg* source{nullptr};  // resolved `item`, same device
+};
+
+// Burst rule of an item (`burst` in the item config). When the item's
+// decoded value changes (Change) or starts to satisfy the comparison with
+// `value`, the subscribed `targets` are polled every `poll_ms` for the next
+// `duration_ms`; a later activation extends the window. Targets may carry
+// rules of their own, so bursts chain.
+struct BurstRule {
+  enum class When { Change, Eq, Ne, Gt, Ge, Lt, Le };
+  When when{When::Change};
+  double value{0.0};
+  std::vector<std::string> items;
+  std::vector<const ItemCfg*> targets;  // resolved `items`, same device
+  int poll_ms{0};
+  int duration_ms{0};
+};
+
+struct ItemCfg {
+  std::string name;
+  int unit_id{};
+  int function{}; // 1/2/3/4/5/6/8/15/16
+  int address{};
+  int count{1};
+  std::string type; // bool|int16|uint16|int32|uint32|float|double
+  double scale{1.0};
+  double offset{0.0};
+  bool swap_words{false};
+  int poll_ms{0};
+  AdaptivePollCfg adaptive{};
+  PollPriority priority{PollPriority::Normal};
+  TriggerCfg trigger{};
+  std::vector<BurstRule> bursts;
+  int cache_ttl_ms{-1};  // ReadItem serves values this fresh from the ValueCache; -1: on_demand.cache_ttl_ms
+  std::string word_order{"ABCD"}; // for 64-bit (double): ABCD|BADC|CDAB|DCBA
+  bool broadcast_allowed{false};
+  std::size_t device{0};  // index into IoContext::devices
+};
+
+// Limits used when coalescing polled items into block reads.
+struct BlockPlanCfg {
+  int max_gap{0};            // unused registers tolerated between merged FC3/FC4 items
+  int max_gap_bits{0};       // unused bits tolerated between merged FC1/FC2 items
+  int max_block_regs{125};   // capped at the protocol limit of 125
+  int max_block_bits{2000};  // capped at the protocol limit of 2000
+  int max_transaction_ms{0}; // serial bus time allowed per block read; 0 means unlimited
+};
+
+// Poll period handling shared by all devices.
+struct PollPeriodCfg {
+  int harmonic_base_ms{0};  // snap periods down to base * 2^k; 0 keeps them as configured
+  bool stagger{true};       // spread group releases across their period
+
+  int quantize(int period_ms) const {
+    if (harmonic_base_ms <= 0 || period_ms <= 0) return period_ms;
+    int p = harmonic_base_ms;
+    while (p > period_ms && p > 1) p /= 2;
+    while (p <= period_ms / 2) p *= 2;
+    return p;
+  }
+};
+
+// Neighbourhood prefetch of on-demand reads (`on_demand.prefetch`).
+struct PrefetchCfg {
+  bool enabled{false};
+  int max_gap{0};    // unused registers/bits tolerated between the read item and a neighbour
+  int ttl_ms{500};   // how long prefetched values are served
+};
+
+// Handling of on-demand reads (top-level `on_demand`).
+struct OnDemandCfg {
+  int batch_window_us{0};  // collect concurrent ReadItem calls this long, then read them as blocks; 0 disables
+  int cache_ttl_ms{0};     // default read-through TTL of ReadItem; 0 always reads the bus
+  PrefetchCfg prefetch{};
+};
+
+// What the embedded Modbus TCP server does with FC5/6/15/16 requests.
+enum class ServerWrites {
+  Forward,  // perform the write on the device, then answer with its result
+  Queue,    // answer at once and perform the write in the background
+  Reject,   // answer with exception 01 (illegal function)
+};
+
+// Where the embedded Modbus TCP server takes FC1-4 answers from.
+enum class ServerMode {
+  Image,  // the process image, kept current by polling
+  Proxy,  // the device, one transaction per distinct request in flight
+};
+
+// Embedded Modbus TCP server (top-level `server`).
+struct ServerCfg {
+  bool enabled{false};
+  ServerMode mode{ServerMode::Image};
+  std::string bind{"0.0.0.0"};
+  int port{502};             // 0 picks a free port
+  int max_clients{64};
+  int max_age_ms{0};         // older image data is answered with exception 0B; 0 accepts any age
+  int device{-1};            // device serving every unit id; -1 routes by the items' unit ids
+  ServerWrites writes{ServerWrites::Forward};
+  int write_queue{256};      // writes waiting for the bus; more are answered with exception 06
+  bool subscribe{true};      // image: keep every polled item subscribed while the server runs
+  int cache_ms{0};           // proxy: reuse a device response this long; 0 disables
+  int read_queue{256};       // proxy: distinct reads waiting per device; more are answered with exception 06
+};
+
+// Runtime overload shedding. A poll cycle (release to last block read) that
+// takes longer than `cycle_target_pct` of its period raises the device's
+// shed level by one per window; three windows in a row with every cycle
+// under half the target lower it again.
+struct ShedCfg {
+  int cycle_target_pct{0};  // 0 disables shedding
+  int window_ms{1000};
+};
+
+// Per-unit poll scheduling knobs (shared serial lines).
+struct UnitBackoffCfg {
+  int base_ms{200};   // hold-off after a unit's first consecutive timeout; 0 disables
+  int max_ms{5000};   // cap for the doubling hold-off
+};
+
+// Per-unit poll health, keyed by unit id in DiagnosticsState::units.
+struct UnitDiagnostics {
+  std::uint64_t deadline_misses{0};
+  std::uint64_t backoffs{0};
+};
+
+struct ExceptionLogEntry {
+  int function{};
+  int unit{};
+  std::uint8_t exception{};
+  std::string message;
+  std::chrono::system_clock::time_point timestamp;
+};
+
+// Counters are atomic because the poll engine updates them from its own thread
+// while API calls do the same from the host's threads.
+struct DiagnosticsState {
+  std::atomic<std::uint64_t> operations{0};
+  std::atomic<std::uint64_t> retries{0};
+  std::atomic<std::uint64_t> io_errors{0};
+  std::atomic<std::uint64_t> timeouts{0};
+  std::atomic<std::uint64_t> invalid_args{0};
+  std::atomic<std::uint64_t> unsupported{0};
+  std::atomic<std::uint64_t> broadcasts_sent{0};
+  std::atomic<std::uint64_t> crc_errors{0};
+  std::atomic<std::uint64_t> lrc_errors{0};
+  std::atomic<std::uint64_t> poll_cycles{0};
+  std::atomic<std::uint64_t> poll_overruns{0};
+  std::atomic<std::uint64_t> deadline_misses{0};
+  std::atomic<std::uint64_t> adaptive_slowdowns{0};
+  std::atomic<std::uint64_t> adaptive_speedups{0};
+  std::atomic<std::uint64_t> shed_normal{0};      // normal-priority block reads skipped under overload
+  std::atomic<std::uint64_t> shed_background{0};  // same for background blocks
+  std::atomic<std::uint64_t> trigger_fires{0};    // trigger samples that released their gated blocks
+  std::atomic<std::uint64_t> trigger_holds{0};    // trigger samples that left them unread
+  std::atomic<std::uint64_t> burst_activations{0};
+  std::atomic<std::uint64_t> burst_bus_us{0};     // bus time of burst reads beyond the normal rate
+  std::atomic<std::uint64_t> server_requests{0};   // Modbus TCP server: requests answered
+  std::atomic<std::uint64_t> server_exceptions{0}; // answered with an exception
+  std::atomic<std::uint64_t> server_writes{0};     // writes performed on a device for a master
+  std::atomic<std::uint64_t> server_downstream{0}; // proxy: reads performed on a device
+  std::atomic<std::uint64_t> server_coalesced{0};  // proxy: reads answered by another master's read
+  std::atomic<std::uint64_t> server_cache_hits{0}; // proxy: reads answered from the response cache
+  mutable std::mutex exceptions_mu;
+  std::deque<ExceptionLogEntry> recent_exceptions;
+  void record_exception(const ExceptionLogEntry& e) {
+    std::lock_guard<std::mutex> lk(exceptions_mu);
+    recent_exceptions.push_front(e);
+    while (recent_exceptions.size() > 50) recent_exceptions.pop_back();
+  }
+  void reset() {
+    operations = retries = io_errors = timeouts = invalid_args = unsupported = broadcasts_sent = crc_errors = lrc_errors = 0;
+    poll_cycles = poll_overruns = deadline_misses = 0;
+    adaptive_slowdowns = adaptive_speedups = shed_normal = shed_background = 0;
+    trigger_fires = trigger_holds = burst_activations = burst_bus_us = 0;
+    server_requests = server_exceptions = server_writes = 0;
+    server_downstream = server_coalesced = server_cache_hits = 0;
+    std::lock_guard<std::mutex> lk(exceptions_mu);
+    recent_exceptions.clear();
+  }
+};
+
+// Per-device share of the diagnostics; the instance totals stay in
+// DiagnosticsState.
+struct DeviceDiagnostics {
+  std::atomic<std::uint64_t> operations{0};
+  std::atomic<std::uint64_t> errors{0};
+  std::atomic<std::uint64_t> timeouts{0};
+  std::atomic<std::uint64_t> reconnects{0};
+  std::atomic<int> shed_level{0};  // current overload shedding level, 0 = none
+  // On-demand reads through the ReadBatcher and the transactions they took.
+  std::atomic<std::uint64_t> batched_reads{0};
+  std::atomic<std::uint64_t> batch_transactions{0};
+  // Prefetch: reads served from prefetched values, reads that went to the
+  // bus, and neighbour values stored.
+  std::atomic<std::uint64_t> prefetch_hits{0};
+  std::atomic<std::uint64_t> prefetch_misses{0};
+  std::atomic<std::uint64_t> prefetched{0};
+  // ValueCache: reads served within their max age, and reads that shared
+  // another caller's transaction.
+  std::atomic<std::uint64_t> cache_hits{0};
+  std::atomic<std::uint64_t> shared_reads{0};
+  // ReadCoalescer: bus reads answered by an identical read already in flight.
+  // Counted only for callers that did not already share at the ValueCache
+  // (`shared_reads`) or proxy (`server_coalesced`) layer above it.
+  std::atomic<std::uint64_t> coalesced_reads{0};
+  // ProcessImage: segment reads repeated because a poll write overlapped.
+  std::atomic<std::uint64_t> image_retries{0};
+  // Queue-to-wire latency of writes: from WriteItem until the bus is granted.
+  std::atomic<std::uint64_t> writes{0};
+  std::atomic<std::uint64_t> write_wait_us_total{0};
+  std::atomic<std::uint64_t> write_wait_us_max{0};
+  std::atomic<std::uint64_t> write_wait_us_last{0};
+  mutable std::mutex units_mu;
+  std::map<int, UnitDiagnostics> units;
+  void record_deadline_miss(int unit) {
+    std::lock_guard<std::mutex> lk(units_mu);
+    units[unit].deadline_misses += 1;
+  }
+  void record_backoff(int unit) {
+    std::lock_guard<std::mutex> lk(units_mu);
+    units[unit].backoffs += 1;
+  }
+  void record_write_wait(std::uint64_t us) {
+    writes += 1;
+    write_wait_us_total += us;
+    write_wait_us_last = us;
+    std::uint64_t prev = write_wait_us_max.load();
+    while (us > prev && !write_wait_us_max.compare_exchange_weak(prev, us)) {}
+  }
+  void reset() {
+    operations = errors = timeouts = reconnects = 0;
+    writes = write_wait_us_total = write_wait_us_max = write_wait_us_last = 0;
+    batched_reads = batch_transactions = 0;
+    prefetch_hits = prefetch_misses = prefetched = 0;
+    cache_hits = shared_reads = 0;
+    coalesced_reads = 0;
+    image_retries = 0;
+    std::lock_guard<std::mutex> lk(units_mu);
+    units.clear();
+  }
+};
+
+// Host callback registered via SetReadCallback. `mu` is held while the
+// callback runs so that clearing it waits for an in-flight delivery.
+struct PushTarget {
+  std::mutex mu;
+  wiq_read_batch_callback cb{nullptr};
+  void* user{nullptr};
+  std::atomic<std::uint64_t> generation{0};  // bumped on every registration
+};
+
+// Urgency of a transaction on a device's bus; lower values go first.
+enum class BusLane { Write = 0, OnDemand = 1, Poll = 2 };
+
+// Serializes every call on a device's client. Unlike a plain mutex it hands
+// the bus to the most urgent waiter: a write queued behind a poll cycle goes
+// out after the transaction in flight instead of after the whole cycle.
+class BusArbiter {
+public:
+  void lock(BusLane lane);
+  void unlock();
+
+private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool busy_{false};
+  int waiting_[3]{};
+};
+
+class BusLock {
+public:
+  BusLock(BusArbiter& bus, BusLane lane) : bus_(bus) { bus_.lock(lane); }
+  ~BusLock() { bus_.unlock(); }
+  BusLock(const BusLock&) = delete;
+  BusLock& operator=(const BusLock&) = delete;
+
+private:
+  BusArbiter& bus_;
+};
+
+// One Modbus endpoint of an instance. Each device owns its transport,
+// connection, reconnect policy and poll thread, so a device that stops
+// answering only holds up requests addressed to it.
+struct Device {
+  Device();
+  ~Device();
+
+  std::string name;
+  std::unique_ptr<IModbusClient> client;
+  BusArbiter bus;                      // serializes every call on `client`
+  // tcp config
+  std::string host; int port{1502}; int timeout_ms{1000};
+  std::string tcp_backend{"auto"};     // auto|native|libmodbus|stub
+  int pipeline_window{1};              // poll reads kept in flight per connection (native TCP)
+  // transport
+  std::string transport; // tcp|rtu|ascii
+  bool has_ascii_cfg{false};
+  AsciiConfig ascii_cfg{};
+  std::string ascii_backend{"serial"}; // serial|stub
+  RtuConfig rtu_cfg{};
+  // reconnect policy
+  int reconnect_retries{1};            // number of reconnect attempts upon NOT_CONNECTED
+  int reconnect_interval_ms{0};        // base wait before each reconnect attempt
+  double reconnect_backoff{1.0};       // multiplier applied after each attempt (>=1.0)
+  int reconnect_max_interval_ms{0};    // optional cap; 0 means uncapped
+  // background polling of this device's items with poll_ms > 0
+  std::unique_ptr<PollEngine> poller;
+  // merges concurrent on-demand reads; set when on_demand.batch_window_us > 0
+  std::unique_ptr<ReadBatcher> batcher;
+  // widens on-demand reads to their neighbours; set when on_demand.prefetch is on
+  std::unique_ptr<Prefetcher> prefetcher;
+  // last good value of every item read from the bus
+  std::unique_ptr<ValueCache> cache;
+  // shares identical bus reads that overlap in time
+  std::unique_ptr<ReadCoalescer> coalescer;
+  // register/bit image published by the poll engine; set when polling is on
+  std::unique_ptr<ProcessImage> image;
+  DeviceDiagnostics diagnostics;
+};
+
+struct IoContext {
+  IoContext();
+  ~IoContext();
+
+  std::unordered_map<std::string, ItemCfg> items;
+  // Devices in configuration order; a config without a `devices` section
+  // has a single device named "default".
+  std::vector<std::unique_ptr<Device>> devices;
+  Device& device_of(const ItemCfg& ic) { return *devices[ic.device]; }
+  // polling knobs shared by all devices
+  bool poll_enabled{true};
+  BlockPlanCfg block_plan{};
+  PollPeriodCfg poll_periods{};
+  ShedCfg shed{};
+  OnDemandCfg on_demand{};
+  UnitBackoffCfg unit_backoff{};
+  double max_utilization_pct{100.0};   // serial scan demand checked at load (see BusBudget)
+  bool reject_overload{false};         // poll.admission "reject": refuse instead of warn
+  PushTarget push;
+  std::string shm_name;             // shared_memory.name; empty: no shared-memory export
+  std::unique_ptr<ShmExport> shm;   // mirror of the devices' process images
+  ServerCfg server_cfg{};
+  std::unique_ptr<TcpModbusServer> server;
+  DiagnosticsState diagnostics;
+};
+
+// Perform a Modbus client operation holding the device's bus in `lane`; if
+// NOT_CONNECTED, reconnect according to the device's policy and retry.
+int call_with_reconnect(IoContext* ctx, Device& dev, BusLane lane, const std::function<int()>& op);
+
+void record_success(IoContext* ctx, Device* dev);
+void record_error(IoContext* ctx, Device* dev, int function, int unit, int rc);
+inline void record_error(IoContext* ctx, const ItemCfg& ic, int rc) {
+  record_error(ctx, ctx ? &ctx->device_of(ic) : nullptr, ic.function, ic.unit_id, rc);
+}
+
+} // namespace wiq
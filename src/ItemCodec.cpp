@@ -0,0 +1,149 @@
+#include "ItemCodec.hpp"
+#include "ModbusError.hpp"
+#include "ReadCoalescer.hpp"
+#include <nlohmann/json.hpp>
+#include <cstring>
+
+namespace wiq {
+
+std::uint32_t join_u32(std::uint16_t hi, std::uint16_t lo, bool swap_words) {
+  return swap_words ? (std::uint32_t(lo) << 16) | hi
+                    : (std::uint32_t(hi) << 16) | lo;
+}
+
+void split_u32(std::uint32_t v, bool swap_words, std::uint16_t& hi, std::uint16_t& lo) {
+  std::uint16_t h = std::uint16_t((v >> 16) & 0xFFFF);
+  std::uint16_t l = std::uint16_t(v & 0xFFFF);
+  if (swap_words) { hi = l; lo = h; } else { hi = h; lo = l; }
+}
+
+std::uint64_t join_u64_be(const std::uint16_t r[4]) {
+  return (std::uint64_t(r[0]) << 48) | (std::uint64_t(r[1]) << 32) |
+         (std::uint64_t(r[2]) << 16) | std::uint64_t(r[3]);
+}
+
+void split_u64_be(std::uint64_t u, std::uint16_t out[4]) {
+  out[0] = (u >> 48) & 0xFFFF;
+  out[1] = (u >> 32) & 0xFFFF;
+  out[2] = (u >> 16) & 0xFFFF;
+  out[3] = u & 0xFFFF;
+}
+
+void reorder_words4(const std::uint16_t in[4], const std::string& order, std::uint16_t out[4]) {
+  auto pick = [&](int idx)->std::uint16_t { return in[idx]; };
+  if (order == "ABCD") { out[0]=pick(0); out[1]=pick(1); out[2]=pick(2); out[3]=pick(3); return; }
+  if (order == "BADC") { out[0]=pick(1); out[1]=pick(0); out[2]=pick(3); out[3]=pick(2); return; }
+  if (order == "CDAB") { out[0]=pick(2); out[1]=pick(3); out[2]=pick(0); out[3]=pick(1); return; }
+  if (order == "DCBA") { out[0]=pick(3); out[1]=pick(2); out[2]=pick(1); out[3]=pick(0); return; }
+  // default
+  out[0]=pick(0); out[1]=pick(1); out[2]=pick(2); out[3]=pick(3);
+}
+
+double apply_scale(double raw, double scale, double offset) { return raw * scale + offset; }
+double unscale(double scaled, double scale, double offset) { return (scale == 0.0) ? 0.0 : (scaled - offset) / scale; }
+
+bool is_readable(const ItemCfg& ic) {
+  return ic.function >= 1 && ic.function <= 4;
+}
+
+ItemSpan read_span(const ItemCfg& ic) {
+  ItemSpan s;
+  s.function = ic.function;
+  s.address = ic.address;
+  s.count = ic.count > 0 ? ic.count : 1;
+  if (ic.function == 3) {
+    if (ic.type == "float") s.count = 2;
+    else if (ic.type == "double") s.count = 4;
+  }
+  return s;
+}
+
+int read_raw(IoContext* ctx, const ItemCfg& ic, RawValue& out) {
+  if (!ctx) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+  ItemSpan s = read_span(ic);
+  return read_range(ctx, ctx->device_of(ic), BusLane::OnDemand, s.function, ic.unit_id, s.address, s.count, out);
+}
+
+static std::string format_double_words(const ItemCfg& ic, const std::vector<std::uint16_t>& rr) {
+  std::uint16_t rr_dev[4] = { rr[0], rr[1], rr[2], rr[3] };
+  std::uint16_t rr_be[4]; reorder_words4(rr_dev, ic.word_order, rr_be);
+  std::uint64_t u = join_u64_be(rr_be);
+  double d; std::memcpy(&d, &u, 8);
+  return std::to_string(d);
+}
+
+static std::string format_float_words(const ItemCfg& ic, std::uint16_t hi, std::uint16_t lo) {
+  std::uint32_t u = join_u32(hi, lo, ic.swap_words);
+  float f; std::memcpy(&f, &u, 4);
+  return std::to_string(static_cast<double>(f));
+}
+
+std::string format_value(const ItemCfg& ic, const RawValue& raw) {
+  if (ic.function == 1 || ic.function == 2) {
+    if (raw.bits.size() == 1) return raw.bits[0] ? "true" : "false";
+    nlohmann::json arr = nlohmann::json::array();
+    for (auto b : raw.bits) arr.push_back(b != 0);
+    return arr.dump();
+  }
+  const std::vector<std::uint16_t>& rr = raw.words;
+  if (ic.function == 3) {
+    if (ic.type == "float") return format_float_words(ic, rr[0], rr[1]);
+    if (ic.type == "double") return format_double_words(ic, rr);
+    if (rr.size() == 1) {
+      if (ic.type == "int16") return std::to_string(apply_scale(static_cast<int16_t>(rr[0]), ic.scale, ic.offset));
+      return std::to_string(static_cast<unsigned>(rr[0]));
+    }
+  } else if (ic.function == 4) {
+    if (ic.type == "double" && rr.size() >= 4) return format_double_words(ic, rr);
+    if (ic.type == "float") return format_float_words(ic, rr[0], rr.size() > 1 ? rr[1] : 0);
+    if (rr.size() == 1) return std::to_string(static_cast<unsigned>(rr[0]));
+  }
+  nlohmann::json arr = nlohmann::json::array();
+  for (auto r : rr) arr.push_back(r);
+  return arr.dump();
+}
+
+bool decode_number(const ItemCfg& ic, const RawValue& raw, double& out) {
+  const nlohmann::json v = nlohmann::json::parse(format_value(ic, raw), nullptr, false);
+  if (v.is_boolean()) {
+    out = v.get<bool>() ? 1.0 : 0.0;
+    return true;
+  }
+  if (!v.is_number()) return false;
+  out = v.get<double>();
+  return true;
+}
+
+static const char* message_for_rc(int rc) {
+  switch (rc) {
+    case 0: return "ok";
+    case static_cast<int>(ModbusErr::INVALID_ARG): return "invalid argument";
+    case static_cast<int>(ModbusErr::NOT_FOUND): return "not found";
+    case static_cast<int>(ModbusErr::IO_TIMEOUT): return "timeout";
+    case static_cast<int>(ModbusErr::IO_ERROR): return "io error";
+    case static_cast<int>(ModbusErr::NOT_CONNECTED): return "not connected";
+    case static_cast<int>(ModbusErr::UNSUPPORTED): return "unsupported";
+    case static_cast<int>(ModbusErr::PARSE_ERROR): return "parse error";
+    default: return "error";
+  }
+}
+
+std::string format_error(const ItemCfg& ic, int rc) {
+  nlohmann::json err = {
+    {"error", {
+      {"code", rc},
+      {"message", message_for_rc(rc)}
+    }}
+  };
+  if (is_modbus_exception(rc)) {
+    auto code = decode_modbus_exception(rc);
+    err["error"]["exception"] = {
+      {"code", code},
+      {"name", modbus_exception_to_string(code)}
+    };
+  }
+  if (!ic.name.empty()) err["error"]["item"] = ic.name;
+  return err.dump();
+}
+
+} // namespace wiq
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wiq {
+
+std::uint32_t join_u32(std::uint16_t hi, std::uint16_t lo, bool swap_words);
+void split_u32(std::uint32_t v, bool swap_words, std::uint16_t& hi, std::uint16_t& lo);
+std::uint64_t join_u64_be(const std::uint16_t r[4]);
+void split_u64_be(std::uint64_t u, std::uint16_t out[4]);
+void reorder_words4(const std::uint16_t in[4], const std::string& order, std::uint16_t out[4]);
+double apply_scale(double raw, double scale, double offset);
+double unscale(double scaled, double scale, double offset);
+
+// Function code, start address and quantity actually fetched when an item is read.
+struct ItemSpan {
+  int function{};
+  int address{};
+  int count{};
+};
+
+// True for FC1-FC4 items, the only ones that can be read from the device.
+bool is_readable(const ItemCfg& ic);
+ItemSpan read_span(const ItemCfg& ic);
+
+// Undecoded item data as returned by the device: `bits` for FC1/FC2,
+// `words` for FC3/FC4.
+struct RawValue {
+  std::vector<std::uint8_t> bits;
+  std::vector<std::uint16_t> words;
+};
+
+// Fetch the raw data of a readable item from the wire (no diagnostics recorded).
+int read_raw(IoContext* ctx, const ItemCfg& ic, RawValue& out);
+
+// Render raw data in the JSON text format returned by ReadItem.
+std::string format_value(const ItemCfg& ic, const RawValue& raw);
+
+// Decoded value of a scalar item as a number (bools as 0/1). False for
+// arrays and values that do not decode to a finite number.
+bool decode_number(const ItemCfg& ic, const RawValue& raw, double& out);
+
+// Render a failed read/write as the `{"error":{...}}` object returned by the API.
+std::string format_error(const ItemCfg& ic, int rc);
+
+} // namespace wiq
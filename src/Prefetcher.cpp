@@ -0,0 +1,118 @@
+#include "Prefetcher.hpp"
+#include "ModbusError.hpp"
+#include "poll/BlockPlanner.hpp"
+#include "poll/BusBudget.hpp"
+#include <algorithm>
+
+namespace wiq {
+
+Prefetcher::Prefetcher(IoContext& ctx, Device& dev)
+: ctx_(ctx), dev_(dev) {
+  const BlockPlanCfg cfg = device_plan_cfg(ctx.block_plan, WireTime::for_device(dev));
+  max_regs_ = std::min(cfg.max_block_regs, kMaxReadRegisters);
+  max_bits_ = std::min(cfg.max_block_bits, kMaxReadBits);
+  for (const auto& kv : ctx.items) {
+    const ItemCfg& ic = kv.second;
+    if (!is_readable(ic) || &ctx.device_of(ic) != &dev) continue;
+    tables_[{ic.unit_id, ic.function}].push_back(&ic);
+  }
+  for (auto& t : tables_) {
+    auto& items = t.second;
+    std::sort(items.begin(), items.end(), [](const ItemCfg* a, const ItemCfg* b) {
+      return a->address != b->address ? a->address < b->address : a->name < b->name;
+    });
+    for (std::size_t i = 0; i < items.size(); ++i) positions_[items[i]] = i;
+  }
+}
+
+bool Prefetcher::lookup(const ItemCfg& ic, RawValue& out, clock::duration max_age) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = cache_.find(&ic);
+  if (it == cache_.end()) return false;
+  const clock::time_point now = clock::now();
+  if (it->second.expires <= now) {
+    cache_.erase(it);
+    return false;
+  }
+  if (now - it->second.at > max_age) return false;
+  out = it->second.raw;
+  dev_.diagnostics.prefetch_hits += 1;
+  return true;
+}
+
+void Prefetcher::invalidate() {
+  std::lock_guard<std::mutex> lk(mu_);
+  cache_.clear();
+  generation_ += 1;
+}
+
+int Prefetcher::read(const ItemCfg& ic, RawValue& out) {
+  dev_.diagnostics.prefetch_misses += 1;
+  auto pos = positions_.find(&ic);
+  if (pos == positions_.end()) return read_raw(&ctx_, ic, out);
+  const std::vector<const ItemCfg*>& items = tables_[{ic.unit_id, ic.function}];
+  const PrefetchCfg& cfg = ctx_.on_demand.prefetch;
+  const int limit = (ic.function == 1 || ic.function == 2) ? max_bits_ : max_regs_;
+
+  // Grow [first, end) over the neighbours; forward first, as screens are.
+  const ItemSpan own = read_span(ic);
+  int first = own.address;
+  int end = own.address + own.count;
+  std::size_t lo = pos->second;
+  std::size_t hi = pos->second;
+  for (std::size_t i = pos->second + 1; i < items.size(); ++i) {
+    const ItemSpan s = read_span(*items[i]);
+    if (s.address - end > cfg.max_gap || std::max(end, s.address + s.count) - first > limit) break;
+    end = std::max(end, s.address + s.count);
+    hi = i;
+  }
+  for (std::size_t i = pos->second; i-- > 0;) {
+    const ItemSpan s = read_span(*items[i]);
+    if (first - (s.address + s.count) > cfg.max_gap || end - std::min(first, s.address) > limit) break;
+    first = std::min(first, s.address);
+    lo = i;
+  }
+  if (lo == hi) return read_raw(&ctx_, ic, out);
+
+  ReadBlock block;
+  block.unit_id = ic.unit_id;
+  block.function = ic.function;
+  block.address = first;
+  block.count = end - first;
+  for (std::size_t i = lo; i <= hi; ++i) {
+    const ItemSpan s = read_span(*items[i]);
+    block.members.push_back({items[i], s.address - first, s.count});
+  }
+  std::uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    generation = generation_;
+  }
+  BlockData data;
+  const int rc = read_block(&ctx_, dev_, block, data, BusLane::OnDemand);
+  // The device may reject the wider range; the item on its own may be fine.
+  if (is_modbus_exception(rc)) return read_raw(&ctx_, ic, out);
+  if (rc != 0) return rc;
+
+  const clock::time_point at = clock::now();
+  const clock::time_point expires = at + std::chrono::milliseconds(cfg.ttl_ms);
+  std::lock_guard<std::mutex> lk(mu_);
+  // Neighbours read across a write may predate it; only the item's own value
+  // is returned then, as ValueCache does.
+  const bool current = generation == generation_;
+  for (const auto& m : block.members) {
+    if (m.item == &ic) {
+      slice_member(block, data, m, out);
+      continue;
+    }
+    if (!current) continue;
+    Entry& e = cache_[m.item];
+    slice_member(block, data, m, e.raw);
+    e.at = at;
+    e.expires = expires;
+    dev_.diagnostics.prefetched += 1;
+  }
+  return 0;
+}
+
+} // namespace wiq
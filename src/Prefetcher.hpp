@@ -0,0 +1,60 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace wiq {
+
+// Speculative neighbourhood prefetch for on-demand reads
+// (`on_demand.prefetch`). HMI screens list items in address order, so the
+// items next to one being read are likely read next. A read that goes to the
+// bus is widened to the configured items of the same unit and function that
+// follow it, then precede it, as long as each hole is at most `max_gap` and
+// the block stays within the device's block limits. The neighbours' values
+// are kept for `ttl_ms`; a write on the device drops them all.
+class Prefetcher {
+public:
+  using clock = std::chrono::steady_clock;
+
+  Prefetcher(IoContext& ctx, Device& dev);
+
+  Prefetcher(const Prefetcher&) = delete;
+  Prefetcher& operator=(const Prefetcher&) = delete;
+
+  // Serve a prefetched value of `ic` still within `ttl_ms` and at most
+  // `max_age` old; counts a hit.
+  bool lookup(const ItemCfg& ic, RawValue& out, clock::duration max_age = clock::duration::max());
+
+  // Read `ic` in a widened block and keep its neighbours; counts a miss.
+  // Same contract as read_raw().
+  int read(const ItemCfg& ic, RawValue& out);
+
+  void invalidate();
+
+private:
+  struct Entry {
+    RawValue raw;
+    clock::time_point at{};  // when the block was read
+    clock::time_point expires{};
+  };
+
+  IoContext& ctx_;
+  Device& dev_;
+  int max_regs_;
+  int max_bits_;
+  // Readable items of the device per (unit_id, function), by address.
+  std::map<std::pair<int, int>, std::vector<const ItemCfg*>> tables_;
+  std::unordered_map<const ItemCfg*, std::size_t> positions_;  // index in its table
+
+  std::mutex mu_;
+  std::unordered_map<const ItemCfg*, Entry> cache_;
+  std::uint64_t generation_{0};  // bumped by every write
+};
+
+} // namespace wiq
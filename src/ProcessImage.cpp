@@ -0,0 +1,184 @@
+#include "ProcessImage.hpp"
+#include "ShmExport.hpp"
+#include <algorithm>
+#include <set>
+#include <thread>
+
+namespace wiq {
+
+static bool is_bit_function(int fc) { return fc == 1 || fc == 2; }
+
+static void assign_raw(int function, const std::vector<std::uint16_t>& buf, RawValue& out) {
+  if (is_bit_function(function)) {
+    out.bits.assign(buf.begin(), buf.end());
+    out.words.clear();
+  } else {
+    out.words = buf;
+    out.bits.clear();
+  }
+}
+
+ProcessImage::ProcessImage(IoContext& ctx, Device& dev)
+: dev_(dev) {
+  std::map<std::pair<int, int>, std::set<std::pair<int, int>>> ranges;
+  for (const auto& kv : ctx.items) {
+    const ItemCfg& ic = kv.second;
+    if (!is_readable(ic) || &ctx.device_of(ic) != &dev) continue;
+    const ItemSpan span = read_span(ic);
+    ranges[{ic.unit_id, span.function}].insert({span.address, span.count});
+  }
+  for (const auto& r : ranges) {
+    Table& table = tables_[r.first];
+    int reach = 0;
+    for (const auto& range : r.second) {
+      std::unique_ptr<Segment> s(new Segment);
+      s->address = range.first;
+      s->count = range.second;
+      reach = std::max(reach, range.first + range.second);
+      s->reach = reach;
+      s->index = static_cast<std::uint32_t>(segment_count_ + table.size());
+      s->data.reset(new std::atomic<std::uint16_t>[range.second]);
+      for (int i = 0; i < range.second; ++i) s->data[i].store(0, std::memory_order_relaxed);
+      table.push_back(std::move(s));
+    }
+    segment_count_ += table.size();
+  }
+  for (const auto& kv : ctx.items) {
+    const ItemCfg& ic = kv.second;
+    if (!is_readable(ic) || &ctx.device_of(ic) != &dev) continue;
+    const ItemSpan span = read_span(ic);
+    for (const auto& s : tables_[{ic.unit_id, span.function}]) {
+      if (s->address == span.address && s->count == span.count) items_[&ic] = s.get();
+    }
+  }
+}
+
+void ProcessImage::write(const ReadBlock& block, const BlockData& data) {
+  auto t = tables_.find({block.unit_id, block.function});
+  if (t == tables_.end()) return;
+  const bool bits = is_bit_function(block.function);
+  const std::size_t have = bits ? data.bits.size() : data.words.size();
+  if (have < static_cast<std::size_t>(block.count)) return;
+  const int end = block.address + block.count;
+  const clock::rep now = clock::now().time_since_epoch().count();
+  generation_ += 1;
+
+  Table& table = t->second;
+  auto it = std::lower_bound(table.begin(), table.end(), block.address,
+                             [](const std::unique_ptr<Segment>& s, int a) { return s->address < a; });
+  for (; it != table.end() && (*it)->address < end; ++it) {
+    Segment& s = **it;
+    if (s.address + s.count > end) continue;
+    const int offset = s.address - block.address;
+    const std::uint32_t seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < s.count; ++i) {
+      const std::uint16_t v = bits ? data.bits[offset + i] : data.words[offset + i];
+      s.data[i].store(v, std::memory_order_relaxed);
+    }
+    s.generation.store(generation_, std::memory_order_relaxed);
+    s.at.store(now, std::memory_order_relaxed);
+    s.seq.store(seq + 2, std::memory_order_release);
+    if (shm_) {
+      if (bits) shm_->publish(shm_first_ + s.index, &data.bits[offset], generation_);
+      else shm_->publish(shm_first_ + s.index, &data.words[offset], generation_);
+    }
+  }
+}
+
+std::vector<ProcessImage::Range> ProcessImage::layout() const {
+  std::vector<Range> out;
+  for (const auto& t : tables_) {
+    for (const auto& s : t.second) out.push_back({t.first.first, t.first.second, s->address, s->count});
+  }
+  return out;
+}
+
+int ProcessImage::segment_of(const ItemCfg& ic) const {
+  auto it = items_.find(&ic);
+  return it == items_.end() ? -1 : static_cast<int>(it->second->index);
+}
+
+void ProcessImage::mirror(ShmExport* shm, std::uint32_t first) {
+  shm_ = shm;
+  shm_first_ = first;
+}
+
+bool ProcessImage::load(const Segment& s, int offset, int count, std::uint16_t* out, Stamp& stamp) const {
+  for (;;) {
+    const std::uint32_t before = s.seq.load(std::memory_order_acquire);
+    if ((before & 1u) == 0) {
+      for (int i = 0; i < count; ++i) out[i] = s.data[offset + i].load(std::memory_order_relaxed);
+      const std::uint64_t generation = s.generation.load(std::memory_order_relaxed);
+      const clock::rep at = s.at.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.seq.load(std::memory_order_relaxed) == before) {
+        stamp.generation = generation;
+        stamp.at = clock::time_point(clock::duration(at));
+        return generation != 0;
+      }
+    }
+    dev_.diagnostics.image_retries += 1;
+    std::this_thread::yield();
+  }
+}
+
+const ProcessImage::Segment* ProcessImage::pick(const Table& table, int a, bool polled) {
+  auto it = std::upper_bound(table.begin(), table.end(), a,
+                             [](int v, const std::unique_ptr<Segment>& s) { return v < s->address; });
+  const Segment* best = nullptr;
+  while (it != table.begin()) {
+    const Segment& s = **--it;
+    if (s.reach <= a) break;
+    if (s.address + s.count <= a) continue;
+    if (polled && s.generation.load(std::memory_order_relaxed) == 0) continue;
+    if (!best || s.address + s.count > best->address + best->count) best = &s;
+  }
+  return best;
+}
+
+bool ProcessImage::covers(int unit_id, int function, int address, int count) const {
+  auto t = tables_.find({unit_id, function});
+  if (t == tables_.end() || count <= 0) return false;
+  for (int a = address; a < address + count;) {
+    const Segment* s = pick(t->second, a, false);
+    if (!s) return false;
+    a = s->address + s->count;
+  }
+  return true;
+}
+
+bool ProcessImage::read_item(const ItemCfg& ic, RawValue& out, Stamp& stamp) const {
+  auto it = items_.find(&ic);
+  if (it == items_.end()) return false;
+  const Segment& s = *it->second;
+  std::vector<std::uint16_t> buf(static_cast<std::size_t>(s.count));
+  if (!load(s, 0, s.count, buf.data(), stamp)) return false;
+  assign_raw(read_span(ic).function, buf, out);
+  return true;
+}
+
+bool ProcessImage::read(int unit_id, int function, int address, int count, RawValue& out, Stamp& oldest) const {
+  if (count <= 0) return false;
+  auto t = tables_.find({unit_id, function});
+  if (t == tables_.end()) return false;
+  const Table& table = t->second;
+  std::vector<std::uint16_t> buf(static_cast<std::size_t>(count));
+  const int end = address + count;
+  bool first = true;
+  for (int a = address; a < end;) {
+    const Segment* best = pick(table, a, true);
+    if (!best) return false;
+    const int n = std::min(end, best->address + best->count) - a;
+    Stamp stamp;
+    if (!load(*best, a - best->address, n, &buf[static_cast<std::size_t>(a - address)], stamp)) return false;
+    if (first || stamp.generation < oldest.generation) oldest = stamp;
+    first = false;
+    a += n;
+  }
+  assign_raw(function, buf, out);
+  return true;
+}
+
+} // namespace wiq
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include "poll/BlockPlanner.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace wiq {
+
+class ShmExport;
+
+// Register and bit image of a device per (unit_id, function), fed by its
+// poll engine. The image is split into segments, one per distinct address
+// range of the configured readable items. Each segment is written whole
+// from a single block read and carries the generation of that read (a
+// per-device count of published blocks) and the time it was taken.
+//
+// Segments are laid out once, at creation, and published under a seqlock:
+// the poll thread is the only writer, and readers copy a segment without
+// locking and retry if a write overlapped. A multi-register item therefore
+// always decodes from one block read, and any number of threads can read
+// the image without touching the bus or slowing the poll thread down.
+class ProcessImage {
+public:
+  using clock = std::chrono::steady_clock;
+
+  // Origin of a value: generation 0 means the range was never polled.
+  struct Stamp {
+    std::uint64_t generation{0};
+    clock::time_point at{};
+  };
+
+  ProcessImage(IoContext& ctx, Device& dev);
+
+  ProcessImage(const ProcessImage&) = delete;
+  ProcessImage& operator=(const ProcessImage&) = delete;
+
+  // Publish the response of `block` to every segment it covers completely;
+  // poll thread only.
+  void write(const ReadBlock& block, const BlockData& data);
+
+  // Copy the raw value of `ic` from one consistent segment write. False if
+  // the item is not in the image or was not polled yet.
+  bool read_item(const ItemCfg& ic, RawValue& out, Stamp& stamp) const;
+
+  // Copy `count` registers (FC3/FC4) or bits (FC1/FC2) from `address` on.
+  // Each segment used is read consistently, but a range spanning several
+  // segments may combine block reads; `oldest` is the oldest one used.
+  // False if part of the range is not in the image or was not polled yet.
+  bool read(int unit_id, int function, int address, int count, RawValue& out, Stamp& oldest) const;
+
+  // True if configured segments cover the whole range, polled or not.
+  bool covers(int unit_id, int function, int address, int count) const;
+
+  std::size_t segments() const { return segment_count_; }
+
+  // Address range of each segment, in segment index order.
+  struct Range {
+    int unit_id;
+    int function;
+    int address;
+    int count;
+  };
+  std::vector<Range> layout() const;
+
+  // Index of the segment holding `ic`, or -1 if it is not in the image.
+  int segment_of(const ItemCfg& ic) const;
+
+  // Also publish every write to `shm`, whose segments `first` on belong to
+  // this image. Must be set before the poll engine starts.
+  void mirror(ShmExport* shm, std::uint32_t first);
+
+private:
+  struct Segment {
+    int address{};
+    int count{};
+    int reach{};  // largest end of this and all earlier segments of the table
+    std::uint32_t index{};
+    std::atomic<std::uint32_t> seq{0};  // odd while a write is in progress
+    std::atomic<std::uint64_t> generation{0};
+    std::atomic<clock::rep> at{0};
+    std::unique_ptr<std::atomic<std::uint16_t>[]> data;  // one slot per register or bit
+  };
+  using Table = std::vector<std::unique_ptr<Segment>>;
+
+  // Of the segments holding address `a` (only polled ones if `polled`),
+  // the one reaching farthest; null if there is none.
+  static const Segment* pick(const Table& table, int a, bool polled);
+
+  // Copy [offset, offset + count) of `s` into `out`; false if never written.
+  bool load(const Segment& s, int offset, int count, std::uint16_t* out, Stamp& stamp) const;
+
+  Device& dev_;
+  // Segments per (unit_id, function), by address; fixed after construction.
+  std::map<std::pair<int, int>, Table> tables_;
+  std::unordered_map<const ItemCfg*, const Segment*> items_;
+  std::size_t segment_count_{0};
+  ShmExport* shm_{nullptr};
+  std::uint32_t shm_first_{0};
+  std::uint64_t generation_{0};  // poll thread only
+};
+
+} // namespace wiq
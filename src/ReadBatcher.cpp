@@ -0,0 +1,88 @@
+#include "ReadBatcher.hpp"
+#include "ModbusError.hpp"
+#include "Prefetcher.hpp"
+#include "poll/BlockPlanner.hpp"
+#include "poll/BusBudget.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace wiq {
+
+ReadBatcher::ReadBatcher(IoContext& ctx, Device& dev)
+: ctx_(ctx), dev_(dev), plan_cfg_(device_plan_cfg(ctx.block_plan, WireTime::for_device(dev))) {}
+
+int ReadBatcher::read(const ItemCfg& ic, RawValue& out) {
+  Request req{&ic, &out, 0, false};
+  std::unique_lock<std::mutex> lk(mu_);
+  if (open_) {
+    open_->push_back(&req);
+    cv_.wait(lk, [&] { return req.done; });
+    return req.rc;
+  }
+  std::vector<Request*> batch{&req};
+  open_ = &batch;
+  lk.unlock();
+  std::this_thread::sleep_for(std::chrono::microseconds(ctx_.on_demand.batch_window_us));
+  lk.lock();
+  open_ = nullptr;
+  lk.unlock();
+
+  run(batch);
+
+  lk.lock();
+  for (Request* r : batch) r->done = true;
+  lk.unlock();
+  cv_.notify_all();
+  return req.rc;
+}
+
+void ReadBatcher::run(const std::vector<Request*>& batch) {
+  DeviceDiagnostics& dd = dev_.diagnostics;
+  dd.batched_reads += batch.size();
+  std::vector<const ItemCfg*> items;
+  for (const Request* r : batch) {
+    if (std::find(items.begin(), items.end(), r->item) == items.end()) items.push_back(r->item);
+  }
+  if (items.size() == 1) {
+    dd.batch_transactions += 1;
+    RawValue raw;
+    const int rc = dev_.prefetcher ? dev_.prefetcher->read(*items[0], raw) : read_raw(&ctx_, *items[0], raw);
+    for (Request* r : batch) {
+      r->rc = rc;
+      *r->out = raw;
+    }
+    return;
+  }
+
+  std::vector<ReadBlock> blocks = plan_blocks(items, plan_cfg_);
+  std::vector<const ReadBlock*> ptrs;
+  for (const auto& b : blocks) ptrs.push_back(&b);
+  std::vector<BlockData> data;
+  std::vector<int> rcs;
+  read_blocks(&ctx_, dev_, ptrs, data, rcs, BusLane::OnDemand);
+  dd.batch_transactions += blocks.size();
+
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    const ReadBlock& block = blocks[i];
+    for (const auto& m : block.members) {
+      RawValue raw;
+      int rc = rcs[i];
+      if (rc == 0) {
+        slice_member(block, data[i], m, raw);
+      } else if (block.members.size() > 1 && is_modbus_exception(rc)) {
+        // The merged range may cover addresses the device rejects; the
+        // items on their own may still read fine.
+        dd.batch_transactions += 1;
+        rc = read_raw(&ctx_, *m.item, raw);
+      }
+      for (Request* r : batch) {
+        if (r->item != m.item) continue;
+        r->rc = rc;
+        *r->out = raw;
+      }
+    }
+  }
+}
+
+} // namespace wiq
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace wiq {
+
+// Merges concurrent on-demand reads of one device (ReadItem calls that are
+// not served from the poll cache) into block reads, for
+// `on_demand.batch_window_us`.
+//
+// The first caller of a batch leads it: it waits out the window while later
+// callers join, plans the collected items like a poll group (BlockPlanner)
+// and reads the blocks in the OnDemand lane, pipelined where the transport
+// allows. The other callers sleep until the leader hands them their slice.
+// A batch that closed while its leader is on the bus does not take new
+// callers; they start the next one. A batch of a single item goes through
+// the device's Prefetcher, if any.
+class ReadBatcher {
+public:
+  ReadBatcher(IoContext& ctx, Device& dev);
+
+  ReadBatcher(const ReadBatcher&) = delete;
+  ReadBatcher& operator=(const ReadBatcher&) = delete;
+
+  // Same contract as read_raw().
+  int read(const ItemCfg& ic, RawValue& out);
+
+private:
+  struct Request {
+    const ItemCfg* item;
+    RawValue* out;
+    int rc;
+    bool done;
+  };
+
+  void run(const std::vector<Request*>& batch);
+
+  IoContext& ctx_;
+  Device& dev_;
+  BlockPlanCfg plan_cfg_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::vector<Request*>* open_{nullptr};  // batch still taking callers
+};
+
+} // namespace wiq
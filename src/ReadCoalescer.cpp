@@ -0,0 +1,69 @@
+#include "ReadCoalescer.hpp"
+#include "ModbusError.hpp"
+
+namespace wiq {
+
+int ReadCoalescer::read(BusLane lane, int function, int unit, int address, int count,
+                        const std::function<int(RawValue&)>& fetch, RawValue& out, bool& led) {
+  const std::uint64_t range = (static_cast<std::uint64_t>(function & 0xFF) << 48) |
+                              (static_cast<std::uint64_t>(unit & 0xFF) << 40) |
+                              (static_cast<std::uint64_t>(address & 0xFFFF) << 16) |
+                              static_cast<std::uint64_t>(count & 0xFFFF);
+  auto key_in = [range](int l) { return (static_cast<std::uint64_t>(l) << 56) | range; };
+  const std::uint64_t key = key_in(static_cast<int>(lane));
+  std::shared_ptr<Result> mine = std::make_shared<Result>();
+  std::unique_lock<std::mutex> lk(mu_);
+  bool joined = false;
+  for (int l = 0; l < static_cast<int>(lane) && !joined; ++l) joined = flights_.attach(key_in(l), mine);
+  Flights::Ticket flight;
+  if (!joined) flight = flights_.join(key, mine);
+  if (!flight) {
+    cv_.wait(lk, [&] { return mine->done; });
+    led = false;
+    out = std::move(mine->raw);
+    return mine->rc;
+  }
+  lk.unlock();
+
+  const int rc = fetch(out);
+
+  lk.lock();
+  for (const std::shared_ptr<Result>& r : flights_.complete(key, flight)) {
+    if (r == mine) continue;
+    r->rc = rc;
+    r->raw = out;
+    r->done = true;
+  }
+  lk.unlock();
+  cv_.notify_all();
+  led = true;
+  return rc;
+}
+
+void ReadCoalescer::invalidate() {
+  std::lock_guard<std::mutex> lk(mu_);
+  flights_.forget();
+}
+
+int read_range(IoContext* ctx, Device& dev, BusLane lane, int function, int unit, int address, int count,
+               RawValue& out) {
+  if (!dev.client) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+  if (function < 1 || function > 4) return static_cast<int>(ModbusErr::UNSUPPORTED);
+  bool led = true;
+  const int rc = dev.coalescer->read(lane, function, unit, address, count, [&](RawValue& raw) {
+    if (function <= 2) raw.bits.assign(static_cast<std::size_t>(count), 0);
+    else raw.words.assign(static_cast<std::size_t>(count), 0);
+    return call_with_reconnect(ctx, dev, lane, [&] {
+      switch (function) {
+        case 1: return dev.client->read_coils(unit, address, count, raw.bits.data());
+        case 2: return dev.client->read_discrete_inputs(unit, address, count, raw.bits.data());
+        case 3: return dev.client->read_holding_regs(unit, address, count, raw.words.data());
+        default: return dev.client->read_input_regs(unit, address, count, raw.words.data());
+      }
+    });
+  }, out, led);
+  if (!led) dev.diagnostics.coalesced_reads += 1;
+  return rc;
+}
+
+} // namespace wiq
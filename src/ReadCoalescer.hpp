@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ItemCodec.hpp"
+#include "util/Singleflight.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace wiq {
+
+// Shares bus reads of one device between callers that ask for the same
+// range at the same time. Every read goes through read_range(), so this
+// sits in front of the bus lock: a caller whose read (function, unit,
+// address, count) is already queued or on the wire waits for that read and
+// gets its result, error codes and Modbus exceptions included, instead of
+// queueing a second identical transaction behind it.
+//
+// A caller only joins a read queued in its own bus lane or a more urgent one,
+// so an on-demand read never waits behind a poll read it could overtake; a
+// poll read still joins an on-demand read of the same range.
+//
+// A write on the device detaches the reads in flight; callers arriving
+// after it start a fresh read rather than take a value that may predate it.
+class ReadCoalescer {
+public:
+  // Run `fetch` in `lane`, or wait for the identical read in flight in that
+  // lane or a more urgent one and copy its result. `led` tells whether this
+  // caller issued the read.
+  int read(BusLane lane, int function, int unit, int address, int count, const std::function<int(RawValue&)>& fetch,
+           RawValue& out, bool& led);
+
+  void invalidate();
+
+private:
+  struct Result {
+    bool done{false};
+    int rc{0};
+    RawValue raw;
+  };
+  using Flights = Singleflight<std::uint64_t, std::shared_ptr<Result>>;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  Flights flights_;
+};
+
+// Read `count` bits (FC1/FC2) or registers (FC3/FC4) from `address` on in
+// `lane`, sharing the transaction with an identical read of `dev` already
+// in flight. No diagnostics are recorded except `coalesced_reads`.
+int read_range(IoContext* ctx, Device& dev, BusLane lane, int function, int unit, int address, int count,
+               RawValue& out);
+
+} // namespace wiq
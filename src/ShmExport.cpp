@@ -0,0 +1,200 @@
+#include "ShmExport.hpp"
+#include "ProcessImage.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+# include <cerrno>
+# include <ctime>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+namespace wiq {
+
+static_assert(sizeof(wiq_shm_header) == 72, "wiq_shm_header layout is part of the reader ABI");
+static_assert(sizeof(wiq_shm_segment) == 40, "wiq_shm_segment layout is part of the reader ABI");
+static_assert(sizeof(wiq_shm_item) == 112, "wiq_shm_item layout is part of the reader ABI");
+
+#if defined(_WIN32)
+
+std::unique_ptr<ShmExport> ShmExport::create(const std::string& name, IoContext&) {
+  log::log_error(__FILE__, __LINE__, "shared_memory: %s: POSIX shared memory is not supported on Windows", name.c_str());
+  return nullptr;
+}
+
+ShmExport::~ShmExport() {}
+
+template <typename T>
+void ShmExport::publish_slots(std::uint32_t, const T*, std::uint64_t) {}
+
+#else
+
+namespace {
+
+std::uint64_t monotonic_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+void copy_text(char* dst, std::size_t size, const std::string& s) {
+  std::memset(dst, 0, size);
+  std::memcpy(dst, s.data(), std::min(s.size(), size - 1));
+}
+
+// Pid of the handler still serving an existing object `name`, or 0 if the
+// object is a leftover (dead writer, cleared `alive`, or not a valid layout).
+std::uint32_t live_writer(const std::string& name) {
+  wiq_shm_view v{};
+  if (wiq_shm_open(name.c_str(), &v) != 0) return 0;
+  const std::uint32_t pid = wiq_shm_writer_alive(&v) ? v.header->writer_pid : 0;
+  wiq_shm_close(&v);
+  return pid;
+}
+
+} // namespace
+
+std::unique_ptr<ShmExport> ShmExport::create(const std::string& name, IoContext& ctx) {
+  std::vector<wiq_shm_segment> segments;
+  std::vector<wiq_shm_item> items;
+  std::uint32_t slots = 0;
+  std::vector<std::uint32_t> first(ctx.devices.size(), 0);
+  for (std::size_t d = 0; d < ctx.devices.size(); ++d) {
+    first[d] = static_cast<std::uint32_t>(segments.size());
+    const ProcessImage* image = ctx.devices[d]->image.get();
+    if (!image) continue;
+    for (const auto& r : image->layout()) {
+      wiq_shm_segment s{};
+      s.device = static_cast<std::uint16_t>(d);
+      s.unit_id = static_cast<std::uint8_t>(r.unit_id);
+      s.function = static_cast<std::uint8_t>(r.function);
+      s.address = static_cast<std::uint32_t>(r.address);
+      s.count = static_cast<std::uint32_t>(r.count);
+      s.data = slots;
+      slots += s.count;
+      segments.push_back(s);
+    }
+  }
+  for (const auto& kv : ctx.items) {
+    const ItemCfg& ic = kv.second;
+    const ProcessImage* image = ctx.device_of(ic).image.get();
+    const int seg = image ? image->segment_of(ic) : -1;
+    if (seg < 0) continue;
+    if (ic.name.size() >= sizeof(wiq_shm_item{}.name)) {
+      log::log_warn(__FILE__, __LINE__, "shared_memory: item '%s' has a name too long for the item table", ic.name.c_str());
+      continue;
+    }
+    wiq_shm_item it{};
+    copy_text(it.name, sizeof(it.name), ic.name);
+    copy_text(it.type, sizeof(it.type), ic.type);
+    copy_text(it.word_order, sizeof(it.word_order), ic.word_order);
+    it.segment = first[ic.device] + static_cast<std::uint32_t>(seg);
+    it.device = static_cast<std::uint16_t>(ic.device);
+    it.swap_words = ic.swap_words ? 1 : 0;
+    it.scale = ic.scale;
+    it.offset = ic.offset;
+    items.push_back(it);
+  }
+  std::sort(items.begin(), items.end(), [](const wiq_shm_item& a, const wiq_shm_item& b) {
+    return std::strncmp(a.name, b.name, sizeof(a.name)) < 0;
+  });
+
+  const std::size_t segments_offset = sizeof(wiq_shm_header);
+  const std::size_t items_offset = segments_offset + segments.size() * sizeof(wiq_shm_segment);
+  const std::size_t data_offset = items_offset + items.size() * sizeof(wiq_shm_item);
+  const std::size_t size = data_offset + slots * sizeof(std::uint16_t);
+
+  // A leftover object of a handler that did not shut down is replaced; one
+  // whose handler is still running belongs to that handler.
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0 && errno == EEXIST) {
+    if (const std::uint32_t pid = live_writer(name)) {
+      log::log_error(__FILE__, __LINE__, "shared_memory: %s is in use by the handler in process %u", name.c_str(), pid);
+      return nullptr;
+    }
+    log::log_warn(__FILE__, __LINE__, "shared_memory: replacing stale object %s", name.c_str());
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  }
+  if (fd < 0) {
+    log::log_error(__FILE__, __LINE__, "shared_memory: shm_open(%s): %s", name.c_str(), std::strerror(errno));
+    return nullptr;
+  }
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    log::log_error(__FILE__, __LINE__, "shared_memory: ftruncate(%s): %s", name.c_str(), std::strerror(errno));
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    log::log_error(__FILE__, __LINE__, "shared_memory: mmap(%s): %s", name.c_str(), std::strerror(errno));
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  char* p = static_cast<char*>(base);
+  if (!segments.empty()) std::memcpy(p + segments_offset, segments.data(), segments.size() * sizeof(wiq_shm_segment));
+  if (!items.empty()) std::memcpy(p + items_offset, items.data(), items.size() * sizeof(wiq_shm_item));
+  auto* h = reinterpret_cast<wiq_shm_header*>(p);
+  h->version = WIQ_SHM_VERSION;
+  h->header_size = sizeof(wiq_shm_header);
+  h->segment_size = sizeof(wiq_shm_segment);
+  h->item_size = sizeof(wiq_shm_item);
+  h->segment_count = static_cast<std::uint32_t>(segments.size());
+  h->item_count = static_cast<std::uint32_t>(items.size());
+  h->writer_pid = static_cast<std::uint32_t>(getpid());
+  h->alive = 1;
+  h->total_size = size;
+  h->segments_offset = segments_offset;
+  h->items_offset = items_offset;
+  h->data_offset = data_offset;
+  // Readers check the magic first; it goes in once the layout is complete.
+  __atomic_store_n(&h->magic, WIQ_SHM_MAGIC, __ATOMIC_RELEASE);
+
+  std::unique_ptr<ShmExport> shm(new ShmExport(name, base, size));
+  for (std::size_t d = 0; d < ctx.devices.size(); ++d) {
+    if (ctx.devices[d]->image) ctx.devices[d]->image->mirror(shm.get(), first[d]);
+  }
+  return shm;
+}
+
+ShmExport::~ShmExport() {
+  __atomic_store_n(&header_->alive, 0u, __ATOMIC_RELEASE);
+  munmap(base_, size_);
+  shm_unlink(name_.c_str());
+}
+
+template <typename T>
+void ShmExport::publish_slots(std::uint32_t segment, const T* values, std::uint64_t generation) {
+  char* p = static_cast<char*>(base_);
+  auto* s = reinterpret_cast<wiq_shm_segment*>(p + header_->segments_offset) + segment;
+  std::uint16_t* data = reinterpret_cast<std::uint16_t*>(p + header_->data_offset) + s->data;
+  const std::uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (std::uint32_t i = 0; i < s->count; ++i) __atomic_store_n(&data[i], static_cast<std::uint16_t>(values[i]), __ATOMIC_RELAXED);
+  __atomic_store_n(&s->generation, generation, __ATOMIC_RELAXED);
+  __atomic_store_n(&s->monotonic_ns, monotonic_ns(), __ATOMIC_RELAXED);
+  __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+#endif
+
+ShmExport::ShmExport(const std::string& name, void* base, std::size_t size)
+: name_(name), base_(base), size_(size), header_(static_cast<wiq_shm_header*>(base)) {}
+
+void ShmExport::publish(std::uint32_t segment, const std::uint16_t* words, std::uint64_t generation) {
+  publish_slots(segment, words, generation);
+}
+
+void ShmExport::publish(std::uint32_t segment, const std::uint8_t* bits, std::uint64_t generation) {
+  publish_slots(segment, bits, generation);
+}
+
+} // namespace wiq
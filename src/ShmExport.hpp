@@ -0,0 +1,52 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ModbusShm.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace wiq {
+
+// POSIX shared-memory mirror of every device's ProcessImage
+// (`shared_memory` in the configuration), laid out as described in
+// include/ModbusShm.h. Segments are numbered across devices in device order;
+// each device's image publishes its own range of them from its poll thread,
+// under the same seqlock protocol the C reader header expects.
+class ShmExport {
+public:
+  // Create `name` sized for the images of `ctx` and write the layout. A
+  // leftover object of the same name is replaced. Null, with the reason
+  // logged, if the object cannot be created.
+  static std::unique_ptr<ShmExport> create(const std::string& name, IoContext& ctx);
+
+  // Clears `alive` and unlinks the name; mapped readers keep the last data.
+  ~ShmExport();
+
+  ShmExport(const ShmExport&) = delete;
+  ShmExport& operator=(const ShmExport&) = delete;
+
+  // Publish one segment's slots; called by the poll thread of the device
+  // owning `segment`.
+  void publish(std::uint32_t segment, const std::uint16_t* words, std::uint64_t generation);
+  void publish(std::uint32_t segment, const std::uint8_t* bits, std::uint64_t generation);
+
+  const std::string& name() const { return name_; }
+  std::size_t size() const { return size_; }
+  std::uint32_t segments() const { return header_->segment_count; }
+  std::uint32_t items() const { return header_->item_count; }
+
+private:
+  ShmExport(const std::string& name, void* base, std::size_t size);
+
+  template <typename T>
+  void publish_slots(std::uint32_t segment, const T* values, std::uint64_t generation);
+
+  std::string name_;
+  void* base_;
+  std::size_t size_;
+  wiq_shm_header* header_;
+};
+
+} // namespace wiq
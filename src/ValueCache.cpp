@@ -0,0 +1,79 @@
+#include "ValueCache.hpp"
+
+namespace wiq {
+
+void ValueCache::fill(const ItemCfg& ic, Entry& e, Value& out) {
+  if (e.json.empty()) e.json = format_value(ic, e.raw);
+  out.json = e.json;
+  out.at = e.at;
+  out.timestamp = e.timestamp;
+}
+
+bool ValueCache::lookup(const ItemCfg& ic, clock::duration max_age, Value& out) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = entries_.find(&ic);
+  if (it == entries_.end() || clock::now() - it->second.at > max_age) return false;
+  fill(ic, it->second, out);
+  return true;
+}
+
+bool ValueCache::peek(const ItemCfg& ic, Value& out) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = entries_.find(&ic);
+  if (it == entries_.end()) return false;
+  fill(ic, it->second, out);
+  return true;
+}
+
+void ValueCache::store(const ItemCfg& ic, const RawValue& raw, int rc) {
+  if (rc != 0) return;
+  std::lock_guard<std::mutex> lk(mu_);
+  store_locked(ic, raw);
+}
+
+void ValueCache::store_locked(const ItemCfg& ic, const RawValue& raw) {
+  Entry& e = entries_[&ic];
+  if (e.raw.bits != raw.bits || e.raw.words != raw.words) {
+    e.raw = raw;
+    e.json.clear();
+  }
+  e.at = clock::now();
+  e.timestamp = std::chrono::system_clock::now();
+}
+
+int ValueCache::read(const ItemCfg& ic, const std::function<int(RawValue&)>& fetch, RawValue& out, bool& led) {
+  std::shared_ptr<Result> mine = std::make_shared<Result>();
+  std::unique_lock<std::mutex> lk(mu_);
+  Flights::Ticket flight = flights_.join(&ic, mine);
+  if (!flight) {
+    cv_.wait(lk, [&] { return mine->done; });
+    led = false;
+    out = std::move(mine->raw);
+    return mine->rc;
+  }
+  lk.unlock();
+
+  const int rc = fetch(out);
+
+  lk.lock();
+  // A value read across a write may predate it; it is returned but not kept.
+  if (rc == 0 && flight->current()) store_locked(ic, out);
+  for (const std::shared_ptr<Result>& r : flights_.complete(&ic, flight)) {
+    if (r == mine) continue;
+    r->rc = rc;
+    r->raw = out;
+    r->done = true;
+  }
+  lk.unlock();
+  cv_.notify_all();
+  led = true;
+  return rc;
+}
+
+void ValueCache::invalidate() {
+  std::lock_guard<std::mutex> lk(mu_);
+  entries_.clear();
+  flights_.forget();
+}
+
+} // namespace wiq
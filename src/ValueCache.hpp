@@ -0,0 +1,76 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include "util/Singleflight.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace wiq {
+
+// Last good value of every item of a device that was read from the bus, by
+// ReadItem or by the poll engine, with the time it was read. The JSON text
+// is decoded once per sample, on the first request that serves it.
+//
+// Reads that miss go through read(): while one read of an item is on the
+// bus, further callers for the same item wait for it and share its result
+// instead of issuing their own. This is the whole ReadItem path (batcher,
+// prefetcher, decode) shared per item; ReadCoalescer below it shares bus
+// transactions per register range. A write on the device drops every entry,
+// and a read started before that write is not shared with later callers.
+class ValueCache {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct Value {
+    std::string json;
+    clock::time_point at{};
+    std::chrono::system_clock::time_point timestamp{};
+  };
+
+  // Copy the value of `ic` if it is at most `max_age` old.
+  bool lookup(const ItemCfg& ic, clock::duration max_age, Value& out);
+
+  // Cached value of `ic` regardless of age, for cache.peek.
+  bool peek(const ItemCfg& ic, Value& out);
+
+  void store(const ItemCfg& ic, const RawValue& raw, int rc);
+
+  // Fetch `ic` with `fetch`, or wait for a read of it already on the bus.
+  // `led` tells whether this caller issued the read. Successful results are
+  // stored unless a write happened meanwhile.
+  int read(const ItemCfg& ic, const std::function<int(RawValue&)>& fetch, RawValue& out, bool& led);
+
+  void invalidate();
+
+private:
+  struct Entry {
+    RawValue raw;
+    std::string json;  // format_value(raw), filled in on first use
+    clock::time_point at{};
+    std::chrono::system_clock::time_point timestamp{};
+  };
+
+  struct Result {
+    bool done{false};
+    int rc{0};
+    RawValue raw;
+  };
+  using Flights = Singleflight<const ItemCfg*, std::shared_ptr<Result>>;
+
+  void fill(const ItemCfg& ic, Entry& e, Value& out);
+  void store_locked(const ItemCfg& ic, const RawValue& raw);
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::unordered_map<const ItemCfg*, Entry> entries_;
+  Flights flights_;
+};
+
+} // namespace wiq
@@ -1,119 +1,165 @@
 #include "AsciiModbusClient.hpp"
 #include "ModbusError.hpp"
-#include <vector>
+#include "modbus/SerialModbusClient.hpp"
 #include <algorithm>
+#include <cstring>
+#include <thread>
 
 namespace wiq {
 
 namespace {
 
-class AsciiStubClient : public IModbusClient {
-public:
-  AsciiStubClient(const AsciiConfig& cfg,
-                  int coils_size,
-                  int discrete_size,
-                  int holding_size,
-                  int input_size)
-  : cfg_(cfg),
-    frame_silence_ms_(cfg.frame_silence_ms),
-    coils_(coils_size, 0),
-    discrete_(discrete_size, 0),
-    holding_(holding_size, 0),
-    input_(input_size, 0) {}
-
-  int connect() override {
-    connected_ = true;
-    return 0;
-  }
+inline int err(ModbusErr e) { return static_cast<int>(e); }
 
-  void close() override { connected_ = false; }
+constexpr int kMaxFrame = 255;                  // address + 253-byte PDU + LRC
+constexpr int kMaxWire = 1 + 2 * kMaxFrame + 2; // ':' + hex + CRLF
+// Slaves need time to process a broadcast before the next request.
+constexpr std::chrono::milliseconds kBroadcastTurnaround{100};
 
-  void set_timeout_ms(int ms) override { cfg_.timeout_ms = ms; }
-
-  void set_frame_silence_ms(int ms) override { frame_silence_ms_ = ms; }
-
-  int read_coils(int /*unit*/, int addr, int count, std::uint8_t* out) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (!out || addr < 0 || count < 0) return static_cast<int>(ModbusErr::INVALID_ARG);
-    if (addr + count > static_cast<int>(coils_.size())) return make_modbus_exception(2);
-    for (int i = 0; i < count; ++i) out[i] = coils_[addr + i] ? 1u : 0u;
-    return 0;
-  }
+// ASCII doubles every byte on the wire; both directions go through these
+// tables so that a byte costs one lookup and a two-character copy, with no
+// formatting calls or per-character branches on the hex alphabet.
+struct HexTables {
+  char digits[256][2];     // byte -> two upper-case hex digits
+  std::int8_t value[256];  // character -> nibble, -1 if not a hex digit
+};
 
-  int read_discrete_inputs(int /*unit*/, int addr, int count, std::uint8_t* out) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (!out || addr < 0 || count < 0) return static_cast<int>(ModbusErr::INVALID_ARG);
-    if (addr + count > static_cast<int>(discrete_.size())) return make_modbus_exception(2);
-    for (int i = 0; i < count; ++i) out[i] = discrete_[addr + i] ? 1u : 0u;
-    return 0;
-  }
+const HexTables& hex_tables() {
+  static const HexTables t = [] {
+    HexTables h;
+    static const char kDigits[] = "0123456789ABCDEF";
+    for (int b = 0; b < 256; ++b) {
+      h.digits[b][0] = kDigits[b >> 4];
+      h.digits[b][1] = kDigits[b & 0x0F];
+      h.value[b] = -1;
+    }
+    for (int d = 0; d < 10; ++d) h.value['0' + d] = static_cast<std::int8_t>(d);
+    for (int d = 0; d < 6; ++d) {
+      h.value['A' + d] = static_cast<std::int8_t>(10 + d);
+      h.value['a' + d] = static_cast<std::int8_t>(10 + d);
+    }
+    return h;
+  }();
+  return t;
+}
 
-  int read_holding_regs(int /*unit*/, int addr, int count, std::uint16_t* out) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (!out || addr < 0 || count < 0) return static_cast<int>(ModbusErr::INVALID_ARG);
-    if (addr + count > static_cast<int>(holding_.size())) return make_modbus_exception(2);
-    for (int i = 0; i < count; ++i) out[i] = holding_[addr + i];
-    return 0;
+class AsciiClient : public SerialModbusClient {
+public:
+  explicit AsciiClient(const AsciiConfig& cfg)
+  : SerialModbusClient(SerialLineCfg{cfg.port, cfg.baud, cfg.parity, cfg.data_bits, cfg.stop_bits}, cfg.timeout_ms),
+    lrc_check_(cfg.lrc_check),
+    hex_(hex_tables()) {
+    set_frame_silence_ms(cfg.frame_silence_ms);
   }
 
-  int read_input_regs(int /*unit*/, int addr, int count, std::uint16_t* out) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (!out || addr < 0 || count < 0) return static_cast<int>(ModbusErr::INVALID_ARG);
-    if (addr + count > static_cast<int>(input_.size())) return make_modbus_exception(2);
-    for (int i = 0; i < count; ++i) out[i] = input_[addr + i];
-    return 0;
+  int connect() override {
+    int rc = SerialModbusClient::connect();
+    idle_at_ = clock::now() + silence_;
+    return rc;
   }
 
-  int write_single_coil(int /*unit*/, int addr, bool on) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (addr < 0 || addr >= static_cast<int>(coils_.size())) return make_modbus_exception(2);
-    coils_[addr] = on ? 1 : 0;
-    return 0;
+  void set_frame_silence_ms(int ms) override {
+    silence_ = std::chrono::milliseconds(ms > 0 ? ms : 0);
   }
 
-  int write_single_reg(int /*unit*/, int addr, std::uint16_t value) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (addr < 0 || addr >= static_cast<int>(holding_.size())) return make_modbus_exception(2);
-    holding_[addr] = value;
-    return 0;
+protected:
+  int exchange(int unit, int len) override {
+    int n = 0;
+    std::uint8_t sum = static_cast<std::uint8_t>(unit);
+    tx_[n++] = ':';
+    put_hex(tx_ + n, static_cast<std::uint8_t>(unit));
+    n += 2;
+    for (int i = 0; i < len; ++i) {
+      sum = static_cast<std::uint8_t>(sum + pdu_[i]);
+      put_hex(tx_ + n, pdu_[i]);
+      n += 2;
+    }
+    put_hex(tx_ + n, static_cast<std::uint8_t>(-sum));
+    n += 2;
+    tx_[n++] = '\r';
+    tx_[n++] = '\n';
+
+    std::this_thread::sleep_until(idle_at_);
+    discard_input();
+    int rc = write_all(tx_, n, clock::now() + std::chrono::milliseconds(timeout_ms_));
+    if (rc != 0) return rc;
+    const clock::time_point sent = clock::now();
+    if (unit == 0) {
+      idle_at_ = sent + std::max<clock::duration>(silence_, kBroadcastTurnaround);
+      return 0;
+    }
+    rc = receive(unit, sent + std::chrono::milliseconds(timeout_ms_));
+    idle_at_ = clock::now() + silence_;
+    return rc;
   }
 
-  int write_multiple_coils(int /*unit*/, int addr, int count, const std::uint8_t* v) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (!v || addr < 0 || count < 0) return static_cast<int>(ModbusErr::INVALID_ARG);
-    if (addr + count > static_cast<int>(coils_.size())) return make_modbus_exception(2);
-    for (int i = 0; i < count; ++i) coils_[addr + i] = v[i] ? 1 : 0;
-    return 0;
+private:
+  enum class Rx { Idle, Hi, Lo, Lf };
+
+  void put_hex(std::uint8_t* p, std::uint8_t b) const { std::memcpy(p, hex_.digits[b], 2); }
+
+  // Assemble the response as it streams in: hex pairs are decoded into rx_
+  // on arrival, so the frame is complete and checked as soon as LF is seen.
+  // Bytes before ':' are line noise and skipped; a second ':' restarts.
+  int receive(int unit, clock::time_point deadline) {
+    Rx state = Rx::Idle;
+    int len = 0;
+    int hi = 0;
+    bool bad = false;
+    std::uint8_t chunk[64];
+    for (;;) {
+      const int n = read_some(chunk, sizeof(chunk), deadline);
+      if (n < 0) return n;
+      for (int i = 0; i < n; ++i) {
+        const std::uint8_t ch = chunk[i];
+        if (ch == ':') { state = Rx::Hi; len = 0; bad = false; continue; }
+        const int v = hex_.value[ch];
+        switch (state) {
+          case Rx::Idle:
+            break;
+          case Rx::Hi:
+            if (ch == '\r') { state = Rx::Lf; break; }
+            if (v < 0 || len == kMaxFrame) bad = true;
+            hi = v;
+            state = Rx::Lo;
+            break;
+          case Rx::Lo:
+            if (ch == '\r') { bad = true; state = Rx::Lf; break; }  // odd number of digits
+            if (v < 0) bad = true;
+            if (!bad) rx_[len++] = static_cast<std::uint8_t>((hi << 4) | v);
+            state = Rx::Hi;
+            break;
+          case Rx::Lf:
+            if (ch != '\n') bad = true;
+            return finish(unit, len, bad);
+        }
+      }
+    }
   }
 
-  int write_multiple_regs(int /*unit*/, int addr, int count, const std::uint16_t* v) override {
-    if (!connected_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
-    if (!v || addr < 0 || count < 0) return static_cast<int>(ModbusErr::INVALID_ARG);
-    if (addr + count > static_cast<int>(holding_.size())) return make_modbus_exception(2);
-    for (int i = 0; i < count; ++i) holding_[addr + i] = v[i];
-    return 0;
+  // Check a complete frame in rx_ and move its PDU to rsp_.
+  int finish(int unit, int len, bool bad) {
+    if (bad || len < 3) return err(ModbusErr::IO_ERROR);
+    std::uint8_t sum = 0;
+    for (int i = 0; i < len; ++i) sum = static_cast<std::uint8_t>(sum + rx_[i]);
+    if (sum != 0 && lrc_check_) return err(ModbusErr::LRC_ERROR);
+    if (rx_[0] != static_cast<std::uint8_t>(unit)) return err(ModbusErr::IO_ERROR);
+    std::memcpy(rsp_, rx_ + 1, static_cast<std::size_t>(len - 2));
+    return len - 2;
   }
 
-private:
-  AsciiConfig cfg_;
-  int frame_silence_ms_;
-  bool connected_{false};
-  std::vector<std::uint8_t> coils_;
-  std::vector<std::uint8_t> discrete_;
-  std::vector<std::uint16_t> holding_;
-  std::vector<std::uint16_t> input_;
+  bool lrc_check_;
+  const HexTables& hex_;
+  std::chrono::milliseconds silence_{0};
+  clock::time_point idle_at_{};        // earliest time the next frame may start
+  std::uint8_t tx_[kMaxWire];
+  std::uint8_t rx_[kMaxFrame];
 };
 
 } // namespace
 
-std::unique_ptr<IModbusClient> make_ascii_client(const AsciiConfig& cfg,
-                                                 int coils_size,
-                                                 int discrete_inputs_size,
-                                                 int holding_regs_size,
-                                                 int input_regs_size) {
-  return std::unique_ptr<IModbusClient>(
-      new AsciiStubClient(cfg, coils_size, discrete_inputs_size, holding_regs_size, input_regs_size));
+std::unique_ptr<IModbusClient> make_ascii_client(const AsciiConfig& cfg) {
+  return std::unique_ptr<IModbusClient>(new AsciiClient(cfg));
 }
 
 } // namespace wiq
-
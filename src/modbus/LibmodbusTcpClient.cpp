@@ -0,0 +1,156 @@
+#include "TcpModbusClient.hpp"
+
+#if defined(WITH_LIBMODBUS)
+#include "log.hpp"
+#include <cerrno>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <winsock2.h>
+# include <ws2tcpip.h>
+# include <windows.h>
+#endif
+
+#include <modbus.h>
+
+namespace wiq {
+
+namespace {
+
+#if defined(_WIN32)
+static std::pair<int, std::string> last_socket_error() {
+  int err = WSAGetLastError();
+  if (err == 0) return {0, {}};
+  LPSTR msg_buf = nullptr;
+  DWORD flags = FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
+  DWORD len = FormatMessageA(flags, nullptr, static_cast<DWORD>(err), 0, reinterpret_cast<LPSTR>(&msg_buf), 0, nullptr);
+  std::string message;
+  if (len != 0 && msg_buf) {
+    message.assign(msg_buf, len);
+    LocalFree(msg_buf);
+    while (!message.empty() && (message.back() == '\r' || message.back() == '\n')) message.pop_back();
+  }
+  return {err, message};
+}
+#endif
+
+class LibmodbusTcpClient : public IModbusClient {
+public:
+  LibmodbusTcpClient(std::string host, int port)
+  : host_(std::move(host)), port_(port), ctx_(nullptr), timeout_ms_(1000) {}
+  ~LibmodbusTcpClient() override { close(); }
+
+  int connect() override {
+    close();
+    ctx_ = modbus_new_tcp(host_.c_str(), port_);
+    if (!ctx_) return static_cast<int>(ModbusErr::IO_ERROR);
+    // set timeouts
+    set_timeout_ms(timeout_ms_);
+    if (modbus_connect(ctx_) == -1) {
+#if defined(_WIN32)
+      auto wsa_info = last_socket_error();
+      int wsa_err = wsa_info.first;
+      const std::string& wsa_msg = wsa_info.second;
+      log::log_warn(__FILE__, __LINE__,
+                         "modbus_connect failed: %s (errno=%d, WSA=%d%s%s)",
+                         modbus_strerror(errno), errno,
+                         wsa_err,
+                         wsa_msg.empty() ? "" : ", ",
+                         wsa_msg.empty() ? "" : wsa_msg.c_str());
+#else
+      log::log_warn(__FILE__, __LINE__, "modbus_connect failed: %s (errno=%d)",
+                         modbus_strerror(errno), errno);
+#endif
+      modbus_free(ctx_); ctx_ = nullptr; return static_cast<int>(ModbusErr::IO_ERROR);
+    }
+    return 0;
+  }
+  void close() override {
+    if (ctx_) { modbus_close(ctx_); modbus_free(ctx_); ctx_ = nullptr; }
+  }
+  void set_timeout_ms(int ms) override {
+    timeout_ms_ = ms;
+    if (ctx_) {
+      struct timeval tv; tv.tv_sec = ms/1000; tv.tv_usec = (ms%1000)*1000;
+      modbus_set_response_timeout(ctx_, tv.tv_sec, tv.tv_usec);
+    }
+  }
+
+  int read_coils(int unit, int addr, int count, std::uint8_t* out) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_read_bits(ctx_, addr, count, out);
+    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int read_discrete_inputs(int unit, int addr, int count, std::uint8_t* out) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_read_input_bits(ctx_, addr, count, out);
+    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int read_holding_regs(int unit, int addr, int count, std::uint16_t* out) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_read_registers(ctx_, addr, count, out);
+    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int read_input_regs(int unit, int addr, int count, std::uint16_t* out) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_read_input_registers(ctx_, addr, count, out);
+    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int write_single_coil(int unit, int addr, bool on) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_write_bit(ctx_, addr, on ? 1 : 0);
+    return (rc == 1) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int write_single_reg(int unit, int addr, std::uint16_t value) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_write_register(ctx_, addr, value);
+    return (rc == 1) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int write_multiple_coils(int unit, int addr, int count, const std::uint8_t* v) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_write_bits(ctx_, addr, count, v);
+    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+  int write_multiple_regs(int unit, int addr, int count, const std::uint16_t* v) override {
+    if (!ctx_) return static_cast<int>(ModbusErr::NOT_CONNECTED);
+    modbus_set_slave(ctx_, unit);
+    int rc = modbus_write_registers(ctx_, addr, count, v);
+    return (rc == count) ? 0 : static_cast<int>(ModbusErr::IO_ERROR);
+  }
+
+private:
+  std::string host_; int port_;
+  modbus_t* ctx_;
+  int timeout_ms_;
+};
+
+} // namespace
+
+std::unique_ptr<IModbusClient> make_libmodbus_tcp_client(const std::string& host, int port) {
+  return std::unique_ptr<IModbusClient>(new LibmodbusTcpClient(host, port));
+}
+
+} // namespace wiq
+
+#else
+
+namespace wiq {
+
+std::unique_ptr<IModbusClient> make_libmodbus_tcp_client(const std::string& /*host*/, int /*port*/) {
+  return nullptr;
+}
+
+} // namespace wiq
+
+#endif
@@ -0,0 +1,142 @@
+#include "RtuModbusClient.hpp"
+#include "ModbusError.hpp"
+#include "modbus/Crc16.hpp"
+#include "modbus/SerialModbusClient.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace wiq {
+
+namespace {
+
+inline int err(ModbusErr e) { return static_cast<int>(e); }
+
+constexpr int kMaxAdu = 256;  // address + 253-byte PDU + CRC
+
+// Above 19200 baud the spec fixes t1.5/t3.5 instead of scaling them.
+constexpr std::chrono::microseconds kFastT15{750};
+constexpr std::chrono::microseconds kFastT35{1750};
+// Slaves need time to process a broadcast before the next request.
+constexpr std::chrono::milliseconds kBroadcastTurnaround{100};
+
+// Length of the response ADU whose first three bytes are in `adu`, or -1 for
+// a function code whose response size is not known.
+int expected_adu_len(const std::uint8_t* adu) {
+  const std::uint8_t fc = adu[1];
+  if (fc & 0x80) return 5;                          // addr, fc, exception code, CRC
+  if (fc >= 0x01 && fc <= 0x04) return 5 + adu[2];  // addr, fc, byte count, data, CRC
+  if (fc == 0x05 || fc == 0x06 || fc == 0x0F || fc == 0x10) return 8;
+  return -1;
+}
+
+class RtuClient : public SerialModbusClient {
+public:
+  explicit RtuClient(const RtuConfig& cfg)
+  : SerialModbusClient(SerialLineCfg{cfg.port, cfg.baud, cfg.parity, cfg.data_bits, cfg.stop_bits}, cfg.timeout_ms) {
+    const bool fast = cfg.baud > 19200;
+    const std::chrono::microseconds c = char_time();
+    t15_ = fast ? kFastT15 : std::chrono::microseconds((c.count() * 3 + 1) / 2);
+    t35_ = fast ? kFastT35 : std::chrono::microseconds((c.count() * 7 + 1) / 2);
+    // USB-serial adapters hand received bytes over in bursts (FTDI's default
+    // latency timer is 16 ms); the allowance lets such a line keep its frames.
+    char_gap_ = t15_ + std::chrono::milliseconds(cfg.char_gap_allowance_ms);
+    set_frame_silence_ms(cfg.frame_silence_ms);
+  }
+
+  int connect() override {
+    int rc = SerialModbusClient::connect();
+    idle_at_ = clock::now() + silence_;
+    return rc;
+  }
+
+  void set_frame_silence_ms(int ms) override {
+    silence_ = ms > 0 ? std::chrono::microseconds(ms * 1000LL) : t35_;
+  }
+
+protected:
+  int exchange(int unit, int len) override {
+    adu_[0] = static_cast<std::uint8_t>(unit);
+    std::memcpy(adu_ + 1, pdu_, static_cast<std::size_t>(len));
+    const std::uint16_t crc = crc16_modbus(adu_, len + 1);
+    adu_[len + 1] = static_cast<std::uint8_t>(crc & 0xFF);
+    adu_[len + 2] = static_cast<std::uint8_t>(crc >> 8);
+
+    // A frame must be preceded by t3.5 of silence; anything that arrived in
+    // the meantime is a late reply to an earlier request.
+    std::this_thread::sleep_until(idle_at_);
+    discard_input();
+    int rc = write_all(adu_, len + 3, clock::now() + std::chrono::milliseconds(timeout_ms_));
+    if (rc != 0) return rc;
+    const clock::time_point sent = clock::now();
+    if (unit == 0) {
+      idle_at_ = sent + std::max<clock::duration>(silence_, kBroadcastTurnaround);
+      return 0;
+    }
+    rc = receive(unit, sent + std::chrono::milliseconds(timeout_ms_));
+    idle_at_ = clock::now() + silence_;
+    return rc;
+  }
+
+private:
+  // Read one response ADU into rx_ and copy its PDU to rsp_. The frame length
+  // is known after three bytes, so this returns on its last byte.
+  int receive(int unit, clock::time_point deadline) {
+    const clock::duration gap = char_gap_;
+    int have = 0;
+    int need = 3;
+    bool sized = false;
+    while (have < need) {
+      const clock::time_point limit = have == 0 ? deadline : std::min(deadline, clock::now() + gap);
+      int n = read_some(rx_ + have, need - have, limit);
+      if (n < 0) {
+        if (n == err(ModbusErr::IO_TIMEOUT) && have > 0) {
+          resync(deadline);
+          return clock::now() >= deadline ? n : err(ModbusErr::IO_ERROR);  // truncated frame
+        }
+        return n;
+      }
+      have += n;
+      if (!sized && have >= 3) {
+        need = expected_adu_len(rx_);
+        if (need < 0 || need > kMaxAdu) { resync(deadline); return err(ModbusErr::IO_ERROR); }
+        sized = true;
+      }
+    }
+    const std::uint16_t crc = crc16_modbus(rx_, need - 2);
+    if (rx_[need - 2] != (crc & 0xFF) || rx_[need - 1] != (crc >> 8)) {
+      resync(deadline);
+      return err(ModbusErr::CRC_ERROR);
+    }
+    if (rx_[0] != static_cast<std::uint8_t>(unit)) return err(ModbusErr::IO_ERROR);
+    std::memcpy(rsp_, rx_ + 1, static_cast<std::size_t>(need - 3));
+    return need - 3;
+  }
+
+  // After a framing error, discard bytes until the line has been quiet for
+  // t3.5 (or the request's deadline passes) so the next frame starts clean.
+  void resync(clock::time_point deadline) {
+    std::uint8_t junk[64];
+    for (;;) {
+      const clock::time_point limit = std::min(deadline, clock::now() + silence_);
+      if (read_some(junk, sizeof(junk), limit) < 0) break;
+    }
+    discard_input();
+  }
+
+  std::chrono::microseconds t15_;
+  std::chrono::microseconds t35_;
+  std::chrono::microseconds char_gap_;  // longest pause tolerated inside a frame
+  std::chrono::microseconds silence_;
+  clock::time_point idle_at_{};        // earliest time the next frame may start
+  std::uint8_t adu_[kMaxAdu];
+  std::uint8_t rx_[kMaxAdu];
+};
+
+} // namespace
+
+std::unique_ptr<IModbusClient> make_rtu_client(const RtuConfig& cfg) {
+  return std::unique_ptr<IModbusClient>(new RtuClient(cfg));
+}
+
+} // namespace wiq
@@ -0,0 +1,293 @@
+#include "modbus/SerialModbusClient.hpp"
+#include "ModbusError.hpp"
+#include "log.hpp"
+#include <cstring>
+
+#if !defined(_WIN32)
+# include <cerrno>
+# include <fcntl.h>
+# include <poll.h>
+# include <termios.h>
+# include <unistd.h>
+#endif
+
+namespace wiq {
+
+namespace {
+
+inline void put_u16(std::uint8_t* p, int v) {
+  p[0] = static_cast<std::uint8_t>((v >> 8) & 0xFF);
+  p[1] = static_cast<std::uint8_t>(v & 0xFF);
+}
+inline int get_u16(const std::uint8_t* p) { return (int(p[0]) << 8) | int(p[1]); }
+
+inline int err(ModbusErr e) { return static_cast<int>(e); }
+
+bool valid_range(int addr, int count, int max_count) {
+  return addr >= 0 && count >= 1 && count <= max_count && addr + count <= 0x10000;
+}
+
+#if !defined(_WIN32)
+bool baud_constant(int baud, speed_t& out) {
+  switch (baud) {
+    case 1200: out = B1200; return true;
+    case 2400: out = B2400; return true;
+    case 4800: out = B4800; return true;
+    case 9600: out = B9600; return true;
+    case 19200: out = B19200; return true;
+    case 38400: out = B38400; return true;
+    case 57600: out = B57600; return true;
+    case 115200: out = B115200; return true;
+#if defined(B230400)
+    case 230400: out = B230400; return true;
+#endif
+    default: return false;
+  }
+}
+
+// EIO/ENXIO/ENODEV: the adapter was unplugged or the pty peer closed.
+inline bool line_lost(int e) { return e == EIO || e == ENXIO || e == ENODEV || e == EBADF; }
+#endif
+
+} // namespace
+
+SerialModbusClient::SerialModbusClient(const SerialLineCfg& line, int timeout_ms)
+: line_(line), timeout_ms_(timeout_ms > 0 ? timeout_ms : 1) {}
+
+SerialModbusClient::~SerialModbusClient() { close(); }
+
+#if defined(_WIN32)
+
+int SerialModbusClient::connect() {
+  log::log_error(__FILE__, __LINE__, "serial: %s: serial transports are not supported on Windows yet", line_.port.c_str());
+  return err(ModbusErr::UNSUPPORTED);
+}
+
+void SerialModbusClient::close() {}
+
+std::chrono::microseconds SerialModbusClient::char_time() const { return std::chrono::microseconds(1000); }
+
+int SerialModbusClient::write_all(const std::uint8_t*, int, clock::time_point) { return err(ModbusErr::NOT_CONNECTED); }
+
+int SerialModbusClient::read_some(std::uint8_t*, int, clock::time_point) { return err(ModbusErr::NOT_CONNECTED); }
+
+void SerialModbusClient::discard_input() {}
+
+#else
+
+int SerialModbusClient::connect() {
+  close();
+  speed_t speed;
+  if (!baud_constant(line_.baud, speed)) {
+    log::log_error(__FILE__, __LINE__, "serial: unsupported baud rate %d", line_.baud);
+    return err(ModbusErr::INVALID_ARG);
+  }
+  int fd = ::open(line_.port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    log::log_warn(__FILE__, __LINE__, "serial: cannot open '%s' (errno %d)", line_.port.c_str(), errno);
+    return err(ModbusErr::IO_ERROR);
+  }
+  termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    log::log_warn(__FILE__, __LINE__, "serial: '%s' is not a terminal (errno %d)", line_.port.c_str(), errno);
+    ::close(fd);
+    return err(ModbusErr::IO_ERROR);
+  }
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  tio.c_cflag &= ~static_cast<tcflag_t>(CSIZE | CSTOPB | PARENB | PARODD);
+  tio.c_cflag |= line_.data_bits == 7 ? CS7 : CS8;
+  if (line_.stop_bits == 2) tio.c_cflag |= CSTOPB;
+  if (line_.parity == 'E') tio.c_cflag |= PARENB;
+  if (line_.parity == 'O') tio.c_cflag |= PARENB | PARODD;
+  tio.c_cflag |= CLOCAL | CREAD;
+#if defined(CRTSCTS)
+  tio.c_cflag &= ~static_cast<tcflag_t>(CRTSCTS);
+#endif
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+    log::log_warn(__FILE__, __LINE__, "serial: cannot configure '%s' (errno %d)", line_.port.c_str(), errno);
+    ::close(fd);
+    return err(ModbusErr::IO_ERROR);
+  }
+  tcflush(fd, TCIOFLUSH);
+  fd_ = fd;
+  return 0;
+}
+
+void SerialModbusClient::close() {
+  if (fd_ >= 0) { ::close(fd_); fd_ = -1; }
+}
+
+std::chrono::microseconds SerialModbusClient::char_time() const {
+  const int bits = 1 + line_.data_bits + (line_.parity == 'N' ? 0 : 1) + line_.stop_bits;
+  const int baud = line_.baud > 0 ? line_.baud : 9600;
+  return std::chrono::microseconds((bits * 1000000LL + baud - 1) / baud);
+}
+
+int SerialModbusClient::write_all(const std::uint8_t* p, int n, clock::time_point deadline) {
+  if (fd_ < 0) return err(ModbusErr::NOT_CONNECTED);
+  int sent = 0;
+  while (sent < n) {
+    ssize_t r = ::write(fd_, p + sent, static_cast<std::size_t>(n - sent));
+    if (r > 0) { sent += static_cast<int>(r); continue; }
+    const int e = errno;
+    if (r < 0 && e == EINTR) continue;
+    if (r < 0 && (e == EAGAIN || e == EWOULDBLOCK)) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+      if (left < 0) return err(ModbusErr::IO_TIMEOUT);
+      pollfd pfd{fd_, POLLOUT, 0};
+      (void)::poll(&pfd, 1, static_cast<int>(left) + 1);
+      continue;
+    }
+    return err(line_lost(e) ? ModbusErr::NOT_CONNECTED : ModbusErr::IO_ERROR);
+  }
+  // Block until the driver has shifted the frame out, so that response and
+  // silence timing starts at the end of transmission.
+  while (tcdrain(fd_) != 0) {
+    if (errno == EINTR) continue;
+    if (line_lost(errno)) return err(ModbusErr::NOT_CONNECTED);
+    break;  // not every device node implements it (e.g. some pty drivers)
+  }
+  return 0;
+}
+
+int SerialModbusClient::read_some(std::uint8_t* p, int n, clock::time_point deadline) {
+  if (fd_ < 0) return err(ModbusErr::NOT_CONNECTED);
+  for (;;) {
+    ssize_t r = ::read(fd_, p, static_cast<std::size_t>(n));
+    if (r > 0) return static_cast<int>(r);
+    // With VMIN=VTIME=0 an empty queue reads as 0 rather than EAGAIN.
+    if (r < 0) {
+      const int e = errno;
+      if (line_lost(e)) return err(ModbusErr::NOT_CONNECTED);
+      if (e == EINTR) continue;
+      if (e != EAGAIN && e != EWOULDBLOCK) return err(ModbusErr::IO_ERROR);
+    }
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - clock::now()).count();
+    if (left <= 0) return err(ModbusErr::IO_TIMEOUT);
+    pollfd pfd{fd_, POLLIN, 0};
+    // Round up so the final sub-millisecond slice is still waited for.
+    int pr = ::poll(&pfd, 1, static_cast<int>((left + 999) / 1000));
+    if (pr < 0 && errno != EINTR) return err(ModbusErr::IO_ERROR);
+    if (pr > 0 && (pfd.revents & POLLNVAL)) return err(ModbusErr::NOT_CONNECTED);
+    if (pr > 0 && (pfd.revents & POLLHUP) && !(pfd.revents & POLLIN)) return err(ModbusErr::NOT_CONNECTED);
+    // POLLIN/POLLERR: the next read() reports data or the cause.
+  }
+}
+
+void SerialModbusClient::discard_input() {
+  if (fd_ >= 0) tcflush(fd_, TCIFLUSH);
+}
+
+#endif
+
+// --- PDU encoding, shared by every serial framing ---
+
+int SerialModbusClient::read_coils(int unit, int addr, int count, std::uint8_t* out) {
+  return read_bits(0x01, unit, addr, count, out);
+}
+int SerialModbusClient::read_discrete_inputs(int unit, int addr, int count, std::uint8_t* out) {
+  return read_bits(0x02, unit, addr, count, out);
+}
+int SerialModbusClient::read_holding_regs(int unit, int addr, int count, std::uint16_t* out) {
+  return read_regs(0x03, unit, addr, count, out);
+}
+int SerialModbusClient::read_input_regs(int unit, int addr, int count, std::uint16_t* out) {
+  return read_regs(0x04, unit, addr, count, out);
+}
+
+int SerialModbusClient::write_single_coil(int unit, int addr, bool on) {
+  if (!valid_range(addr, 1, 1)) return err(ModbusErr::INVALID_ARG);
+  pdu_[0] = 0x05;
+  put_u16(pdu_ + 1, addr);
+  put_u16(pdu_ + 3, on ? 0xFF00 : 0x0000);
+  return transact_echo(unit, 5, 5);
+}
+
+int SerialModbusClient::write_single_reg(int unit, int addr, std::uint16_t value) {
+  if (!valid_range(addr, 1, 1)) return err(ModbusErr::INVALID_ARG);
+  pdu_[0] = 0x06;
+  put_u16(pdu_ + 1, addr);
+  put_u16(pdu_ + 3, value);
+  return transact_echo(unit, 5, 5);
+}
+
+int SerialModbusClient::write_multiple_coils(int unit, int addr, int count, const std::uint8_t* v) {
+  if (!v || !valid_range(addr, count, 1968)) return err(ModbusErr::INVALID_ARG);
+  const int nbytes = (count + 7) / 8;
+  pdu_[0] = 0x0F;
+  put_u16(pdu_ + 1, addr);
+  put_u16(pdu_ + 3, count);
+  pdu_[5] = static_cast<std::uint8_t>(nbytes);
+  std::memset(pdu_ + 6, 0, static_cast<std::size_t>(nbytes));
+  for (int i = 0; i < count; ++i) {
+    if (v[i]) pdu_[6 + i / 8] |= static_cast<std::uint8_t>(1u << (i % 8));
+  }
+  return transact_echo(unit, 6 + nbytes, 5);
+}
+
+int SerialModbusClient::write_multiple_regs(int unit, int addr, int count, const std::uint16_t* v) {
+  if (!v || !valid_range(addr, count, 123)) return err(ModbusErr::INVALID_ARG);
+  pdu_[0] = 0x10;
+  put_u16(pdu_ + 1, addr);
+  put_u16(pdu_ + 3, count);
+  pdu_[5] = static_cast<std::uint8_t>(count * 2);
+  for (int i = 0; i < count; ++i) put_u16(pdu_ + 6 + 2 * i, v[i]);
+  return transact_echo(unit, 6 + 2 * count, 5);
+}
+
+int SerialModbusClient::read_bits(std::uint8_t fc, int unit, int addr, int count, std::uint8_t* out) {
+  int n = stage_read(fc, unit, addr, count, out);
+  if (n == 0) n = transact(unit, 5);
+  if (n < 0) return n;
+  const int nbytes = (count + 7) / 8;
+  if (n != 2 + nbytes || rsp_[1] != nbytes) return err(ModbusErr::IO_ERROR);
+  for (int i = 0; i < count; ++i) out[i] = (rsp_[2 + i / 8] >> (i % 8)) & 1u;
+  return 0;
+}
+
+int SerialModbusClient::read_regs(std::uint8_t fc, int unit, int addr, int count, std::uint16_t* out) {
+  int n = stage_read(fc, unit, addr, count, out);
+  if (n == 0) n = transact(unit, 5);
+  if (n < 0) return n;
+  if (n != 2 + 2 * count || rsp_[1] != 2 * count) return err(ModbusErr::IO_ERROR);
+  for (int i = 0; i < count; ++i) out[i] = static_cast<std::uint16_t>(get_u16(rsp_ + 2 + 2 * i));
+  return 0;
+}
+
+// Stage an FC1-FC4 request PDU in pdu_. Reads cannot be broadcast.
+int SerialModbusClient::stage_read(std::uint8_t fc, int unit, int addr, int count, const void* out) {
+  const int limit = (fc == 0x01 || fc == 0x02) ? 2000 : 125;
+  if (!out || unit == 0 || !valid_range(addr, count, limit)) return err(ModbusErr::INVALID_ARG);
+  pdu_[0] = fc;
+  put_u16(pdu_ + 1, addr);
+  put_u16(pdu_ + 3, count);
+  return 0;
+}
+
+// Write responses echo the first `echo_len` bytes of the request PDU.
+int SerialModbusClient::transact_echo(int unit, int len, int echo_len) {
+  int n = transact(unit, len);
+  if (n <= 0) return n;  // error, or a broadcast that gets no response
+  if (n != echo_len || std::memcmp(rsp_, pdu_, static_cast<std::size_t>(echo_len)) != 0) {
+    return err(ModbusErr::IO_ERROR);
+  }
+  return 0;
+}
+
+// Run one exchange and check the response function code.
+int SerialModbusClient::transact(int unit, int len) {
+  if (unit < 0 || unit > 247) return err(ModbusErr::INVALID_ARG);
+  if (fd_ < 0) return err(ModbusErr::NOT_CONNECTED);
+  const std::uint8_t fc = pdu_[0];
+  int n = exchange(unit, len);
+  if (n <= 0) return n;
+  if (rsp_[0] == (fc | 0x80)) return make_modbus_exception(n >= 2 ? rsp_[1] : 0);
+  if (rsp_[0] != fc) return err(ModbusErr::IO_ERROR);
+  return n;
+}
+
+} // namespace wiq
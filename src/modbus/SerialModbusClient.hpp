@@ -0,0 +1,76 @@
+#pragma once
+
+#include "IModbusClient.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace wiq {
+
+// Line settings shared by the serial transports.
+struct SerialLineCfg {
+  std::string port;
+  int baud{9600};
+  char parity{'N'};   // 'N', 'E', 'O'
+  int data_bits{8};
+  int stop_bits{1};
+};
+
+// Common part of the serial (RTU/ASCII) clients: owns the termios line and
+// builds request / checks response PDUs. Subclasses only frame the PDU on
+// the wire in exchange().
+class SerialModbusClient : public IModbusClient {
+public:
+  SerialModbusClient(const SerialLineCfg& line, int timeout_ms);
+  ~SerialModbusClient() override;
+
+  int connect() override;
+  void close() override;
+  void set_timeout_ms(int ms) override { timeout_ms_ = ms > 0 ? ms : 1; }
+
+  int read_coils(int unit, int addr, int count, std::uint8_t* out) override;
+  int read_discrete_inputs(int unit, int addr, int count, std::uint8_t* out) override;
+  int read_holding_regs(int unit, int addr, int count, std::uint16_t* out) override;
+  int read_input_regs(int unit, int addr, int count, std::uint16_t* out) override;
+
+  int write_single_coil(int unit, int addr, bool on) override;
+  int write_single_reg(int unit, int addr, std::uint16_t value) override;
+  int write_multiple_coils(int unit, int addr, int count, const std::uint8_t* v) override;
+  int write_multiple_regs(int unit, int addr, int count, const std::uint16_t* v) override;
+
+protected:
+  using clock = std::chrono::steady_clock;
+  static constexpr int kMaxPdu = 253;
+
+  // Send the request PDU staged in pdu_ (`len` bytes) to `unit` and receive
+  // the response PDU into rsp_. Returns the response PDU length, 0 for a
+  // broadcast (unit 0, no response), or a negative error code.
+  virtual int exchange(int unit, int len) = 0;
+
+  bool is_open() const { return fd_ >= 0; }
+  // Duration of one character (start + data + parity + stop bits).
+  std::chrono::microseconds char_time() const;
+  // Write all bytes and wait until they left the UART; 0 or an error code.
+  int write_all(const std::uint8_t* p, int n, clock::time_point deadline);
+  // Read up to `n` bytes, waiting until `deadline` for the first one. Returns
+  // the count, IO_TIMEOUT, or NOT_CONNECTED when the line went away.
+  int read_some(std::uint8_t* p, int n, clock::time_point deadline);
+  // Drop whatever the driver has buffered on the receive side.
+  void discard_input();
+
+  SerialLineCfg line_;
+  int timeout_ms_;
+  std::uint8_t pdu_[kMaxPdu];
+  std::uint8_t rsp_[kMaxPdu];
+
+private:
+  int transact(int unit, int len);
+  int transact_echo(int unit, int len, int echo_len);
+  int read_bits(std::uint8_t fc, int unit, int addr, int count, std::uint8_t* out);
+  int read_regs(std::uint8_t fc, int unit, int addr, int count, std::uint16_t* out);
+  int stage_read(std::uint8_t fc, int unit, int addr, int count, const void* out);
+
+  int fd_{-1};
+};
+
+} // namespace wiq
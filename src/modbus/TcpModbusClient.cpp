@@ -0,0 +1,463 @@
+#include "TcpModbusClient.hpp"
+#include "ModbusError.hpp"
+#include "log.hpp"
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <winsock2.h>
+# include <ws2tcpip.h>
+#else
+# include <cerrno>
+# include <fcntl.h>
+# include <netdb.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+namespace wiq {
+
+namespace {
+
+#if defined(_WIN32)
+using socket_t = SOCKET;
+const socket_t kNoSocket = INVALID_SOCKET;
+using pollfd_t = WSAPOLLFD;
+inline int poll_one(pollfd_t* p, int ms) { return WSAPoll(p, 1, ms); }
+inline void close_socket(socket_t s) { closesocket(s); }
+inline int last_error() { return WSAGetLastError(); }
+inline bool would_block(int e) { return e == WSAEWOULDBLOCK || e == WSAEINPROGRESS; }
+inline bool interrupted(int e) { return e == WSAEINTR; }
+inline bool connection_lost(int e) {
+  return e == WSAECONNRESET || e == WSAECONNABORTED || e == WSAENOTCONN || e == WSAESHUTDOWN;
+}
+inline bool set_nonblocking(socket_t s) { u_long on = 1; return ioctlsocket(s, FIONBIO, &on) == 0; }
+
+// Winsock must be initialized once per process before any socket call.
+struct WinsockInit {
+  WinsockInit() { WSADATA d; WSAStartup(MAKEWORD(2, 2), &d); }
+  ~WinsockInit() { WSACleanup(); }
+};
+void ensure_winsock() { static WinsockInit init; }
+#else
+using socket_t = int;
+const socket_t kNoSocket = -1;
+using pollfd_t = struct pollfd;
+inline int poll_one(pollfd_t* p, int ms) { return ::poll(p, 1, ms); }
+inline void close_socket(socket_t s) { ::close(s); }
+inline int last_error() { return errno; }
+inline bool would_block(int e) { return e == EAGAIN || e == EWOULDBLOCK || e == EINPROGRESS; }
+inline bool interrupted(int e) { return e == EINTR; }
+inline bool connection_lost(int e) {
+  return e == ECONNRESET || e == ECONNABORTED || e == ENOTCONN || e == EPIPE;
+}
+inline bool set_nonblocking(socket_t s) {
+  int flags = fcntl(s, F_GETFL, 0);
+  return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+void ensure_winsock() {}
+#endif
+
+#if defined(MSG_NOSIGNAL)
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+constexpr int kMbapLen = 7;     // transaction id, protocol id, length, unit id
+constexpr int kMaxAdu = 260;    // MBAP header + 253-byte PDU
+constexpr int kMaxPipelineWindow = 16;
+
+inline void put_u16(std::uint8_t* p, int v) {
+  p[0] = static_cast<std::uint8_t>((v >> 8) & 0xFF);
+  p[1] = static_cast<std::uint8_t>(v & 0xFF);
+}
+inline int get_u16(const std::uint8_t* p) { return (int(p[0]) << 8) | int(p[1]); }
+
+inline int err(ModbusErr e) { return static_cast<int>(e); }
+
+class NativeTcpClient : public IModbusClient {
+public:
+  NativeTcpClient(std::string host, int port) : host_(std::move(host)), port_(port) { ensure_winsock(); }
+  ~NativeTcpClient() override { close(); }
+
+  int connect() override {
+    close();
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo* res = nullptr;
+    std::string port = std::to_string(port_);
+    int gai = getaddrinfo(host_.empty() ? "127.0.0.1" : host_.c_str(), port.c_str(), &hints, &res);
+    if (gai != 0 || !res) {
+      log::log_warn(__FILE__, __LINE__, "tcp: cannot resolve '%s' (%d)", host_.c_str(), gai);
+      return err(ModbusErr::IO_ERROR);
+    }
+    const clock::time_point deadline = clock::now() + std::chrono::milliseconds(timeout_ms_);
+    int rc = err(ModbusErr::IO_ERROR);
+    for (addrinfo* ai = res; ai && fd_ == kNoSocket; ai = ai->ai_next) {
+      socket_t s = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (s == kNoSocket) continue;
+      int one = 1;
+      (void)setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+#if defined(SO_NOSIGPIPE)
+      (void)setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+      if (!set_nonblocking(s)) { close_socket(s); continue; }
+      if (::connect(s, ai->ai_addr, static_cast<int>(ai->ai_addrlen)) != 0) {
+        int e = last_error();
+        if (!would_block(e)) { close_socket(s); continue; }
+        fd_ = s;
+        rc = wait_io(POLLOUT, deadline);
+        int so_err = 0;
+        socklen_t len = sizeof(so_err);
+        if (rc == 0 && (getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&so_err), &len) != 0 || so_err != 0)) {
+          rc = err(ModbusErr::IO_ERROR);
+        }
+        if (rc != 0) { close(); continue; }
+      }
+      fd_ = s;
+      rc = 0;
+    }
+    freeaddrinfo(res);
+    if (rc != 0) {
+      log::log_warn(__FILE__, __LINE__, "tcp: connect to %s:%d failed (%d)", host_.c_str(), port_, rc);
+      return err(ModbusErr::IO_ERROR);
+    }
+    return 0;
+  }
+
+  void close() override {
+    if (fd_ != kNoSocket) { close_socket(fd_); fd_ = kNoSocket; }
+  }
+
+  void set_timeout_ms(int ms) override { timeout_ms_ = ms > 0 ? ms : 1; }
+
+  void set_pipeline_window(int requests) override {
+    window_ = requests < 1 ? 1 : (requests > kMaxPipelineWindow ? kMaxPipelineWindow : requests);
+  }
+
+  // Keep up to window_ reads in flight, each under its own transaction id.
+  // Replies are matched by id in whatever order they arrive; replies to ids
+  // no longer outstanding (timed out earlier) are drained and dropped.
+  void read_batch(ReadRequest* reqs, int n) override {
+    if (window_ <= 1 || n <= 1) { IModbusClient::read_batch(reqs, n); return; }
+    struct InFlight { int tid; int index; clock::time_point deadline; };
+    InFlight inflight[kMaxPipelineWindow];
+    int active = 0;
+    int next = 0;
+    while (next < n || active > 0) {
+      while (active < window_ && next < n) {
+        ReadRequest& r = reqs[next++];
+        const std::uint8_t fc = static_cast<std::uint8_t>(r.function);
+        int rc = (r.function >= 1 && r.function <= 4)
+                     ? stage_read(fc, r.addr, r.count, fc <= 0x02 ? static_cast<const void*>(r.bits) : r.regs)
+                     : err(ModbusErr::UNSUPPORTED);
+        if (rc == 0 && (r.unit < 0 || r.unit > 255)) rc = err(ModbusErr::INVALID_ARG);
+        if (rc == 0 && fd_ == kNoSocket) rc = err(ModbusErr::NOT_CONNECTED);
+        if (rc != 0) { r.rc = rc; continue; }
+        const clock::time_point deadline = clock::now() + std::chrono::milliseconds(timeout_ms_);
+        const int tid = begin_frame(r.unit, 5);
+        rc = send_all(tx_, kMbapLen + 5, deadline);
+        if (rc != 0) {
+          close();
+          r.rc = rc;
+          fail_batch(reqs, n, inflight, active, next, rc);
+          return;
+        }
+        inflight[active++] = InFlight{tid, next - 1, deadline};
+      }
+      if (active == 0) continue;
+
+      clock::time_point earliest = inflight[0].deadline;
+      for (int i = 1; i < active; ++i) if (inflight[i].deadline < earliest) earliest = inflight[i].deadline;
+      int got = 0;
+      int len = recv_frame(earliest, got);
+      if (len == err(ModbusErr::IO_TIMEOUT) && got == 0) {
+        // Expire what is overdue; the stream is still aligned for the rest.
+        const clock::time_point now = clock::now();
+        for (int i = 0; i < active;) {
+          if (inflight[i].deadline > now) { ++i; continue; }
+          reqs[inflight[i].index].rc = len;
+          inflight[i] = inflight[--active];
+        }
+        continue;
+      }
+      if (len < 0) {
+        close();
+        fail_batch(reqs, n, inflight, active, next, len);
+        return;
+      }
+      const int tid = get_u16(rx_);
+      for (int i = 0; i < active; ++i) {
+        if (inflight[i].tid != tid) continue;
+        ReadRequest& r = reqs[inflight[i].index];
+        const std::uint8_t fc = static_cast<std::uint8_t>(r.function);
+        int rc = check_reply(r.unit, fc, len);
+        r.rc = rc < 0 ? rc : decode_read(fc, r.count, rc, r.bits, r.regs);
+        inflight[i] = inflight[--active];
+        break;
+      }
+    }
+  }
+
+  int read_coils(int unit, int addr, int count, std::uint8_t* out) override {
+    return read_bits(0x01, unit, addr, count, out);
+  }
+  int read_discrete_inputs(int unit, int addr, int count, std::uint8_t* out) override {
+    return read_bits(0x02, unit, addr, count, out);
+  }
+  int read_holding_regs(int unit, int addr, int count, std::uint16_t* out) override {
+    return read_regs(0x03, unit, addr, count, out);
+  }
+  int read_input_regs(int unit, int addr, int count, std::uint16_t* out) override {
+    return read_regs(0x04, unit, addr, count, out);
+  }
+
+  int write_single_coil(int unit, int addr, bool on) override {
+    if (!valid_range(addr, 1, 1)) return err(ModbusErr::INVALID_ARG);
+    std::uint8_t* pdu = tx_ + kMbapLen;
+    pdu[0] = 0x05;
+    put_u16(pdu + 1, addr);
+    put_u16(pdu + 3, on ? 0xFF00 : 0x0000);
+    return transact_echo(unit, 5, 5);
+  }
+
+  int write_single_reg(int unit, int addr, std::uint16_t value) override {
+    if (!valid_range(addr, 1, 1)) return err(ModbusErr::INVALID_ARG);
+    std::uint8_t* pdu = tx_ + kMbapLen;
+    pdu[0] = 0x06;
+    put_u16(pdu + 1, addr);
+    put_u16(pdu + 3, value);
+    return transact_echo(unit, 5, 5);
+  }
+
+  int write_multiple_coils(int unit, int addr, int count, const std::uint8_t* v) override {
+    if (!v || !valid_range(addr, count, 1968)) return err(ModbusErr::INVALID_ARG);
+    std::uint8_t* pdu = tx_ + kMbapLen;
+    const int nbytes = (count + 7) / 8;
+    pdu[0] = 0x0F;
+    put_u16(pdu + 1, addr);
+    put_u16(pdu + 3, count);
+    pdu[5] = static_cast<std::uint8_t>(nbytes);
+    std::memset(pdu + 6, 0, static_cast<std::size_t>(nbytes));
+    for (int i = 0; i < count; ++i) {
+      if (v[i]) pdu[6 + i / 8] |= static_cast<std::uint8_t>(1u << (i % 8));
+    }
+    return transact_echo(unit, 6 + nbytes, 5);
+  }
+
+  int write_multiple_regs(int unit, int addr, int count, const std::uint16_t* v) override {
+    if (!v || !valid_range(addr, count, 123)) return err(ModbusErr::INVALID_ARG);
+    std::uint8_t* pdu = tx_ + kMbapLen;
+    pdu[0] = 0x10;
+    put_u16(pdu + 1, addr);
+    put_u16(pdu + 3, count);
+    pdu[5] = static_cast<std::uint8_t>(count * 2);
+    for (int i = 0; i < count; ++i) put_u16(pdu + 6 + 2 * i, v[i]);
+    return transact_echo(unit, 6 + 2 * count, 5);
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  static bool valid_range(int addr, int count, int max_count) {
+    return addr >= 0 && count >= 1 && count <= max_count && addr + count <= 0x10000;
+  }
+
+  int read_bits(std::uint8_t fc, int unit, int addr, int count, std::uint8_t* out) {
+    int rc = stage_read(fc, addr, count, out);
+    if (rc != 0) return rc;
+    int n = transact(unit, 5);
+    if (n < 0) return n;
+    return decode_read(fc, count, n, out, nullptr);
+  }
+
+  int read_regs(std::uint8_t fc, int unit, int addr, int count, std::uint16_t* out) {
+    int rc = stage_read(fc, addr, count, out);
+    if (rc != 0) return rc;
+    int n = transact(unit, 5);
+    if (n < 0) return n;
+    return decode_read(fc, count, n, nullptr, out);
+  }
+
+  // Stage an FC1-FC4 request PDU in tx_.
+  int stage_read(std::uint8_t fc, int addr, int count, const void* out) {
+    const int limit = (fc == 0x01 || fc == 0x02) ? 2000 : 125;
+    if (!out || !valid_range(addr, count, limit)) return err(ModbusErr::INVALID_ARG);
+    std::uint8_t* pdu = tx_ + kMbapLen;
+    pdu[0] = fc;
+    put_u16(pdu + 1, addr);
+    put_u16(pdu + 3, count);
+    return 0;
+  }
+
+  // Unpack a read response PDU of length `n` from rx_.
+  int decode_read(std::uint8_t fc, int count, int n, std::uint8_t* bits, std::uint16_t* regs) {
+    const std::uint8_t* rsp = rx_ + kMbapLen;
+    if (fc == 0x01 || fc == 0x02) {
+      const int nbytes = (count + 7) / 8;
+      if (n != 2 + nbytes || rsp[1] != nbytes) return err(ModbusErr::IO_ERROR);
+      for (int i = 0; i < count; ++i) bits[i] = (rsp[2 + i / 8] >> (i % 8)) & 1u;
+      return 0;
+    }
+    if (n != 2 + 2 * count || rsp[1] != 2 * count) return err(ModbusErr::IO_ERROR);
+    for (int i = 0; i < count; ++i) regs[i] = static_cast<std::uint16_t>(get_u16(rsp + 2 + 2 * i));
+    return 0;
+  }
+
+  // Write responses echo the first `echo_len` bytes of the request PDU.
+  int transact_echo(int unit, int pdu_len, int echo_len) {
+    int n = transact(unit, pdu_len);
+    if (n < 0) return n;
+    if (n != echo_len || std::memcmp(rx_ + kMbapLen, tx_ + kMbapLen, static_cast<std::size_t>(echo_len)) != 0) {
+      return err(ModbusErr::IO_ERROR);
+    }
+    return 0;
+  }
+
+  // Send the PDU staged in tx_ and receive the matching response PDU into rx_.
+  // Returns the response PDU length or a negative error code.
+  int transact(int unit, int pdu_len) {
+    if (fd_ == kNoSocket) return err(ModbusErr::NOT_CONNECTED);
+    if (unit < 0 || unit > 255) return err(ModbusErr::INVALID_ARG);
+    const clock::time_point deadline = clock::now() + std::chrono::milliseconds(timeout_ms_);
+    const int tid = begin_frame(unit, pdu_len);
+    int rc = send_all(tx_, kMbapLen + pdu_len, deadline);
+    if (rc != 0) { close(); return rc; }
+
+    for (;;) {
+      int got = 0;
+      int n = recv_frame(deadline, got);
+      // A timeout before the first byte leaves the stream aligned: a late
+      // reply is recognized by its transaction id and skipped next time.
+      if (n < 0) { if (got != 0 || n != err(ModbusErr::IO_TIMEOUT)) close(); return n; }
+      if (get_u16(rx_) != tid) continue;  // stale reply to an earlier, timed-out request
+      return check_reply(unit, tx_[kMbapLen], n);
+    }
+  }
+
+  // Fill in the MBAP header for the PDU staged in tx_; returns its transaction id.
+  int begin_frame(int unit, int pdu_len) {
+    const int tid = (++tid_) & 0xFFFF;
+    put_u16(tx_, tid);
+    put_u16(tx_ + 2, 0);
+    put_u16(tx_ + 4, pdu_len + 1);
+    tx_[6] = static_cast<std::uint8_t>(unit);
+    return tid;
+  }
+
+  // Receive one complete ADU into rx_; returns its PDU length. `got` is
+  // non-zero once any byte of the frame arrived, i.e. the stream is misaligned
+  // if an error follows.
+  int recv_frame(clock::time_point deadline, int& got) {
+    int part = 0;
+    int rc = recv_exact(rx_, kMbapLen, deadline, part);
+    got = part;
+    if (rc != 0) return rc;
+    const int len = get_u16(rx_ + 4);
+    if (get_u16(rx_ + 2) != 0 || len < 2 || len > kMaxAdu - kMbapLen + 1) return err(ModbusErr::IO_ERROR);
+    rc = recv_exact(rx_ + kMbapLen, len - 1, deadline, part);
+    got += part;
+    if (rc != 0) return rc;
+    return len - 1;
+  }
+
+  // Validate the response in rx_ against the request's unit and function.
+  int check_reply(int unit, std::uint8_t fc, int n) {
+    const std::uint8_t rfc = rx_[kMbapLen];
+    if (rx_[6] != static_cast<std::uint8_t>(unit)) return err(ModbusErr::IO_ERROR);
+    if (rfc == (fc | 0x80)) return make_modbus_exception(n >= 2 ? rx_[kMbapLen + 1] : 0);
+    if (rfc != fc) return err(ModbusErr::IO_ERROR);
+    return n;
+  }
+
+  // Wait until the socket is ready for `events`; 0, IO_TIMEOUT or IO_ERROR.
+  int wait_io(short events, clock::time_point deadline) {
+    for (;;) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+      if (left < 0) return err(ModbusErr::IO_TIMEOUT);
+      pollfd_t p;
+      p.fd = fd_;
+      p.events = events;
+      p.revents = 0;
+      // Round up so the final sub-millisecond slice is still waited for.
+      int r = poll_one(&p, static_cast<int>(left) + 1);
+      if (r < 0) {
+        if (interrupted(last_error())) continue;
+        return err(ModbusErr::IO_ERROR);
+      }
+      if (r == 0) continue;
+      if (p.revents & POLLNVAL) return err(ModbusErr::IO_ERROR);
+      // POLLERR/POLLHUP: the next send/recv (or SO_ERROR) reports the cause.
+      return 0;
+    }
+  }
+
+  int send_all(const std::uint8_t* p, int n, clock::time_point deadline) {
+    int sent = 0;
+    while (sent < n) {
+      auto r = ::send(fd_, reinterpret_cast<const char*>(p + sent), n - sent, kSendFlags);
+      if (r > 0) { sent += static_cast<int>(r); continue; }
+      int e = last_error();
+      if (r < 0 && interrupted(e)) continue;
+      if (r < 0 && would_block(e)) {
+        int rc = wait_io(POLLOUT, deadline);
+        if (rc != 0) return rc;
+        continue;
+      }
+      return err(connection_lost(e) ? ModbusErr::NOT_CONNECTED : ModbusErr::IO_ERROR);
+    }
+    return 0;
+  }
+
+  // Read exactly `n` bytes; `got` reports how many arrived before an error.
+  int recv_exact(std::uint8_t* p, int n, clock::time_point deadline, int& got) {
+    got = 0;
+    while (got < n) {
+      auto r = ::recv(fd_, reinterpret_cast<char*>(p + got), n - got, 0);
+      if (r > 0) { got += static_cast<int>(r); continue; }
+      if (r == 0) return err(ModbusErr::NOT_CONNECTED);  // peer closed
+      int e = last_error();
+      if (interrupted(e)) continue;
+      if (!would_block(e)) return err(connection_lost(e) ? ModbusErr::NOT_CONNECTED : ModbusErr::IO_ERROR);
+      int rc = wait_io(POLLIN, deadline);
+      if (rc != 0) return rc;
+    }
+    return 0;
+  }
+
+  template <typename InFlight>
+  static void fail_batch(ReadRequest* reqs, int n, const InFlight* inflight, int active, int next, int rc) {
+    for (int i = 0; i < active; ++i) reqs[inflight[i].index].rc = rc;
+    for (int i = next; i < n; ++i) reqs[i].rc = rc;
+  }
+
+  std::string host_;
+  int port_;
+  int timeout_ms_{1000};
+  int window_{1};
+  socket_t fd_{kNoSocket};
+  std::uint16_t tid_{0};
+  // Frame buffers live with the connection and are reused by every request.
+  std::uint8_t tx_[kMaxAdu];
+  std::uint8_t rx_[kMaxAdu];
+};
+
+} // namespace
+
+std::unique_ptr<IModbusClient> make_tcp_client(const std::string& host, int port) {
+  return std::unique_ptr<IModbusClient>(new NativeTcpClient(host, port));
+}
+
+} // namespace wiq
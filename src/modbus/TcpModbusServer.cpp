@@ -0,0 +1,631 @@
+#include "TcpModbusServer.hpp"
+#include "ModbusError.hpp"
+#include "ItemCodec.hpp"
+#include "Prefetcher.hpp"
+#include "ProcessImage.hpp"
+#include "ReadCoalescer.hpp"
+#include "ValueCache.hpp"
+#include "poll/PollEngine.hpp"
+#include "log.hpp"
+#include <chrono>
+#include <cstring>
+
+#if defined(__linux__)
+# include <arpa/inet.h>
+# include <cerrno>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+namespace wiq {
+
+TcpModbusServer::TcpModbusServer(IoContext& ctx)
+: ctx_(ctx), cfg_(ctx.server_cfg), read_cv_(ctx.devices.size()), reads_(ctx.devices.size()) {}
+
+#if !defined(__linux__)
+
+std::unique_ptr<TcpModbusServer> TcpModbusServer::start(IoContext&) {
+  log::log_error(__FILE__, __LINE__, "server: the Modbus TCP server needs Linux (epoll)");
+  return nullptr;
+}
+
+TcpModbusServer::~TcpModbusServer() {}
+
+#else
+
+namespace {
+
+constexpr std::uint64_t kListenTag = 0;
+constexpr std::uint64_t kWakeTag = 1;
+constexpr std::size_t kMaxPending = 1 << 20;  // unsent replies before a master is dropped
+
+inline int u16(const std::uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+inline void put16(std::vector<std::uint8_t>& v, int x) {
+  v.push_back(static_cast<std::uint8_t>((x >> 8) & 0xFF));
+  v.push_back(static_cast<std::uint8_t>(x & 0xFF));
+}
+
+std::vector<std::uint8_t> exception_pdu(int fc, std::uint8_t code) {
+  return {static_cast<std::uint8_t>(fc | 0x80), code};
+}
+
+// Exception a gateway answers with for a failed write on the device.
+std::uint8_t gateway_exception(int rc) {
+  if (is_modbus_exception(rc)) return decode_modbus_exception(rc);
+  if (rc == static_cast<int>(ModbusErr::IO_TIMEOUT)) return 0x0B;     // target failed to respond
+  if (rc == static_cast<int>(ModbusErr::NOT_CONNECTED)) return 0x0A;  // path unavailable
+  return 0x04;                                                         // server device failure
+}
+
+// Request PDU shape check for FC1-4.
+bool valid_read(const std::uint8_t* pdu, int n) {
+  if (n != 5) return false;
+  const int qty = u16(pdu + 3);
+  return qty >= 1 && qty <= (pdu[0] <= 2 ? 2000 : 125);
+}
+
+// Response PDU of an FC1-4 request for `qty` bits or registers.
+std::vector<std::uint8_t> read_response(int fc, int qty, const RawValue& raw) {
+  std::vector<std::uint8_t> rsp(1, static_cast<std::uint8_t>(fc));
+  if (fc == 1 || fc == 2) {
+    rsp.push_back(static_cast<std::uint8_t>((qty + 7) / 8));
+    rsp.resize(2 + static_cast<std::size_t>((qty + 7) / 8), 0);
+    for (int i = 0; i < qty; ++i) {
+      if (raw.bits[static_cast<std::size_t>(i)]) rsp[2 + static_cast<std::size_t>(i / 8)] |= static_cast<std::uint8_t>(1u << (i % 8));
+    }
+  } else {
+    rsp.push_back(static_cast<std::uint8_t>(qty * 2));
+    for (int i = 0; i < qty; ++i) put16(rsp, raw.words[static_cast<std::size_t>(i)]);
+  }
+  return rsp;
+}
+
+// Request PDU shape check for FC5/6/15/16.
+bool valid_write(const std::uint8_t* pdu, int n) {
+  switch (pdu[0]) {
+    case 5: return n == 5 && (u16(pdu + 3) == 0xFF00 || u16(pdu + 3) == 0x0000);
+    case 6: return n == 5;
+    case 15: {
+      if (n < 6) return false;
+      const int qty = u16(pdu + 3);
+      return qty >= 1 && qty <= 1968 && pdu[5] == (qty + 7) / 8 && n == 6 + pdu[5];
+    }
+    case 16: {
+      if (n < 6) return false;
+      const int qty = u16(pdu + 3);
+      return qty >= 1 && qty <= 123 && pdu[5] == qty * 2 && n == 6 + pdu[5];
+    }
+    default: return false;
+  }
+}
+
+} // namespace
+
+// MBAP frame answering `header` (transaction id and unit id) with `rsp`.
+static std::vector<std::uint8_t> make_frame(IoContext& ctx, const std::uint8_t* header, const std::vector<std::uint8_t>& rsp) {
+  if (!rsp.empty() && (rsp[0] & 0x80)) ctx.diagnostics.server_exceptions += 1;
+  std::vector<std::uint8_t> f(header, header + 4);
+  put16(f, static_cast<int>(rsp.size()) + 1);
+  f.push_back(header[6]);
+  f.insert(f.end(), rsp.begin(), rsp.end());
+  return f;
+}
+
+std::unique_ptr<TcpModbusServer> TcpModbusServer::start(IoContext& ctx) {
+  std::unique_ptr<TcpModbusServer> s(new TcpModbusServer(ctx));
+  const ServerCfg& cfg = s->cfg_;
+  for (const auto& kv : ctx.items) {
+    const ItemCfg& ic = kv.second;
+    if (!is_readable(ic) && ic.function != 5 && ic.function != 6 && ic.function != 15 && ic.function != 16) continue;
+    auto it = s->units_.find(ic.unit_id);
+    if (it == s->units_.end()) {
+      s->units_[ic.unit_id] = ic.device;
+    } else if (it->second != ic.device && cfg.device < 0) {
+      // Routing by unit id would pick one of them and hide the other.
+      log::log_error(__FILE__, __LINE__, "server: unit id %d has items on devices '%s' and '%s'; set server.device",
+                     ic.unit_id, ctx.devices[it->second]->name.c_str(), ctx.devices[ic.device]->name.c_str());
+      return nullptr;
+    }
+  }
+
+  s->listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (s->listen_fd_ < 0) {
+    log::log_error(__FILE__, __LINE__, "server: socket: %s", std::strerror(errno));
+    return nullptr;
+  }
+  int one = 1;
+  ::setsockopt(s->listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a{};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(static_cast<std::uint16_t>(cfg.port));
+  if (::inet_pton(AF_INET, cfg.bind.c_str(), &a.sin_addr) != 1) {
+    log::log_error(__FILE__, __LINE__, "server: bind address '%s' is not an IPv4 address", cfg.bind.c_str());
+    return nullptr;
+  }
+  if (::bind(s->listen_fd_, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0 || ::listen(s->listen_fd_, SOMAXCONN) != 0) {
+    log::log_error(__FILE__, __LINE__, "server: cannot listen on %s:%d: %s", cfg.bind.c_str(), cfg.port, std::strerror(errno));
+    return nullptr;
+  }
+  socklen_t len = sizeof(a);
+  ::getsockname(s->listen_fd_, reinterpret_cast<sockaddr*>(&a), &len);
+  s->port_ = ntohs(a.sin_port);
+
+  s->epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  s->wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (s->epoll_fd_ < 0 || s->wake_fd_ < 0) {
+    log::log_error(__FILE__, __LINE__, "server: epoll/eventfd: %s", std::strerror(errno));
+    return nullptr;
+  }
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.u64 = kListenTag;
+  ::epoll_ctl(s->epoll_fd_, EPOLL_CTL_ADD, s->listen_fd_, &ev);
+  ev.data.u64 = kWakeTag;
+  ::epoll_ctl(s->epoll_fd_, EPOLL_CTL_ADD, s->wake_fd_, &ev);
+
+  if (cfg.subscribe && cfg.mode == ServerMode::Image) {
+    s->set_items_subscribed(true);
+    s->subscribed_ = true;
+  }
+  TcpModbusServer* self = s.get();
+  s->thread_ = std::thread([self] { self->run(); });
+  s->writer_ = std::thread([self] { self->run_writes(); });
+  if (cfg.mode == ServerMode::Proxy) {
+    for (std::size_t d = 0; d < ctx.devices.size(); ++d) {
+      if (cfg.device >= 0 && static_cast<int>(d) != cfg.device) continue;
+      s->readers_.emplace_back([self, d] { self->run_reads(d); });
+    }
+  }
+  log::log_info(__FILE__, __LINE__, "server: listening on %s:%d", cfg.bind.c_str(), s->port_);
+  return s;
+}
+
+TcpModbusServer::~TcpModbusServer() {
+  std::size_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stop_ = true;
+    dropped = writes_.size();
+    writes_.clear();
+    for (auto& q : reads_) {
+      dropped += q.size();
+      q.clear();
+    }
+  }
+  cv_.notify_all();
+  for (auto& c : read_cv_) c.notify_all();
+  if (wake_fd_ >= 0) {
+    const std::uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+  }
+  if (thread_.joinable()) thread_.join();
+  if (writer_.joinable()) writer_.join();
+  for (auto& t : readers_) t.join();
+  if (dropped) log::log_warn(__FILE__, __LINE__, "server: %zu queued requests dropped at shutdown", dropped);
+  for (auto& kv : conns_) ::close(kv.second.fd);
+  if (listen_fd_ >= 0) ::close(listen_fd_);
+  if (epoll_fd_ >= 0) ::close(epoll_fd_);
+  if (wake_fd_ >= 0) ::close(wake_fd_);
+  if (subscribed_) set_items_subscribed(false);
+}
+
+void TcpModbusServer::set_items_subscribed(bool on) {
+  // Each device's engine takes its items in one step, as with SubscribeItems.
+  std::vector<std::vector<const ItemCfg*>> per_device(ctx_.devices.size());
+  for (const auto& kv : ctx_.items) {
+    const ItemCfg& ic = kv.second;
+    if (cfg_.device >= 0 && static_cast<int>(ic.device) != cfg_.device) continue;
+    Device& dev = ctx_.device_of(ic);
+    if (!dev.poller) continue;
+    if (on) per_device[ic.device].push_back(&ic);
+    else dev.poller->unsubscribe(ic);
+  }
+  for (std::size_t d = 0; d < per_device.size(); ++d) {
+    if (!per_device[d].empty()) ctx_.devices[d]->poller->subscribe(per_device[d]);
+  }
+}
+
+int TcpModbusServer::route(int unit) const {
+  if (cfg_.device >= 0) return cfg_.device;
+  auto it = units_.find(unit);
+  if (it != units_.end()) return static_cast<int>(it->second);
+  // A proxy in front of a single device passes every unit id through.
+  if (cfg_.mode == ServerMode::Proxy && ctx_.devices.size() == 1) return 0;
+  return -1;
+}
+
+void TcpModbusServer::run() {
+  epoll_event evs[64];
+  for (;;) {
+    const int n = ::epoll_wait(epoll_fd_, evs, 64, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      log::log_error(__FILE__, __LINE__, "server: epoll_wait: %s", std::strerror(errno));
+      return;
+    }
+    for (int i = 0; i < n; ++i) {
+      const std::uint64_t id = evs[i].data.u64;
+      if (id == kListenTag) {
+        accept_clients();
+      } else if (id == kWakeTag) {
+        std::uint64_t v;
+        (void)!::read(wake_fd_, &v, sizeof(v));
+        {
+          std::lock_guard<std::mutex> lk(mu_);
+          if (stop_) return;
+        }
+        drain_replies();
+      } else {
+        if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) on_readable(id);
+        if ((evs[i].events & EPOLLOUT) && conns_.count(id)) flush(id);
+      }
+    }
+  }
+}
+
+void TcpModbusServer::accept_clients() {
+  for (;;) {
+    const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        log::log_warn(__FILE__, __LINE__, "server: accept: %s", std::strerror(errno));
+      }
+      return;
+    }
+    if (clients_.load() >= cfg_.max_clients) {
+      log::log_warn(__FILE__, __LINE__, "server: max_clients (%d) reached, refusing a connection", cfg_.max_clients);
+      ::close(fd);
+      continue;
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    const std::uint64_t id = next_id_++;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = id;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      ::close(fd);
+      continue;
+    }
+    conns_[id].fd = fd;
+    clients_ += 1;
+  }
+}
+
+void TcpModbusServer::close_conn(std::uint64_t id) {
+  auto it = conns_.find(id);
+  if (it == conns_.end()) return;
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+  ::close(it->second.fd);
+  conns_.erase(it);
+  clients_ -= 1;
+}
+
+void TcpModbusServer::on_readable(std::uint64_t id) {
+  auto it = conns_.find(id);
+  if (it == conns_.end()) return;
+  Conn& c = it->second;
+  std::uint8_t buf[4096];
+  for (;;) {
+    const ssize_t r = ::recv(c.fd, buf, sizeof(buf), 0);
+    if (r > 0) {
+      c.in.insert(c.in.end(), buf, buf + r);
+      continue;
+    }
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    close_conn(id);  // orderly close or a broken connection
+    return;
+  }
+
+  std::size_t pos = 0;
+  std::vector<std::uint8_t> rsp;
+  while (c.in.size() - pos >= 7) {
+    const std::uint8_t* h = c.in.data() + pos;
+    const int len = u16(h + 4);
+    if (u16(h + 2) != 0 || len < 2 || len > 254) {
+      close_conn(id);  // not Modbus TCP; the stream cannot be resynchronised
+      return;
+    }
+    if (c.in.size() - pos < static_cast<std::size_t>(6 + len)) break;
+    if (handle(id, h, h + 7, len - 1, rsp)) {
+      std::vector<std::uint8_t> f = make_frame(ctx_, h, rsp);
+      c.out.insert(c.out.end(), f.begin(), f.end());
+    }
+    pos += static_cast<std::size_t>(6 + len);
+  }
+  c.in.erase(c.in.begin(), c.in.begin() + static_cast<std::ptrdiff_t>(pos));
+  flush(id);
+}
+
+void TcpModbusServer::flush(std::uint64_t id) {
+  auto it = conns_.find(id);
+  if (it == conns_.end()) return;
+  Conn& c = it->second;
+  std::size_t sent = 0;
+  while (sent < c.out.size()) {
+    const ssize_t r = ::send(c.fd, c.out.data() + sent, c.out.size() - sent, MSG_NOSIGNAL);
+    if (r > 0) {
+      sent += static_cast<std::size_t>(r);
+      continue;
+    }
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    close_conn(id);
+    return;
+  }
+  c.out.erase(c.out.begin(), c.out.begin() + static_cast<std::ptrdiff_t>(sent));
+  if (c.out.size() > kMaxPending) {
+    log::log_warn(__FILE__, __LINE__, "server: dropping a master that does not read its replies");
+    close_conn(id);
+    return;
+  }
+  const bool want_write = !c.out.empty();
+  if (want_write != c.want_write) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0u);
+    ev.data.u64 = id;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+    c.want_write = want_write;
+  }
+}
+
+void TcpModbusServer::drain_replies() {
+  std::vector<Reply> ready;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    ready.swap(replies_);
+  }
+  for (auto& r : ready) {
+    auto it = conns_.find(r.conn);
+    if (it == conns_.end()) continue;  // the master went away meanwhile
+    it->second.out.insert(it->second.out.end(), r.frame.begin(), r.frame.end());
+    flush(r.conn);
+  }
+}
+
+bool TcpModbusServer::handle(std::uint64_t id, const std::uint8_t* header, const std::uint8_t* pdu, int n,
+                             std::vector<std::uint8_t>& rsp) {
+  ctx_.diagnostics.server_requests += 1;
+  const int fc = pdu[0];
+  const int unit = header[6];
+  if (fc >= 1 && fc <= 4) {
+    if (cfg_.mode == ServerMode::Proxy) return answer_proxy(id, header, pdu, n, rsp);
+    answer_read(unit, pdu, n, rsp);
+    return true;
+  }
+  if (fc != 5 && fc != 6 && fc != 15 && fc != 16) {
+    rsp = exception_pdu(fc, 0x01);
+    return true;
+  }
+  if (cfg_.writes == ServerWrites::Reject) {
+    rsp = exception_pdu(fc, 0x01);
+    return true;
+  }
+  if (!valid_write(pdu, n)) {
+    rsp = exception_pdu(fc, 0x03);
+    return true;
+  }
+  if (route(unit) < 0) {
+    rsp = exception_pdu(fc, 0x0A);
+    return true;
+  }
+  WriteJob job;
+  job.conn = id;
+  job.header.assign(header, header + 7);
+  job.pdu.assign(pdu, pdu + n);
+  job.reply = cfg_.writes == ServerWrites::Forward;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (static_cast<int>(writes_.size()) >= cfg_.write_queue) {
+      rsp = exception_pdu(fc, 0x06);  // server device busy
+      return true;
+    }
+    writes_.push_back(std::move(job));
+  }
+  cv_.notify_one();
+  if (cfg_.writes == ServerWrites::Forward) return false;
+  rsp.assign(pdu, pdu + 5);  // queued: acknowledge now, as the device would
+  return true;
+}
+
+void TcpModbusServer::answer_read(int unit, const std::uint8_t* pdu, int n, std::vector<std::uint8_t>& rsp) {
+  const int fc = pdu[0];
+  if (!valid_read(pdu, n)) {
+    rsp = exception_pdu(fc, 0x03);
+    return;
+  }
+  const int addr = u16(pdu + 1);
+  const int qty = u16(pdu + 3);
+  const int d = route(unit);
+  Device* dev = d < 0 ? nullptr : ctx_.devices[static_cast<std::size_t>(d)].get();
+  if (!dev || !dev->image) {
+    rsp = exception_pdu(fc, 0x0A);
+    return;
+  }
+  if (!dev->image->covers(unit, fc, addr, qty)) {
+    rsp = exception_pdu(fc, 0x02);
+    return;
+  }
+  RawValue raw;
+  ProcessImage::Stamp stamp;
+  if (!dev->image->read(unit, fc, addr, qty, raw, stamp) ||
+      (cfg_.max_age_ms > 0 && ProcessImage::clock::now() - stamp.at > std::chrono::milliseconds(cfg_.max_age_ms))) {
+    rsp = exception_pdu(fc, 0x0B);  // no fresh data from the device
+    return;
+  }
+  rsp = read_response(fc, qty, raw);
+}
+
+bool TcpModbusServer::answer_proxy(std::uint64_t id, const std::uint8_t* header, const std::uint8_t* pdu, int n,
+                                   std::vector<std::uint8_t>& rsp) {
+  const int fc = pdu[0];
+  if (!valid_read(pdu, n)) {
+    rsp = exception_pdu(fc, 0x03);
+    return true;
+  }
+  const int d = route(header[6]);
+  if (d < 0) {
+    rsp = exception_pdu(fc, 0x0A);
+    return true;
+  }
+  const std::uint64_t key = (static_cast<std::uint64_t>(d) << 48) | (static_cast<std::uint64_t>(header[6]) << 40) |
+                            (static_cast<std::uint64_t>(fc) << 32) | (static_cast<std::uint64_t>(u16(pdu + 1)) << 16) |
+                            static_cast<std::uint64_t>(u16(pdu + 3));
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (cfg_.cache_ms > 0) {
+      auto it = cache_.find(key);
+      if (it != cache_.end() && std::chrono::steady_clock::now() - it->second.at <= std::chrono::milliseconds(cfg_.cache_ms)) {
+        ctx_.diagnostics.server_cache_hits += 1;
+        rsp = it->second.pdu;
+        return true;
+      }
+    }
+    Flights::Ticket flight = flights_.join(key, Waiter{id, std::vector<std::uint8_t>(header, header + 7)});
+    if (!flight) {
+      ctx_.diagnostics.server_coalesced += 1;  // answered when the read in flight completes
+      return false;
+    }
+    std::deque<ReadJob>& queue = reads_[static_cast<std::size_t>(d)];
+    if (static_cast<int>(queue.size()) >= cfg_.read_queue) {
+      flights_.complete(key, flight);
+      rsp = exception_pdu(fc, 0x06);  // server device busy
+      return true;
+    }
+    ReadJob job;
+    job.key = key;
+    job.flight = std::move(flight);
+    job.unit = header[6];
+    job.pdu.assign(pdu, pdu + n);
+    queue.push_back(std::move(job));
+  }
+  read_cv_[static_cast<std::size_t>(d)].notify_one();
+  return false;
+}
+
+void TcpModbusServer::run_reads(std::size_t device) {
+  std::deque<ReadJob>& queue = reads_[device];
+  for (;;) {
+    ReadJob job;
+    {
+      std::unique_lock<std::mutex> lk(mu_);
+      read_cv_[device].wait(lk, [&] { return stop_ || !queue.empty(); });
+      if (stop_) return;
+      job = std::move(queue.front());
+      queue.pop_front();
+    }
+    std::vector<std::uint8_t> rsp = perform_read(*ctx_.devices[device], job.unit, job.pdu);
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      // A response read across a write may predate it; it is sent but not kept.
+      if (cfg_.cache_ms > 0 && !(rsp[0] & 0x80) && job.flight->current()) {
+        const auto now = std::chrono::steady_clock::now();
+        if (cache_.size() >= 4096) {
+          for (auto it = cache_.begin(); it != cache_.end();) {
+            if (now - it->second.at > std::chrono::milliseconds(cfg_.cache_ms)) it = cache_.erase(it);
+            else ++it;
+          }
+        }
+        cache_[job.key] = Cached{rsp, now};
+      }
+      for (const Waiter& w : flights_.complete(job.key, job.flight)) {
+        replies_.push_back({w.conn, make_frame(ctx_, w.header.data(), rsp)});
+      }
+    }
+    const std::uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+  }
+}
+
+std::vector<std::uint8_t> TcpModbusServer::perform_read(Device& dev, int unit, const std::vector<std::uint8_t>& pdu) {
+  const int fc = pdu[0];
+  const int addr = u16(&pdu[1]);
+  const int qty = u16(&pdu[3]);
+  RawValue raw;
+  const int rc = read_range(&ctx_, dev, BusLane::OnDemand, fc, unit, addr, qty, raw);
+  ctx_.diagnostics.server_downstream += 1;
+  if (rc != 0) {
+    record_error(&ctx_, &dev, fc, unit, rc);
+    return exception_pdu(fc, gateway_exception(rc));
+  }
+  record_success(&ctx_, &dev);
+  return read_response(fc, qty, raw);
+}
+
+void TcpModbusServer::run_writes() {
+  for (;;) {
+    WriteJob job;
+    {
+      std::unique_lock<std::mutex> lk(mu_);
+      cv_.wait(lk, [&] { return stop_ || !writes_.empty(); });
+      if (stop_) return;
+      job = std::move(writes_.front());
+      writes_.pop_front();
+    }
+    std::vector<std::uint8_t> rsp = perform_write(job.header[6], job.pdu);
+    if (!job.reply) continue;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      replies_.push_back({job.conn, make_frame(ctx_, job.header.data(), rsp)});
+    }
+    const std::uint64_t one = 1;
+    (void)!::write(wake_fd_, &one, sizeof(one));
+  }
+}
+
+std::vector<std::uint8_t> TcpModbusServer::perform_write(int unit, const std::vector<std::uint8_t>& pdu) {
+  Device& dev = *ctx_.devices[static_cast<std::size_t>(route(unit))];
+  const int fc = pdu[0];
+  const int addr = u16(&pdu[1]);
+  // Stands in for an item so the poll cache can drop what the write covers.
+  ItemCfg span;
+  span.unit_id = unit;
+  span.function = fc;
+  span.address = addr;
+  span.count = 1;
+  int rc = 0;
+  if (fc == 5) {
+    const bool on = u16(&pdu[3]) == 0xFF00;
+    rc = call_with_reconnect(&ctx_, dev, BusLane::Write, [&] { return dev.client->write_single_coil(unit, addr, on); });
+  } else if (fc == 6) {
+    const std::uint16_t v = static_cast<std::uint16_t>(u16(&pdu[3]));
+    rc = call_with_reconnect(&ctx_, dev, BusLane::Write, [&] { return dev.client->write_single_reg(unit, addr, v); });
+  } else if (fc == 15) {
+    span.count = u16(&pdu[3]);
+    std::vector<std::uint8_t> v(static_cast<std::size_t>(span.count));
+    for (int i = 0; i < span.count; ++i) v[static_cast<std::size_t>(i)] = (pdu[6 + static_cast<std::size_t>(i / 8)] >> (i % 8)) & 1;
+    rc = call_with_reconnect(&ctx_, dev, BusLane::Write, [&] { return dev.client->write_multiple_coils(unit, addr, span.count, v.data()); });
+  } else {
+    span.count = u16(&pdu[3]);
+    std::vector<std::uint16_t> v(static_cast<std::size_t>(span.count));
+    for (int i = 0; i < span.count; ++i) v[static_cast<std::size_t>(i)] = static_cast<std::uint16_t>(u16(&pdu[6 + 2 * static_cast<std::size_t>(i)]));
+    rc = call_with_reconnect(&ctx_, dev, BusLane::Write, [&] { return dev.client->write_multiple_regs(unit, addr, span.count, v.data()); });
+  }
+  if (rc != 0) {
+    record_error(&ctx_, &dev, fc, unit, rc);
+    return exception_pdu(fc, gateway_exception(rc));
+  }
+  record_success(&ctx_, &dev);
+  ctx_.diagnostics.server_writes += 1;
+  if (dev.poller) dev.poller->invalidate_written(span);
+  if (dev.prefetcher) dev.prefetcher->invalidate();
+  dev.cache->invalidate();
+  dev.coalescer->invalidate();
+  {
+    // Proxied reads on the bus now may predate the write.
+    std::lock_guard<std::mutex> lk(mu_);
+    cache_.clear();
+    flights_.forget();
+  }
+  return std::vector<std::uint8_t>(pdu.begin(), pdu.begin() + 5);
+}
+
+#endif
+
+} // namespace wiq
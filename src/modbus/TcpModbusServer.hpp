@@ -0,0 +1,146 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "util/Singleflight.hpp"
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace wiq {
+
+// Embedded Modbus TCP server (`server`). Masters read FC1-4 from the
+// devices' ProcessImage, so any number of them share the poll traffic of
+// one bus instead of adding their own. A request's unit id selects the
+// device whose items use it, unless `server.device` pins one device.
+//
+// In proxy mode (`server.mode: proxy`) reads are passed through to the
+// device instead. Identical reads (device, unit, function, address, count)
+// that arrive while one is on the bus join it and are answered from its
+// response, and `server.cache_ms` reuses a response for that long, so the
+// bus sees only the distinct requests of all masters.
+//
+// One thread runs an epoll loop over the listening socket and every
+// connection and never blocks on a device. Writes (FC5/6/15/16) go to a
+// writer thread that performs them in the Write lane of the device's bus,
+// and proxied reads to one reader thread per served device (OnDemand lane),
+// so a slow line delays only the masters waiting for it. Linux only.
+class TcpModbusServer {
+public:
+  // Bind, subscribe the polled items (`server.subscribe`) and start the
+  // threads. Null, with the reason logged, if the server cannot start.
+  static std::unique_ptr<TcpModbusServer> start(IoContext& ctx);
+
+  // Closes every connection; queued writes not yet started are dropped.
+  ~TcpModbusServer();
+
+  TcpModbusServer(const TcpModbusServer&) = delete;
+  TcpModbusServer& operator=(const TcpModbusServer&) = delete;
+
+  int port() const { return port_; }
+  int clients() const { return clients_.load(); }
+
+private:
+  struct Conn {
+    int fd{-1};
+    std::vector<std::uint8_t> in;
+    std::vector<std::uint8_t> out;
+    bool want_write{false};
+  };
+
+  // A write taken from a master, with its MBAP header. `reply` is false when
+  // the answer already went out (`writes: queue`).
+  struct WriteJob {
+    std::uint64_t conn{0};
+    std::vector<std::uint8_t> header;
+    std::vector<std::uint8_t> pdu;
+    bool reply{false};
+  };
+
+  // A master waiting for a proxied read.
+  struct Waiter {
+    std::uint64_t conn;
+    std::vector<std::uint8_t> header;
+  };
+  using Flights = Singleflight<std::uint64_t, Waiter>;
+
+  struct ReadJob {
+    std::uint64_t key{0};
+    Flights::Ticket flight;
+    int unit{0};
+    std::vector<std::uint8_t> pdu;
+  };
+
+  struct Cached {
+    std::vector<std::uint8_t> pdu;
+    std::chrono::steady_clock::time_point at;
+  };
+
+  struct Reply {
+    std::uint64_t conn;
+    std::vector<std::uint8_t> frame;
+  };
+
+  explicit TcpModbusServer(IoContext& ctx);
+
+  void run();
+  void run_writes();
+  void run_reads(std::size_t device);
+
+  void accept_clients();
+  void on_readable(std::uint64_t id);
+  void flush(std::uint64_t id);
+  void close_conn(std::uint64_t id);
+  void drain_replies();
+
+  // Answer the request PDU or queue it; false when the reply is deferred.
+  bool handle(std::uint64_t id, const std::uint8_t* header, const std::uint8_t* pdu, int n,
+              std::vector<std::uint8_t>& rsp);
+  void answer_read(int unit, const std::uint8_t* pdu, int n, std::vector<std::uint8_t>& rsp);
+  bool answer_proxy(std::uint64_t id, const std::uint8_t* header, const std::uint8_t* pdu, int n,
+                    std::vector<std::uint8_t>& rsp);
+  std::vector<std::uint8_t> perform_read(Device& dev, int unit, const std::vector<std::uint8_t>& pdu);
+  std::vector<std::uint8_t> perform_write(int unit, const std::vector<std::uint8_t>& pdu);
+  // Index of the device serving `unit`, or -1.
+  int route(int unit) const;
+
+  void set_items_subscribed(bool on);
+
+  IoContext& ctx_;
+  const ServerCfg cfg_;
+  int port_{0};
+  int listen_fd_{-1};
+  int epoll_fd_{-1};
+  int wake_fd_{-1};  // eventfd: stop, or write replies to send
+  std::map<int, std::size_t> units_;  // unit id -> the device with items on it
+  bool subscribed_{false};
+
+  // epoll thread only
+  std::unordered_map<std::uint64_t, Conn> conns_;
+  std::uint64_t next_id_{2};  // 0 and 1 tag the listening socket and wake_fd_
+  std::atomic<int> clients_{0};
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<WriteJob> writes_;
+  std::vector<Reply> replies_;
+  // Proxied reads, one queue per device: a stalled line backs up only its own.
+  std::vector<std::condition_variable> read_cv_;
+  std::vector<std::deque<ReadJob>> reads_;
+  Flights flights_;
+  std::unordered_map<std::uint64_t, Cached> cache_;  // proxy responses by request key
+  bool stop_{false};
+
+  std::thread thread_;
+  std::thread writer_;
+  std::vector<std::thread> readers_;
+};
+
+} // namespace wiq
@@ -0,0 +1,110 @@
+#include "poll/BlockPlanner.hpp"
+#include "ModbusError.hpp"
+#include "ReadCoalescer.hpp"
+#include <algorithm>
+
+namespace wiq {
+
+static bool is_bit_function(int fc) { return fc == 1 || fc == 2; }
+
+std::vector<ReadBlock> plan_blocks(std::vector<const ItemCfg*> items, const BlockPlanCfg& cfg) {
+  std::vector<ReadBlock> blocks;
+  items.erase(std::remove_if(items.begin(), items.end(),
+                             [](const ItemCfg* ic) { return !ic || !is_readable(*ic); }),
+              items.end());
+  std::sort(items.begin(), items.end(), [](const ItemCfg* a, const ItemCfg* b) {
+    if (a->unit_id != b->unit_id) return a->unit_id < b->unit_id;
+    if (a->function != b->function) return a->function < b->function;
+    if (a->address != b->address) return a->address < b->address;
+    return a->name < b->name;
+  });
+
+  ReadBlock* cur = nullptr;
+  for (const ItemCfg* ic : items) {
+    ItemSpan s = read_span(*ic);
+    const bool bits = is_bit_function(s.function);
+    const int limit = bits ? std::min(cfg.max_block_bits, kMaxReadBits)
+                           : std::min(cfg.max_block_regs, kMaxReadRegisters);
+    const int gap = bits ? cfg.max_gap_bits : cfg.max_gap;
+    if (cur && cur->unit_id == ic->unit_id && cur->function == s.function) {
+      int cur_end = cur->address + cur->count;  // one past the last covered address
+      int new_end = std::max(cur_end, s.address + s.count);
+      if (s.address - cur_end <= gap && new_end - cur->address <= limit) {
+        cur->count = new_end - cur->address;
+        cur->members.push_back({ic, s.address - cur->address, s.count});
+        continue;
+      }
+    }
+    ReadBlock b;
+    b.unit_id = ic->unit_id;
+    b.function = s.function;
+    b.address = s.address;
+    b.count = s.count;
+    b.members.push_back({ic, 0, s.count});
+    blocks.push_back(b);
+    cur = &blocks.back();
+  }
+  return blocks;
+}
+
+int read_block(IoContext* ctx, Device& dev, const ReadBlock& block, BlockData& out, BusLane lane) {
+  RawValue raw;
+  const int rc = read_range(ctx, dev, lane, block.function, block.unit_id, block.address, block.count, raw);
+  out.bits = std::move(raw.bits);
+  out.words = std::move(raw.words);
+  return rc;
+}
+
+void read_blocks(IoContext* ctx, Device& dev, const std::vector<const ReadBlock*>& blocks,
+                 std::vector<BlockData>& out, std::vector<int>& rcs, BusLane lane) {
+  const std::size_t n = blocks.size();
+  out.assign(n, BlockData{});
+  rcs.assign(n, static_cast<int>(ModbusErr::NOT_CONNECTED));
+  if (!dev.client || n == 0) return;
+  // Nothing to pipeline: go through read_range like any other single read,
+  // so an identical read already in flight is shared.
+  if (n == 1) {
+    rcs[0] = read_block(ctx, dev, *blocks[0], out[0], lane);
+    return;
+  }
+  std::vector<ReadRequest> reqs(n);
+  std::vector<std::size_t> pending;
+  for (std::size_t i = 0; i < n; ++i) {
+    const ReadBlock& b = *blocks[i];
+    ReadRequest& r = reqs[i];
+    r.function = b.function;
+    r.unit = b.unit_id;
+    r.addr = b.address;
+    r.count = b.count;
+    if (is_bit_function(b.function)) { out[i].bits.assign(b.count, 0); r.bits = out[i].bits.data(); }
+    else { out[i].words.assign(b.count, 0); r.regs = out[i].words.data(); }
+    pending.push_back(i);
+  }
+  // Reconnect retries resubmit only the requests the lost connection failed.
+  call_with_reconnect(ctx, dev, lane, [&]{
+    std::vector<ReadRequest> batch;
+    batch.reserve(pending.size());
+    for (std::size_t i : pending) batch.push_back(reqs[i]);
+    dev.client->read_batch(batch.data(), static_cast<int>(batch.size()));
+    std::vector<std::size_t> lost;
+    for (std::size_t j = 0; j < batch.size(); ++j) {
+      reqs[pending[j]].rc = batch[j].rc;
+      if (batch[j].rc == static_cast<int>(ModbusErr::NOT_CONNECTED)) lost.push_back(pending[j]);
+    }
+    pending.swap(lost);
+    return pending.empty() ? 0 : static_cast<int>(ModbusErr::NOT_CONNECTED);
+  });
+  for (std::size_t i = 0; i < n; ++i) rcs[i] = reqs[i].rc;
+}
+
+void slice_member(const ReadBlock& block, const BlockData& data, const ReadBlock::Member& m, RawValue& out) {
+  if (is_bit_function(block.function)) {
+    out.bits.assign(data.bits.begin() + m.offset, data.bits.begin() + m.offset + m.count);
+    out.words.clear();
+  } else {
+    out.words.assign(data.words.begin() + m.offset, data.words.begin() + m.offset + m.count);
+    out.bits.clear();
+  }
+}
+
+} // namespace wiq
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace wiq {
+
+// Protocol PDU limits for a single read request.
+constexpr int kMaxReadRegisters = 125;  // FC3/FC4
+constexpr int kMaxReadBits = 2000;      // FC1/FC2
+
+// One read transaction covering several items of the same unit and function.
+struct ReadBlock {
+  struct Member {
+    const ItemCfg* item;
+    int offset;  // first register/bit of the item relative to the block start
+    int count;
+  };
+  int unit_id{};
+  int function{};
+  int address{};
+  int count{};
+  std::vector<Member> members;
+};
+
+// Raw response of a ReadBlock; `bits` for FC1/FC2, `words` for FC3/FC4.
+struct BlockData {
+  std::vector<std::uint8_t> bits;
+  std::vector<std::uint16_t> words;
+};
+
+// Group readable items by (unit_id, function) and merge their address ranges
+// into blocks. Two neighbours are merged when the hole between them is at most
+// the configured gap and the merged block stays within the PDU limit.
+std::vector<ReadBlock> plan_blocks(std::vector<const ItemCfg*> items, const BlockPlanCfg& cfg);
+
+// Issue the single transaction for `block` on `dev`.
+int read_block(IoContext* ctx, Device& dev, const ReadBlock& block, BlockData& out,
+               BusLane lane = BusLane::Poll);
+
+// Issue the transactions for several blocks through the client's read_batch,
+// which pipelines them where the transport supports it. A single block is
+// read through read_block() and so shares an identical read in flight.
+// `rcs[i]` is the result for `blocks[i]`.
+void read_blocks(IoContext* ctx, Device& dev, const std::vector<const ReadBlock*>& blocks,
+                 std::vector<BlockData>& out, std::vector<int>& rcs, BusLane lane = BusLane::Poll);
+
+// Extract the raw value of member `m` from a block response.
+void slice_member(const ReadBlock& block, const BlockData& data, const ReadBlock::Member& m, RawValue& out);
+
+} // namespace wiq
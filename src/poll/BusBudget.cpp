@@ -0,0 +1,46 @@
+#include "poll/BusBudget.hpp"
+#include "poll/BlockPlanner.hpp"
+#include <algorithm>
+#include <map>
+
+namespace wiq {
+
+BlockPlanCfg device_plan_cfg(const BlockPlanCfg& base, const WireTime& wire) {
+  BlockPlanCfg cfg = base;
+  if (cfg.max_transaction_ms > 0 && wire.serial) {
+    const double budget_us = cfg.max_transaction_ms * 1000.0;
+    cfg.max_block_regs = wire.max_read_count(3, budget_us, std::min(cfg.max_block_regs, kMaxReadRegisters));
+    cfg.max_block_bits = wire.max_read_count(1, budget_us, std::min(cfg.max_block_bits, kMaxReadBits));
+  }
+  return cfg;
+}
+
+DeviceLoad estimate_bus_load(const IoContext& ctx, const Device& dev) {
+  DeviceLoad load;
+  load.device = dev.name;
+  const WireTime wire = WireTime::for_device(dev);
+  load.serial = wire.serial;
+  const BlockPlanCfg cfg = device_plan_cfg(ctx.block_plan, wire);
+
+  std::map<int, std::vector<const ItemCfg*>> by_period;
+  for (const auto& kv : ctx.items) {
+    const ItemCfg& ic = kv.second;
+    if (ic.poll_ms <= 0 || !is_readable(ic) || ctx.devices[ic.device].get() != &dev) continue;
+    by_period[ctx.poll_periods.quantize(ic.poll_ms)].push_back(&ic);
+  }
+  for (const auto& kv : by_period) {
+    GroupLoad g;
+    g.poll_ms = kv.first;
+    g.items = static_cast<int>(kv.second.size());
+    for (const ReadBlock& b : plan_blocks(kv.second, cfg)) {
+      g.blocks += 1;
+      g.wire_us += wire.read_us(b.function, b.count);
+    }
+    g.utilization_pct = g.wire_us / (g.poll_ms * 1000.0) * 100.0;
+    load.utilization_pct += g.utilization_pct;
+    load.groups.push_back(g);
+  }
+  return load;
+}
+
+} // namespace wiq
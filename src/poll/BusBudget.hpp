@@ -0,0 +1,34 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "poll/WireTime.hpp"
+#include <string>
+#include <vector>
+
+namespace wiq {
+
+// Block limits for `dev`: `base` with the block size capped so that every
+// read fits `base.max_transaction_ms` of line time (serial devices only).
+BlockPlanCfg device_plan_cfg(const BlockPlanCfg& base, const WireTime& wire);
+
+// Scan demand of one poll interval: line time of its block reads per cycle.
+struct GroupLoad {
+  int poll_ms{0};  // after harmonic quantization
+  int items{0};
+  int blocks{0};
+  double wire_us{0};
+  double utilization_pct{0};  // wire_us / poll period
+};
+
+// Worst-case bus load of a device, as if every item with poll_ms > 0 were
+// subscribed. Only serial lines are modelled; TCP devices report 0.
+struct DeviceLoad {
+  std::string device;
+  bool serial{false};
+  std::vector<GroupLoad> groups;
+  double utilization_pct{0};
+};
+
+DeviceLoad estimate_bus_load(const IoContext& ctx, const Device& dev);
+
+} // namespace wiq
@@ -0,0 +1,891 @@
+#include "poll/PollEngine.hpp"
+#include "poll/BusBudget.hpp"
+#include "ProcessImage.hpp"
+#include "ValueCache.hpp"
+#include "ModbusError.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <map>
+
+namespace wiq {
+
+PollEngine::PollEngine(IoContext& ctx, Device& dev)
+: ctx_(ctx), dev_(dev), epoch_(clock::now()), wire_(WireTime::for_device(dev)),
+  plan_cfg_(device_plan_cfg(ctx.block_plan, wire_)) {
+  for (const auto& kv : ctx_.items) {
+    const ItemCfg& ic = kv.second;
+    if ((ic.poll_ms <= 0 && !ic.trigger.source) || !is_readable(ic) || &ctx_.device_of(ic) != &dev_) continue;
+    ItemState st;
+    st.group = st.base_group = ic.trigger.source ? gated_group_for(*ic.trigger.source, ic.trigger.mode)
+                                                 : group_for(ctx_.poll_periods.quantize(ic.poll_ms));
+    states_[&ic] = st;
+    samples_[&ic] = Sample{};
+  }
+}
+
+PollEngine::~PollEngine() { stop(); }
+
+void PollEngine::start() {
+  if (groups_.empty() || thread_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stop_ = false;
+  }
+  thread_ = std::thread([this]{ run(); });
+  log::log_debug(__FILE__, __LINE__, "poll engine for device '%s' started: %d interval(s), %d pollable item(s)",
+                 dev_.name.c_str(), static_cast<int>(groups_.size()), static_cast<int>(samples_.size()));
+}
+
+void PollEngine::stop() {
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+bool PollEngine::polls(const ItemCfg& ic) const {
+  std::lock_guard<std::mutex> lk(cache_mu_);
+  auto it = samples_.find(&ic);
+  return it != samples_.end() && it->second.active;
+}
+
+int PollEngine::subscribe(const ItemCfg& ic) {
+  bool wake = false;
+  int refs = 0;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    refs = add_ref(ic, wake);
+  }
+  if (wake) cv_.notify_all();
+  return refs;
+}
+
+void PollEngine::subscribe(const std::vector<const ItemCfg*>& items) {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const ItemCfg* ic : items) add_ref(*ic, wake);
+  }
+  if (wake) cv_.notify_all();
+}
+
+int PollEngine::unsubscribe(const ItemCfg& ic) {
+  std::lock_guard<std::mutex> lk(mu_);
+  return drop_ref(ic);
+}
+
+int PollEngine::add_ref(const ItemCfg& ic, bool& wake) {
+  auto it = states_.find(&ic);
+  if (it == states_.end()) return 0;
+  ItemState& st = it->second;
+  const int refs = ++st.refs;
+  if (refs > 1) return refs;
+  st.group = st.base_group;
+  Group& g = groups_[st.group];
+  st.index = g.items.size();
+  g.items.push_back(&ic);
+  g.dirty = true;
+  {
+    std::lock_guard<std::mutex> ck(cache_mu_);
+    samples_[&ic].active = true;
+  }
+  // A gated item holds a reference on its trigger, whose samples release it.
+  if (g.trigger) {
+    add_ref(*g.trigger, wake);
+    return refs;
+  }
+  if (!g.armed) {
+    g.next_release = staggered_release(g, clock::now());
+    g.armed = true;
+    arm(g);
+    wake = true;
+  }
+  return refs;
+}
+
+int PollEngine::drop_ref(const ItemCfg& ic) {
+  auto it = states_.find(&ic);
+  if (it == states_.end() || it->second.refs == 0) return 0;
+  ItemState& st = it->second;
+  if (--st.refs > 0) return st.refs;
+  // Swap-remove from the group; the moved item takes over the freed index.
+  Group& g = groups_[st.group];
+  const ItemCfg* moved = g.items.back();
+  g.items[st.index] = moved;
+  states_[moved].index = st.index;
+  g.items.pop_back();
+  g.dirty = true;
+  st.group = st.base_group;
+  dropped_.push_back(&ic);
+  {
+    std::lock_guard<std::mutex> ck(cache_mu_);
+    Sample& s = samples_[&ic];
+    s.active = false;
+    s.valid = false;
+  }
+  if (g.trigger) drop_ref(*g.trigger);
+  return 0;
+}
+
+bool PollEngine::lookup(const ItemCfg& ic, RawValue& out, int& rc) const {
+  std::lock_guard<std::mutex> lk(cache_mu_);
+  auto it = samples_.find(&ic);
+  if (it == samples_.end() || !it->second.active || !it->second.valid) return false;
+  out = it->second.raw;
+  rc = it->second.rc;
+  return true;
+}
+
+void PollEngine::store(const ItemCfg& ic, const RawValue& raw, int rc) {
+  std::lock_guard<std::mutex> lk(cache_mu_);
+  auto it = samples_.find(&ic);
+  if (it == samples_.end() || !it->second.active) return;
+  it->second.raw = raw;
+  it->second.rc = rc;
+  it->second.ts = clock::now();
+  it->second.valid = true;
+}
+
+void PollEngine::invalidate_written(const ItemCfg& ic) {
+  // Writes land in the coil table (FC1/2/5/15 items) or the holding table (FC3/6/16).
+  int table = 0;
+  if (ic.function == 1 || ic.function == 2 || ic.function == 5 || ic.function == 15) table = 1;
+  else if (ic.function == 3 || ic.function == 6 || ic.function == 16) table = 3;
+  int first = ic.address;
+  int n = (ic.function == 3) ? read_span(ic).count : (ic.count > 0 ? ic.count : 1);
+  int last = first + n - 1;
+  std::lock_guard<std::mutex> lk(cache_mu_);
+  for (auto& kv : samples_) {
+    const ItemCfg& other = *kv.first;
+    if (&other != &ic) {
+      if (other.function != table) continue;
+      if (ic.unit_id != 0 && other.unit_id != ic.unit_id) continue;
+      ItemSpan s = read_span(other);
+      if (s.address > last || s.address + s.count - 1 < first) continue;
+    }
+    kv.second.valid = false;
+  }
+}
+
+std::uint64_t PollEngine::to_tick_ceil(clock::time_point tp) const {
+  if (tp <= epoch_) return 0;
+  auto d = tp - epoch_;
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d);
+  if (ms < d) ms += std::chrono::milliseconds(1);
+  return static_cast<std::uint64_t>(ms.count());
+}
+
+PollEngine::clock::time_point PollEngine::from_tick(std::uint64_t tick) const {
+  return epoch_ + std::chrono::milliseconds(static_cast<std::int64_t>(tick));
+}
+
+void PollEngine::arm(Group& g) {
+  wheel_.schedule(g.id, to_tick_ceil(g.next_release));
+}
+
+static long long gcd_ms(long long a, long long b) {
+  while (b != 0) { long long t = a % b; a = b; b = t; }
+  return a;
+}
+
+PollEngine::clock::time_point PollEngine::staggered_release(const Group& g, clock::time_point earliest) const {
+  using std::chrono::milliseconds;
+  const long long period = std::chrono::duration_cast<milliseconds>(g.period).count();
+  const long long start = static_cast<long long>(to_tick_ceil(earliest));
+  if (!ctx_.poll_periods.stagger || period <= 1) return earliest;
+  // Two groups with periods P and Q release together every gcd(P, Q) ms, at
+  // matching phases modulo that gcd. Try evenly spaced phases of this group
+  // and keep the one whose nearest neighbour is farthest away, relative to
+  // the gcd; harmonic periods make the gcd large and the choice meaningful.
+  struct Other { long long phase; long long period; };
+  std::vector<Other> others;
+  for (const auto& o : groups_) {
+    if (!o.armed || o.id == g.id) continue;
+    const long long p = std::chrono::duration_cast<milliseconds>(o.period).count();
+    others.push_back({static_cast<long long>(to_tick_ceil(o.next_release)) % p, p});
+  }
+  if (others.empty()) return earliest;
+  const long long candidates = std::min<long long>(period, 32);
+  double best_score = -1.0;
+  long long best_delay = 0;
+  for (long long i = 0; i < candidates; ++i) {
+    const long long phase = i * period / candidates;
+    double score = 1.0;
+    for (const auto& o : others) {
+      const long long m = gcd_ms(period, o.period);
+      long long d = ((phase - o.phase) % m + m) % m;
+      d = std::min(d, m - d);
+      score = std::min(score, static_cast<double>(d) / static_cast<double>(m));
+    }
+    const long long delay = ((phase - start) % period + period) % period;
+    if (score > best_score || (score == best_score && delay < best_delay)) {
+      best_score = score;
+      best_delay = delay;
+    }
+  }
+  return from_tick(static_cast<std::uint64_t>(start + best_delay));
+}
+
+std::size_t PollEngine::group_for(int period_ms) {
+  auto found = period_groups_.find(period_ms);
+  if (found != period_groups_.end()) return found->second;
+  Group g;
+  g.id = groups_.size();
+  g.period = std::chrono::milliseconds(period_ms);
+  groups_.push_back(g);
+  period_groups_.emplace(period_ms, static_cast<std::size_t>(g.id));
+  return static_cast<std::size_t>(g.id);
+}
+
+std::size_t PollEngine::gated_group_for(const ItemCfg& trigger, TriggerMode mode) {
+  std::vector<std::size_t>& ids = triggers_[&trigger];
+  for (std::size_t id : ids) {
+    if (groups_[id].mode == mode) return id;
+  }
+  Group g;
+  g.id = groups_.size();
+  // Jobs are due by the trigger's next sample.
+  g.period = std::chrono::milliseconds(ctx_.poll_periods.quantize(trigger.poll_ms));
+  g.trigger = &trigger;
+  g.mode = mode;
+  groups_.push_back(g);
+  ids.push_back(static_cast<std::size_t>(g.id));
+  return static_cast<std::size_t>(g.id);
+}
+
+void PollEngine::adapt(const ItemCfg& ic, const RawValue& raw) {
+  // Samples taken at a burst rate say nothing about the item's normal one.
+  if (bursts_.count(&ic)) return;
+  const AdaptivePollCfg& cfg = ic.adaptive;
+  const int base_ms = ctx_.poll_periods.quantize(ic.poll_ms);
+  const int max_ms = std::max(base_ms, ctx_.poll_periods.quantize(cfg.max_poll_ms));
+  Adapt& a = adapt_[&ic];
+  if (a.period_ms == 0) a.period_ms = base_ms;
+  const bool changed = a.seen && (raw.bits != a.last.bits || raw.words != a.last.words);
+  a.last = raw;
+  a.seen = true;
+  if (changed) {
+    a.stable = 0;
+    a.changes += 1;
+    if (a.period_ms != base_ms && a.changes >= cfg.change_polls) {
+      a.changes = 0;
+      a.period_ms = base_ms;
+      ctx_.diagnostics.adaptive_speedups += 1;
+      retarget(ic);
+    }
+    return;
+  }
+  if (++a.stable < cfg.stable_polls) return;
+  // A stable run forgives earlier isolated changes and earns a longer period.
+  a.stable = 0;
+  a.changes = 0;
+  if (a.period_ms >= max_ms) return;
+  a.period_ms = a.period_ms > max_ms / 2 ? max_ms : a.period_ms * 2;
+  ctx_.diagnostics.adaptive_slowdowns += 1;
+  retarget(ic);
+}
+
+int PollEngine::normal_period_ms(const ItemCfg& ic) const {
+  auto a = adapt_.find(&ic);
+  if (a != adapt_.end() && a->second.period_ms > 0) return a->second.period_ms;
+  return ctx_.poll_periods.quantize(ic.poll_ms);
+}
+
+void PollEngine::retarget(const ItemCfg& ic) {
+  int period_ms = normal_period_ms(ic);
+  auto b = bursts_.find(&ic);
+  if (b != bursts_.end()) period_ms = std::min(period_ms, b->second.period_ms);
+  move_item(ic, period_ms);
+}
+
+static bool burst_holds(const BurstRule& rule, double v) {
+  switch (rule.when) {
+    case BurstRule::When::Eq: return v == rule.value;
+    case BurstRule::When::Ne: return v != rule.value;
+    case BurstRule::When::Gt: return v > rule.value;
+    case BurstRule::When::Ge: return v >= rule.value;
+    case BurstRule::When::Lt: return v < rule.value;
+    case BurstRule::When::Le: return v <= rule.value;
+    case BurstRule::When::Change: break;
+  }
+  return false;
+}
+
+void PollEngine::evaluate_bursts(const ItemCfg& ic, const RawValue& raw) {
+  double v = 0.0;
+  bool decoded = false;
+  bool numeric = false;
+  for (const BurstRule& rule : ic.bursts) {
+    RuleState& rs = rules_[&rule];
+    bool fire = false;
+    if (rule.when == BurstRule::When::Change) {
+      fire = rs.seen && (raw.bits != rs.last.bits || raw.words != rs.last.words);
+      rs.last = raw;
+    } else {
+      // Comparisons fire on the sample where they start to hold.
+      if (!decoded) {
+        numeric = decode_number(ic, raw, v);
+        decoded = true;
+      }
+      const bool held = numeric && burst_holds(rule, v);
+      fire = held && !rs.held;
+      rs.held = held;
+    }
+    rs.seen = true;
+    if (fire) start_burst(rule);
+  }
+}
+
+void PollEngine::start_burst(const BurstRule& rule) {
+  ctx_.diagnostics.burst_activations += 1;
+  const clock::time_point until = clock::now() + std::chrono::milliseconds(rule.duration_ms);
+  const int period_ms = ctx_.poll_periods.quantize(rule.poll_ms);
+  for (const ItemCfg* t : rule.targets) {
+    auto found = bursts_.find(t);
+    if (found == bursts_.end()) {
+      bursts_[t] = Burst{until, period_ms};
+      retarget(*t);
+      continue;
+    }
+    Burst& b = found->second;
+    b.until = std::max(b.until, until);
+    if (period_ms < b.period_ms) {
+      b.period_ms = period_ms;
+      retarget(*t);
+    }
+  }
+}
+
+void PollEngine::expire_bursts(clock::time_point now) {
+  std::vector<const ItemCfg*> ended;
+  for (const auto& kv : bursts_) {
+    if (kv.second.until <= now) ended.push_back(kv.first);
+  }
+  for (const ItemCfg* ic : ended) {
+    bursts_.erase(ic);
+    retarget(*ic);
+  }
+}
+
+void PollEngine::charge_burst(const ReadBlock& block, clock::duration d) {
+  if (bursts_.empty() || block.members.empty()) return;
+  // A member read every B ms instead of every N ms owes 1 - B/N of each read
+  // to its burst; members share the block's bus time equally.
+  double extra = 0.0;
+  for (const auto& m : block.members) {
+    auto b = bursts_.find(m.item);
+    if (b == bursts_.end()) continue;
+    const int normal = normal_period_ms(*m.item);
+    if (b->second.period_ms < normal) extra += 1.0 - static_cast<double>(b->second.period_ms) / normal;
+  }
+  if (extra <= 0.0) return;
+  const double us = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+  ctx_.diagnostics.burst_bus_us += static_cast<std::uint64_t>(us * extra / block.members.size());
+}
+
+void PollEngine::move_item(const ItemCfg& ic, int period_ms) {
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = states_.find(&ic);
+  if (it == states_.end() || it->second.refs == 0) return;
+  ItemState& st = it->second;
+  const std::size_t to = group_for(period_ms);
+  if (to == st.group) return;
+  Group& from = groups_[st.group];
+  const ItemCfg* moved = from.items.back();
+  from.items[st.index] = moved;
+  states_[moved].index = st.index;
+  from.items.pop_back();
+  from.dirty = true;
+
+  Group& g = groups_[to];
+  st.group = to;
+  st.index = g.items.size();
+  g.items.push_back(&ic);
+  g.dirty = true;
+  if (!g.armed) {
+    // The item was just sampled; its next read need not come before one
+    // new period has passed.
+    g.next_release = staggered_release(g, clock::now() + g.period);
+    g.armed = true;
+    arm(g);
+  }
+}
+
+int PollEngine::poll_block(const ReadBlock& block, std::vector<ReadBlock>* split) {
+  BlockData data;
+  int rc = read_block(&ctx_, dev_, block, data);
+  return apply_block(block, data, rc, split);
+}
+
+int PollEngine::apply_block(const ReadBlock& block, const BlockData& data, int rc, std::vector<ReadBlock>* split) {
+  if (rc == 0) record_success(&ctx_, &dev_);
+  else record_error(&ctx_, &dev_, block.function, block.unit_id, rc);
+
+  if (rc != 0 && split && block.members.size() > 1 && is_modbus_exception(rc)) {
+    // A merged block may span addresses the device rejects (e.g. a gap with
+    // no registers behind it). Fall back to one block per item from now on.
+    log::log_warn(__FILE__, __LINE__, "block read unit=%d fc=%d addr=%d count=%d failed (%d); splitting",
+                  block.unit_id, block.function, block.address, block.count, rc);
+    for (const auto& m : block.members) {
+      ReadBlock single;
+      single.unit_id = block.unit_id;
+      single.function = block.function;
+      single.address = block.address + m.offset;
+      single.count = m.count;
+      single.members.push_back({m.item, 0, m.count});
+      poll_block(single, nullptr);
+      split->push_back(single);
+    }
+    return rc;
+  }
+
+  if (rc == 0 && dev_.image) dev_.image->write(block, data);
+  RawValue raw;
+  for (const auto& m : block.members) {
+    if (rc == 0) slice_member(block, data, m, raw);
+    store(*m.item, raw, rc);
+    dev_.cache->store(*m.item, raw, rc);
+    note_sample(*m.item, raw, rc);
+    if (rc == 0 && m.item->adaptive.max_poll_ms > 0) adapt(*m.item, raw);
+    if (rc == 0 && !m.item->bursts.empty()) evaluate_bursts(*m.item, raw);
+    if (rc == 0 && !triggers_.empty()) {
+      auto t = triggers_.find(m.item);
+      if (t != triggers_.end()) {
+        for (std::size_t group : t->second) on_trigger(group, raw);
+      }
+    }
+  }
+  return rc;
+}
+
+void PollEngine::on_trigger(std::size_t group, const RawValue& raw) {
+  std::lock_guard<std::mutex> lk(mu_);
+  Group& g = groups_[group];
+  if (g.items.empty()) return;
+  bool fire = false;
+  if (g.mode == TriggerMode::Gate) {
+    fire = std::any_of(raw.bits.begin(), raw.bits.end(), [](std::uint8_t b) { return b != 0; }) ||
+           std::any_of(raw.words.begin(), raw.words.end(), [](std::uint16_t w) { return w != 0; });
+  } else {
+    fire = !g.trigger_seen || raw.bits != g.trigger_last.bits || raw.words != g.trigger_last.words;
+  }
+  g.trigger_last = raw;
+  g.trigger_seen = true;
+  // New members need a first value whatever the trigger says; a read still
+  // queued from the last release will see the latest data anyway.
+  if (g.dirty) fire = true;
+  if (!fire || g.pending > 0) {
+    ctx_.diagnostics.trigger_holds += 1;
+    return;
+  }
+  ctx_.diagnostics.trigger_fires += 1;
+  if (g.dirty) {
+    g.plan = plan_blocks(g.items, plan_cfg_);
+    g.dirty = false;
+  }
+  g.releases += 1;
+  const clock::time_point now = clock::now();
+  g.cycle += 1;
+  g.cycle_start = now;
+  queue_blocks(g, now + g.period, now);
+}
+
+void PollEngine::begin_push_tick() {
+  std::lock_guard<std::mutex> lk(ctx_.push.mu);
+  pushing_ = ctx_.push.cb != nullptr;
+  std::uint64_t gen = ctx_.push.generation.load();
+  if (gen != push_generation_) {
+    // A newly registered callback starts from a full snapshot.
+    push_generation_ = gen;
+    delivered_.clear();
+    changed_.clear();
+  }
+}
+
+void PollEngine::note_sample(const ItemCfg& ic, const RawValue& raw, int rc) {
+  if (!pushing_) return;
+  auto it = delivered_.find(&ic);
+  if (it != delivered_.end()) {
+    Delivered& d = it->second;
+    // Errors are compared by code only; values by their raw bits/registers.
+    bool same = (rc != 0) ? d.rc == rc
+                          : d.rc == 0 && d.raw.bits == raw.bits && d.raw.words == raw.words;
+    if (same) return;
+  } else {
+    it = delivered_.emplace(&ic, Delivered{}).first;
+  }
+  it->second.rc = rc;
+  if (rc == 0) it->second.raw = raw;
+  if (!it->second.pending) {
+    it->second.pending = true;
+    changed_.push_back(&ic);
+  }
+}
+
+void PollEngine::deliver_changes() {
+  if (changed_.empty()) return;
+  std::vector<std::string> texts;
+  texts.reserve(changed_.size());
+  for (const ItemCfg* ic : changed_) {
+    Delivered& d = delivered_[ic];
+    d.pending = false;
+    texts.push_back(d.rc == 0 ? format_value(*ic, d.raw) : format_error(*ic, d.rc));
+  }
+  std::vector<wiq_item_value> batch(changed_.size());
+  for (std::size_t i = 0; i < changed_.size(); ++i) {
+    batch[i].item = changed_[i]->name.c_str();
+    batch[i].value_json = texts[i].c_str();
+  }
+  changed_.clear();
+
+  std::lock_guard<std::mutex> lk(ctx_.push.mu);
+  // Dropped if the callback was replaced meanwhile; the new one gets a snapshot.
+  if (!ctx_.push.cb || ctx_.push.generation.load() != push_generation_) return;
+  ctx_.push.cb(batch.data(), static_cast<int>(batch.size()), ctx_.push.user);
+}
+
+void PollEngine::replace_block(std::size_t group, const ReadBlock& old, const std::vector<ReadBlock>& singles) {
+  // Only this thread changes plans; the lock is for subscribers and plan_json().
+  std::lock_guard<std::mutex> lk(mu_);
+  auto& plan = groups_[group].plan;
+  for (auto it = plan.begin(); it != plan.end(); ++it) {
+    if (it->unit_id == old.unit_id && it->function == old.function &&
+        it->address == old.address && it->count == old.count) {
+      it = plan.erase(it);
+      plan.insert(it, singles.begin(), singles.end());
+      return;
+    }
+  }
+}
+
+void PollEngine::release(Group& g) {
+  if (g.items.empty()) {
+    // Last member left: stop cycling until the next subscription.
+    g.armed = false;
+    g.plan.clear();
+    g.dirty = false;
+    return;
+  }
+  if (g.dirty) {
+    g.plan = plan_blocks(g.items, plan_cfg_);
+    g.dirty = false;
+  }
+  ctx_.diagnostics.poll_cycles += 1;
+  g.releases += 1;
+
+  // Drift compensation: the next release derives from the previous
+  // scheduled release, not from when this one happened to be processed.
+  g.next_release += g.period;
+  clock::time_point now = clock::now();
+  if (g.next_release <= now) {
+    auto missed = (now - g.next_release) / g.period + 1;
+    g.next_release += g.period * missed;
+    ctx_.diagnostics.poll_overruns += static_cast<std::uint64_t>(missed);
+  }
+
+  // A cycle still running when the next one starts has overrun.
+  if (g.pending > 0) end_cycle(g, now);
+  if (ctx_.shed.cycle_target_pct > 0 && now >= window_end_) adjust_shedding(now);
+  g.cycle += 1;
+  g.cycle_start = now;
+  queue_blocks(g, g.next_release, now);
+  arm(g);
+}
+
+void PollEngine::queue_blocks(Group& g, clock::time_point deadline, clock::time_point now) {
+  g.pending = 0;
+  const std::uint64_t deadline_tick = to_tick_ceil(deadline);
+  for (std::size_t i = 0; i < g.plan.size(); ++i) {
+    const ReadBlock& block = g.plan[i];
+    if (health_[block.unit_id].hold_until > now) {
+      record_deadline_miss(block.unit_id);
+      continue;
+    }
+    if (shed(block, g.releases + i)) continue;
+    std::uint64_t id = next_job_id_++;
+    jobs_[id] = PollJob{static_cast<std::size_t>(g.id), block, deadline, g.cycle};
+    sched_.push(block.unit_id, deadline_tick, id);
+    g.pending += 1;
+  }
+}
+
+void PollEngine::run_jobs(const std::vector<PollJob>& jobs) {
+  std::vector<const PollJob*> live;
+  std::vector<const ReadBlock*> blocks;
+  for (const auto& job : jobs) {
+    if (clock::now() > job.deadline) {
+      // The group's next release already queued a fresh job for this block.
+      record_deadline_miss(job.block.unit_id);
+      job_done(job);
+      continue;
+    }
+    live.push_back(&job);
+    blocks.push_back(&job.block);
+  }
+  if (live.empty()) return;
+  const clock::time_point started = clock::now();
+  if (live.size() == 1) {
+    std::vector<ReadBlock> split;
+    int rc = poll_block(live[0]->block, &split);
+    const clock::duration took = clock::now() - started;
+    add_busy(live[0]->group, took);
+    charge_burst(live[0]->block, took);
+    if (!split.empty()) replace_block(live[0]->group, live[0]->block, split);
+    finish_job(*live[0], rc);
+    return;
+  }
+  std::vector<BlockData> data;
+  std::vector<int> rcs;
+  read_blocks(&ctx_, dev_, blocks, data, rcs);
+  // One round trip served them all; charge each group an equal share.
+  const clock::duration share = (clock::now() - started) / static_cast<int>(live.size());
+  for (const PollJob* job : live) {
+    add_busy(job->group, share);
+    charge_burst(job->block, share);
+  }
+  for (std::size_t i = 0; i < live.size(); ++i) {
+    std::vector<ReadBlock> split;
+    int rc = apply_block(live[i]->block, data[i], rcs[i], &split);
+    if (!split.empty()) replace_block(live[i]->group, live[i]->block, split);
+    finish_job(*live[i], rc);
+  }
+}
+
+void PollEngine::add_busy(std::size_t group, clock::duration d) {
+  std::lock_guard<std::mutex> lk(mu_);
+  groups_[group].busy_us += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+}
+
+// Block reads kept per release at each shed level and priority: 1 keeps
+// every release, n keeps one release in n, 0 skips the block. `slot` is the
+// release count plus the block's index in the plan, so the blocks of a
+// stretched class take turns instead of all landing on the same release.
+static const int kShedEvery[][3] = {
+  // realtime, normal, background
+  {1, 1, 1},
+  {1, 1, 4},
+  {1, 2, 0},
+  {1, 4, 0},
+  {1, 0, 0},
+};
+static const int kMaxShedLevel = static_cast<int>(sizeof(kShedEvery) / sizeof(kShedEvery[0])) - 1;
+static const int kCalmWindows = 3;
+
+bool PollEngine::shed(const ReadBlock& block, std::uint64_t slot) {
+  if (shed_level_ == 0) return false;
+  // A block is as urgent as its most urgent member.
+  int cls = static_cast<int>(PollPriority::Background);
+  for (const auto& m : block.members) cls = std::min(cls, static_cast<int>(m.item->priority));
+  const int every = kShedEvery[shed_level_][cls];
+  if (every == 1 || (every > 1 && slot % static_cast<std::uint64_t>(every) == 0)) return false;
+  if (cls == static_cast<int>(PollPriority::Normal)) ctx_.diagnostics.shed_normal += 1;
+  else ctx_.diagnostics.shed_background += 1;
+  return true;
+}
+
+void PollEngine::adjust_shedding(clock::time_point now) {
+  const double target = ctx_.shed.cycle_target_pct / 100.0;
+  const int before = shed_level_;
+  // Step up at once, step down only after several calm windows: the level
+  // just below is often the one that overloaded the bus.
+  if (window_worst_ > target) {
+    calm_windows_ = 0;
+    if (shed_level_ < kMaxShedLevel) shed_level_ += 1;
+  } else if (window_worst_ < target / 2 && shed_level_ > 0) {
+    if (++calm_windows_ >= kCalmWindows) {
+      calm_windows_ = 0;
+      shed_level_ -= 1;
+    }
+  } else {
+    calm_windows_ = 0;
+  }
+  if (shed_level_ != before) {
+    log::log_info(__FILE__, __LINE__, "device '%s': slowest poll cycle at %.0f%% of its period, shed level %d -> %d",
+                  dev_.name.c_str(), window_worst_ * 100.0, before, shed_level_);
+    dev_.diagnostics.shed_level = shed_level_;
+  }
+  window_worst_ = 0;
+  window_end_ = now + std::chrono::milliseconds(ctx_.shed.window_ms);
+}
+
+void PollEngine::end_cycle(Group& g, clock::time_point end) {
+  g.pending = 0;
+  const double share = std::chrono::duration<double>(end - g.cycle_start) / std::chrono::duration<double>(g.period);
+  window_worst_ = std::max(window_worst_, share);
+}
+
+void PollEngine::job_done(const PollJob& job) {
+  Group& g = groups_[job.group];
+  if (job.cycle != g.cycle || g.pending == 0) return;
+  if (--g.pending == 0) end_cycle(g, clock::now());
+}
+
+void PollEngine::finish_job(const PollJob& job, int rc) {
+  const int unit = job.block.unit_id;
+  clock::time_point done = clock::now();
+  if (done > job.deadline) record_deadline_miss(unit);
+  job_done(job);
+
+  UnitHealth& h = health_[unit];
+  if (rc != static_cast<int>(ModbusErr::IO_TIMEOUT)) {
+    // Any answer, including a Modbus exception, shows the unit is alive.
+    h.timeouts = 0;
+    return;
+  }
+  h.timeouts += 1;
+  const UnitBackoffCfg& cfg = ctx_.unit_backoff;
+  if (cfg.base_ms <= 0) return;
+  long long hold = cfg.base_ms;
+  for (int i = 1; i < h.timeouts && hold < cfg.max_ms; ++i) hold *= 2;
+  if (hold > cfg.max_ms) hold = cfg.max_ms;
+  h.hold_until = done + std::chrono::milliseconds(hold);
+  dev_.diagnostics.record_backoff(unit);
+  log::log_warn(__FILE__, __LINE__, "device '%s' unit %d timed out %d time(s) in a row; holding off polls for %lld ms",
+                dev_.name.c_str(), unit, h.timeouts, hold);
+}
+
+nlohmann::json PollEngine::plan_json() {
+  std::lock_guard<std::mutex> lk(mu_);
+  nlohmann::json groups = nlohmann::json::array();
+  for (const auto& g : groups_) {
+    nlohmann::json blocks = nlohmann::json::array();
+    for (const auto& b : g.plan) {
+      nlohmann::json items = nlohmann::json::array();
+      for (const auto& m : b.members) items.push_back(m.item->name);
+      blocks.push_back({
+        {"unit_id", b.unit_id},
+        {"function", b.function},
+        {"address", b.address},
+        {"count", b.count},
+        {"wire_us", static_cast<long long>(wire_.read_us(b.function, b.count) + 0.5)},
+        {"items", std::move(items)}
+      });
+    }
+    nlohmann::json group = {
+      {"device", dev_.name},
+      {"poll_ms", std::chrono::duration_cast<std::chrono::milliseconds>(g.period).count()},
+      {"blocks", std::move(blocks)}
+    };
+    if (g.trigger) {
+      group["trigger"] = g.trigger->name;
+      group["mode"] = g.mode == TriggerMode::Gate ? "gate" : "change";
+    }
+    groups.push_back(std::move(group));
+  }
+  return nlohmann::json{{"groups", std::move(groups)}};
+}
+
+nlohmann::json PollEngine::rates_json() {
+  std::lock_guard<std::mutex> lk(mu_);
+  nlohmann::json items = nlohmann::json::array();
+  for (const auto& kv : states_) {
+    if (kv.second.refs == 0) continue;
+    items.push_back({
+      {"name", kv.first->name},
+      {"device", dev_.name},
+      {"poll_ms", kv.first->poll_ms},
+      {"priority", kv.first->priority == PollPriority::Realtime ? "realtime"
+                   : kv.first->priority == PollPriority::Background ? "background" : "normal"},
+      {"effective_ms", std::chrono::duration_cast<std::chrono::milliseconds>(groups_[kv.second.group].period).count()}
+    });
+  }
+  return items;
+}
+
+nlohmann::json PollEngine::periods_json() {
+  std::lock_guard<std::mutex> lk(mu_);
+  nlohmann::json periods = nlohmann::json::array();
+  for (const auto& kv : period_groups_) {
+    const Group& g = groups_[kv.second];
+    if (!g.armed && g.releases == 0) continue;
+    const double per_release_us = g.releases ? static_cast<double>(g.busy_us) / g.releases : 0.0;
+    periods.push_back({
+      {"device", dev_.name},
+      {"period_ms", kv.first},
+      {"phase_ms", g.armed ? static_cast<long long>(to_tick_ceil(g.next_release) % static_cast<std::uint64_t>(kv.first)) : 0},
+      {"items", g.items.size()},
+      {"blocks", g.plan.size()},
+      {"releases", g.releases},
+      {"busy_us", g.busy_us},
+      {"load_pct", per_release_us / (kv.first * 1000.0) * 100.0}
+    });
+  }
+  return periods;
+}
+
+void PollEngine::reset_stats() {
+  std::lock_guard<std::mutex> lk(mu_);
+  for (auto& g : groups_) {
+    g.releases = 0;
+    g.busy_us = 0;
+  }
+}
+
+void PollEngine::run() {
+  std::unique_lock<std::mutex> lk(mu_);
+  std::vector<std::uint64_t> due;
+  std::vector<PollJob> batch;
+  while (!stop_) {
+    due.clear();
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - epoch_);
+    wheel_.advance(static_cast<std::uint64_t>(now_ms.count()),
+                   [&](std::uint64_t id) { due.push_back(id); });
+    if (!due.empty()) {
+      // Forget what was delivered for unsubscribed items so a later
+      // re-subscription starts with a fresh push.
+      for (const ItemCfg* ic : dropped_) {
+        delivered_.erase(ic);
+        adapt_.erase(ic);
+        bursts_.erase(ic);
+        for (const BurstRule& rule : ic->bursts) rules_.erase(&rule);
+      }
+      dropped_.clear();
+      // A release closes the previous tick's push batch and opens the next.
+      lk.unlock();
+      deliver_changes();
+      expire_bursts(clock::now());
+      begin_push_tick();
+      lk.lock();
+      for (std::uint64_t id : due) release(groups_[static_cast<std::size_t>(id)]);
+    }
+
+    UnitScheduler::Job next;
+    batch.clear();
+    if (!sched_.pop(next)) {
+      lk.unlock();
+      deliver_changes();
+      lk.lock();
+      if (stop_) break;
+      std::uint64_t hint = wheel_.next_expiry_hint();
+      if (hint == TimingWheel::kNoExpiry) cv_.wait(lk);
+      else cv_.wait_until(lk, from_tick(hint));
+      continue;
+    }
+    // With a pipeline window the next jobs in deadline order share one
+    // round trip; otherwise they run one at a time.
+    for (;;) {
+      auto found = jobs_.find(next.id);
+      batch.push_back(std::move(found->second));
+      jobs_.erase(found);
+      if (static_cast<int>(batch.size()) >= dev_.pipeline_window || !sched_.pop(next)) break;
+    }
+    lk.unlock();
+    run_jobs(batch);
+    lk.lock();
+  }
+}
+
+void PollEngine::record_deadline_miss(int unit) {
+  ctx_.diagnostics.deadline_misses += 1;
+  dev_.diagnostics.record_deadline_miss(unit);
+}
+
+std::unique_ptr<PollEngine> make_poll_engine(IoContext& ctx, Device& dev) {
+  std::unique_ptr<PollEngine> engine(new PollEngine(ctx, dev));
+  if (!engine->polls_anything()) return nullptr;
+  return engine;
+}
+
+} // namespace wiq
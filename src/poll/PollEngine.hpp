@@ -0,0 +1,274 @@
+#pragma once
+
+#include "IoContext.hpp"
+#include "ItemCodec.hpp"
+#include "poll/BlockPlanner.hpp"
+#include "poll/TimingWheel.hpp"
+#include "poll/UnitScheduler.hpp"
+#include "poll/WireTime.hpp"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace wiq {
+
+// Background poller for the subscribed items of one device with `poll_ms > 0`.
+// Every device runs its own engine and thread.
+//
+// Subscriptions are reference counted per item; an item is on the bus only
+// while its count is above zero. Subscribed items sharing a `poll_ms` form one
+// group (cf. the SDK's SubscriptionGroup) whose items are coalesced into
+// block reads (see BlockPlanner); the plan is rebuilt lazily on the next
+// release after membership changed. Items with `adaptive` settings move to
+// the group of a longer period while their value holds still and back to
+// their own on change. With `poll.harmonic_base_ms` periods snap down to
+// base * 2^k so that near-equal periods share a group, and a group armed
+// while others run takes the phase farthest from theirs (see
+// staggered_release). With `poll.cycle_target_pct` set, cycles running over
+// target raise a shed level that stretches, then skips, the reads of
+// background and normal-priority blocks; realtime blocks are never shed.
+// Items gated by a `trigger` form one group per trigger item and mode that
+// is never armed: it is released from the trigger's own sample, when that
+// changed (mode change) or is non-zero (mode gate), and subscribing a gated
+// item subscribes its trigger. Burst rules, evaluated on the decoded
+// samples of their item, move their subscribed targets to the group of a
+// shorter period for a while; the targets' own rules are evaluated at that
+// rate, so bursts chain.
+// Group releases are kept on a
+// steady_clock grid (next = previous release + period) and armed in a
+// hierarchical timing wheel, so jitter in one cycle never shifts later ones.
+// A release that comes too late skips the missed releases instead of
+// bursting to catch up.
+//
+// A release does not touch the bus itself: it queues one job per block, due
+// by the group's next release, on its unit's queue (UnitScheduler). The
+// thread dispatches one transaction at a time, earliest deadline first and
+// round-robin across units with equal deadlines, and re-checks the wheel in
+// between, so a slow unit delays the others by at most one transaction. Poll
+// reads take the bus in the lowest lane (BusArbiter), so writes and on-demand
+// reads go ahead of queued blocks; with `max_transaction_ms` set, blocks on a
+// serial line are sized to fit that bus time (WireTime). A unit
+// that keeps timing out is held off with a doubling backoff. Jobs finishing
+// after their deadline, and releases dropped during a hold-off, count as
+// deadline misses of their unit. Each poll stores the raw device data in a value cache
+// that ReadItem serves without touching the bus, and items whose raw data
+// changed since the last delivery are pushed to the host's read callback in one
+// batch per tick (see ModbusPush.hpp).
+class PollEngine {
+public:
+  using clock = std::chrono::steady_clock;
+
+  PollEngine(IoContext& ctx, Device& dev);
+  ~PollEngine();
+
+  PollEngine(const PollEngine&) = delete;
+  PollEngine& operator=(const PollEngine&) = delete;
+
+  void start();
+  void stop();
+
+  bool polls_anything() const { return !groups_.empty(); }
+
+  // True when `ic` is currently subscribed and cycled by this engine.
+  bool polls(const ItemCfg& ic) const;
+
+  // Add/drop one reference on `ic`. Both are O(1); items without poll_ms are
+  // ignored. Returns the resulting reference count.
+  int subscribe(const ItemCfg& ic);
+  int unsubscribe(const ItemCfg& ic);
+
+  // Add one reference on each of `items` at once: the poll thread sees all
+  // of them or none, so a trigger sample never releases a table that holds
+  // only part of the members subscribed together.
+  void subscribe(const std::vector<const ItemCfg*>& items);
+
+  // Copy the last polled sample of `ic`. Returns false when the item is not
+  // subscribed or no valid sample exists yet; `rc` carries the poll result.
+  bool lookup(const ItemCfg& ic, RawValue& out, int& rc) const;
+
+  // Store a sample obtained outside the engine (e.g. a ReadItem cache miss).
+  void store(const ItemCfg& ic, const RawValue& raw, int rc);
+
+  // Drop cached samples that a successful write to `ic` may have changed.
+  void invalidate_written(const ItemCfg& ic);
+
+  // Current block plan per group, for CallMethod("poll.plan").
+  nlohmann::json plan_json();
+
+  // Configured and effective period of every subscribed item, for
+  // CallMethod("poll.rates").
+  nlohmann::json rates_json();
+
+  // Per-period schedule and measured bus load, for diagnostics.snapshot.
+  nlohmann::json periods_json();
+  void reset_stats();
+
+private:
+  struct Group {
+    std::uint64_t id{};
+    clock::duration period{};
+    clock::time_point next_release{};
+    std::vector<const ItemCfg*> items;  // subscribed members, unordered
+    std::vector<ReadBlock> plan;
+    bool dirty{false};                  // items changed since `plan` was built
+    bool armed{false};                  // a release is pending in the wheel
+    std::uint64_t releases{0};
+    std::uint64_t busy_us{0};           // bus time spent on this group's reads
+    // Current cycle (release to last block read); poll thread only.
+    std::uint64_t cycle{0};
+    clock::time_point cycle_start{};
+    int pending{0};                     // jobs of the current cycle not yet done
+    // Trigger-gated group: released by samples of `trigger`, never armed.
+    const ItemCfg* trigger{nullptr};
+    TriggerMode mode{TriggerMode::Change};
+    RawValue trigger_last;              // poll thread only
+    bool trigger_seen{false};
+  };
+
+  // Subscription state of a pollable item; guarded by mu_.
+  struct ItemState {
+    std::size_t group{};       // group of the effective period
+    std::size_t base_group{};  // group of the configured poll_ms
+    std::size_t index{};       // position in groups_[group].items while refs > 0
+    int refs{0};
+  };
+
+  // Change tracking of an adaptive item; poll thread only.
+  struct Adapt {
+    RawValue last;
+    bool seen{false};
+    int stable{0};   // unchanged samples since the last change or rate step
+    int changes{0};  // changes since the last stable run
+    int period_ms{0};
+  };
+
+  // Active burst of a target item; poll thread only.
+  struct Burst {
+    clock::time_point until{};
+    int period_ms{0};
+  };
+
+  // Last evaluation of a burst rule; poll thread only.
+  struct RuleState {
+    RawValue last;
+    bool seen{false};
+    bool held{false};  // comparison was true on the last sample
+  };
+
+  struct Sample {
+    RawValue raw;
+    int rc{0};
+    clock::time_point ts{};
+    bool valid{false};
+    bool active{false};  // subscribed; inactive samples are neither served nor stored
+  };
+
+  // One queued block read of a group release.
+  struct PollJob {
+    std::size_t group{};
+    ReadBlock block;
+    clock::time_point deadline{};
+    std::uint64_t cycle{};
+  };
+
+  // Consecutive timeouts and hold-off of one unit; poll thread only.
+  struct UnitHealth {
+    int timeouts{0};
+    clock::time_point hold_until{};
+  };
+
+  void run();
+  void release(Group& g);
+  void queue_blocks(Group& g, clock::time_point deadline, clock::time_point now);
+  void on_trigger(std::size_t group, const RawValue& raw);
+  int add_ref(const ItemCfg& ic, bool& wake);
+  int drop_ref(const ItemCfg& ic);
+  void run_jobs(const std::vector<PollJob>& jobs);
+  void finish_job(const PollJob& job, int rc);
+  void add_busy(std::size_t group, clock::duration d);
+  void job_done(const PollJob& job);
+  void end_cycle(Group& g, clock::time_point end);
+  bool shed(const ReadBlock& block, std::uint64_t slot);
+  void adjust_shedding(clock::time_point now);
+  int poll_block(const ReadBlock& block, std::vector<ReadBlock>* split);
+  int apply_block(const ReadBlock& block, const BlockData& data, int rc, std::vector<ReadBlock>* split);
+  void replace_block(std::size_t group, const ReadBlock& old, const std::vector<ReadBlock>& singles);
+  void begin_push_tick();
+  void note_sample(const ItemCfg& ic, const RawValue& raw, int rc);
+  void deliver_changes();
+  void arm(Group& g);
+  clock::time_point staggered_release(const Group& g, clock::time_point earliest) const;
+  std::size_t group_for(int period_ms);
+  std::size_t gated_group_for(const ItemCfg& trigger, TriggerMode mode);
+  void adapt(const ItemCfg& ic, const RawValue& raw);
+  void move_item(const ItemCfg& ic, int period_ms);
+  int normal_period_ms(const ItemCfg& ic) const;
+  void retarget(const ItemCfg& ic);
+  void evaluate_bursts(const ItemCfg& ic, const RawValue& raw);
+  void start_burst(const BurstRule& rule);
+  void expire_bursts(clock::time_point now);
+  void charge_burst(const ReadBlock& block, clock::duration d);
+  void record_deadline_miss(int unit);
+  std::uint64_t to_tick_ceil(clock::time_point tp) const;
+  clock::time_point from_tick(std::uint64_t tick) const;
+
+  IoContext& ctx_;
+  Device& dev_;
+  clock::time_point epoch_;
+  WireTime wire_;
+  BlockPlanCfg plan_cfg_;  // ctx_.block_plan, capped to fit max_transaction_ms on this line
+
+  // Guards the wheel, group schedule and stop flag.
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stop_{false};
+  TimingWheel wheel_;
+  std::vector<Group> groups_;
+  std::map<int, std::size_t> period_groups_;  // poll period in ms -> groups_ index
+  // Trigger item -> its gated groups; fixed after construction.
+  std::unordered_map<const ItemCfg*, std::vector<std::size_t>> triggers_;
+  std::unordered_map<const ItemCfg*, ItemState> states_;
+  std::vector<const ItemCfg*> dropped_;  // unsubscribed since the last tick
+  UnitScheduler sched_;
+  std::unordered_map<std::uint64_t, PollJob> jobs_;
+  std::uint64_t next_job_id_{0};
+  std::map<int, UnitHealth> health_;
+
+  // Overload shedding controller (ShedCfg); poll thread only.
+  int shed_level_{0};
+  int calm_windows_{0};           // windows in a row with cycles under half the target
+  double window_worst_{0};        // slowest cycle in the window, as a share of its period
+  clock::time_point window_end_{};
+
+  // Guards samples_; lookups never wait on bus I/O.
+  mutable std::mutex cache_mu_;
+  std::unordered_map<const ItemCfg*, Sample> samples_;
+
+  // Change detection for SetReadCallback; only touched by the poll thread.
+  struct Delivered {
+    RawValue raw;
+    int rc{0};
+    bool pending{false};  // listed in changed_
+  };
+  bool pushing_{false};
+  std::uint64_t push_generation_{0};
+  std::unordered_map<const ItemCfg*, Delivered> delivered_;
+  std::unordered_map<const ItemCfg*, Adapt> adapt_;
+  std::unordered_map<const ItemCfg*, Burst> bursts_;
+  std::unordered_map<const BurstRule*, RuleState> rules_;
+  std::vector<const ItemCfg*> changed_;
+
+  std::thread thread_;
+};
+
+// Build an engine for `ctx` if any item is configured with poll_ms > 0.
+std::unique_ptr<PollEngine> make_poll_engine(IoContext& ctx, Device& dev);
+
+} // namespace wiq
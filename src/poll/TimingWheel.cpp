@@ -0,0 +1,78 @@
+#include "poll/TimingWheel.hpp"
+
+namespace wiq {
+
+TimingWheel::TimingWheel(std::uint64_t start_tick) : current_(start_tick) {}
+
+void TimingWheel::schedule(std::uint64_t id, std::uint64_t expiry_tick) {
+  // The current tick has already been processed; the earliest slot is the next one.
+  place(Entry{id, expiry_tick}, current_ + 1);
+  ++size_;
+}
+
+void TimingWheel::place(const Entry& e, std::uint64_t earliest) {
+  // Overdue timers go to the earliest pending slot so they are never lost.
+  std::uint64_t at = (e.expiry > earliest) ? e.expiry : earliest;
+  // The level is chosen by the highest 6-bit group in which `at` differs from
+  // the current tick, so level-0 only ever holds the current 64-tick window.
+  std::uint64_t diff = at ^ current_;
+  int level = 0;
+  while (level < kLevels - 1 && (diff >> (kSlotBits * (level + 1))) != 0) ++level;
+  if ((diff >> (kSlotBits * kLevels)) != 0) {
+    // `at` lies in a different top-level cycle. If its top-level block is
+    // still within one rotation it can use its own slot; otherwise park it in
+    // the slot visited last, from where the cascade re-places it.
+    const int top_shift = kSlotBits * (kLevels - 1);
+    std::uint64_t blocks_ahead = (at >> top_shift) - (current_ >> top_shift);
+    std::uint64_t block = (blocks_ahead < static_cast<std::uint64_t>(kSlots))
+                              ? (at >> top_shift)
+                              : (current_ >> top_shift) + kSlots - 1;
+    slots_[kLevels - 1][block & (kSlots - 1)].push_back(e);
+    return;
+  }
+  std::uint64_t idx = (at >> (kSlotBits * level)) & (kSlots - 1);
+  slots_[level][idx].push_back(e);
+}
+
+void TimingWheel::cascade(int level) {
+  std::uint64_t idx = (current_ >> (kSlotBits * level)) & (kSlots - 1);
+  std::vector<Entry> moved;
+  moved.swap(slots_[level][idx]);
+  // Cascading happens before the current tick's level-0 slot is fired, so
+  // entries due right now may still land in it.
+  for (const auto& e : moved) place(e, current_);
+}
+
+void TimingWheel::advance(std::uint64_t now_tick, const std::function<void(std::uint64_t)>& on_expire) {
+  std::vector<Entry> fired;
+  while (current_ < now_tick) {
+    // Skip quickly through empty stretches of the level-0 window.
+    if (size_ == 0) { current_ = now_tick; break; }
+    ++current_;
+    for (int level = 1; level < kLevels; ++level) {
+      if ((current_ & ((std::uint64_t(1) << (kSlotBits * level)) - 1)) != 0) break;
+      cascade(level);
+    }
+    auto& slot = slots_[0][current_ & (kSlots - 1)];
+    if (slot.empty()) continue;
+    fired.clear();
+    fired.swap(slot);
+    for (const auto& e : fired) {
+      if (e.expiry > current_) { place(e, current_ + 1); continue; }
+      --size_;
+      on_expire(e.id);
+    }
+  }
+}
+
+std::uint64_t TimingWheel::next_expiry_hint() const {
+  if (size_ == 0) return kNoExpiry;
+  std::uint64_t window_end = current_ | (kSlots - 1);
+  for (std::uint64_t t = current_ + 1; t <= window_end; ++t) {
+    if (!slots_[0][t & (kSlots - 1)].empty()) return t;
+  }
+  // Nothing left in this window: wake when the next cascade may bring timers down.
+  return window_end + 1;
+}
+
+} // namespace wiq
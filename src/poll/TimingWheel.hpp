@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace wiq {
+
+// Hierarchical timing wheel (4 levels x 64 slots) over abstract integer ticks.
+// Level 0 resolves single ticks; each higher level covers 64x the span of the
+// one below and is cascaded down when the lower level wraps. Timers beyond the
+// top level's horizon are parked in the last slot and re-placed on cascade.
+class TimingWheel {
+public:
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+  static constexpr std::uint64_t kNoExpiry = ~std::uint64_t(0);
+
+  explicit TimingWheel(std::uint64_t start_tick = 0);
+
+  // Arm timer `id` to fire at `expiry_tick`. Ticks in the past fire on the next advance().
+  void schedule(std::uint64_t id, std::uint64_t expiry_tick);
+
+  // Move the wheel forward to `now_tick`, invoking `on_expire(id)` for every due timer.
+  void advance(std::uint64_t now_tick, const std::function<void(std::uint64_t)>& on_expire);
+
+  // Earliest tick at which advance() may fire or cascade something; kNoExpiry when empty.
+  std::uint64_t next_expiry_hint() const;
+
+  std::uint64_t current_tick() const { return current_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  struct Entry {
+    std::uint64_t id;
+    std::uint64_t expiry;
+  };
+
+  void place(const Entry& e, std::uint64_t earliest);
+  void cascade(int level);
+
+  std::vector<Entry> slots_[kLevels][kSlots];
+  std::uint64_t current_;
+  std::size_t size_{0};
+};
+
+} // namespace wiq
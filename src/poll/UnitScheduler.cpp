@@ -0,0 +1,39 @@
+#include "poll/UnitScheduler.hpp"
+#include <algorithm>
+
+namespace wiq {
+
+void UnitScheduler::push(int unit, std::uint64_t deadline, std::uint64_t id) {
+  auto& heap = units_[unit];
+  heap.push_back(Queued{deadline, seq_++, id});
+  std::push_heap(heap.begin(), heap.end(), later);
+  ++size_;
+}
+
+bool UnitScheduler::pop(Job& out) {
+  if (size_ == 0) return false;
+  std::uint64_t best = ~std::uint64_t(0);
+  for (const auto& kv : units_) best = std::min(best, kv.second.front().deadline);
+
+  // Among units tied at `best`, take the first one after the cursor, wrapping.
+  auto pick = units_.end();
+  for (auto it = units_.upper_bound(last_unit_); it != units_.end(); ++it) {
+    if (it->second.front().deadline == best) { pick = it; break; }
+  }
+  if (pick == units_.end()) {
+    for (auto it = units_.begin(); it != units_.end(); ++it) {
+      if (it->second.front().deadline == best) { pick = it; break; }
+    }
+  }
+
+  auto& heap = pick->second;
+  std::pop_heap(heap.begin(), heap.end(), later);
+  out = Job{heap.back().id, pick->first, heap.back().deadline};
+  heap.pop_back();
+  --size_;
+  last_unit_ = pick->first;
+  if (heap.empty()) units_.erase(pick);
+  return true;
+}
+
+} // namespace wiq
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace wiq {
+
+// Earliest-deadline-first dispatch over per-unit job queues.
+//
+// Every Modbus unit (slave) has its own queue ordered by deadline, then by
+// arrival. pop() serves the unit whose head job has the earliest deadline;
+// when several units' heads share that deadline they are served round-robin,
+// so one unit with many blocks cannot monopolize a shared line.
+class UnitScheduler {
+public:
+  struct Job {
+    std::uint64_t id;
+    int unit;
+    std::uint64_t deadline;  // abstract ticks, smaller is more urgent
+  };
+
+  void push(int unit, std::uint64_t deadline, std::uint64_t id);
+
+  // Remove and return the next job; false when no job is queued.
+  bool pop(Job& out);
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  struct Queued {
+    std::uint64_t deadline;
+    std::uint64_t seq;  // arrival order breaks ties within a unit
+    std::uint64_t id;
+  };
+  // Min-heap on (deadline, seq).
+  static bool later(const Queued& a, const Queued& b) {
+    return a.deadline != b.deadline ? a.deadline > b.deadline : a.seq > b.seq;
+  }
+
+  std::map<int, std::vector<Queued>> units_;  // unit id -> heap; empty units are erased
+  std::size_t size_{0};
+  std::uint64_t seq_{0};
+  int last_unit_{-1};  // round-robin cursor: the unit served last
+};
+
+} // namespace wiq
@@ -0,0 +1,58 @@
+#include "poll/WireTime.hpp"
+
+namespace wiq {
+
+namespace {
+
+double char_us_of(int baud, char parity, int data_bits, int stop_bits) {
+  const int bits = 1 + data_bits + (parity == 'N' ? 0 : 1) + stop_bits;
+  return bits * 1e6 / (baud > 0 ? baud : 9600);
+}
+
+} // namespace
+
+WireTime WireTime::for_device(const Device& dev) {
+  WireTime w;
+  if (dev.transport == "rtu") {
+    const RtuConfig& c = dev.rtu_cfg;
+    w.serial = true;
+    w.char_us = char_us_of(c.baud, c.parity, c.data_bits, c.stop_bits);
+    // Same t3.5 as the RTU client: fixed above 19200 baud.
+    if (c.frame_silence_ms > 0) w.gap_us = c.frame_silence_ms * 1000.0;
+    else w.gap_us = c.baud > 19200 ? 1750.0 : 3.5 * w.char_us;
+  } else if (dev.transport == "ascii") {
+    const AsciiConfig& c = dev.ascii_cfg;
+    w.serial = true;
+    w.ascii = true;
+    w.char_us = char_us_of(c.baud, c.parity, c.data_bits, c.stop_bits);
+    w.gap_us = c.frame_silence_ms * 1000.0;
+  }
+  return w;
+}
+
+double WireTime::frame_us(int pdu_bytes) const {
+  // Address + PDU + CRC (RTU) or LRC (ASCII).
+  const int bytes = 1 + pdu_bytes + (ascii ? 1 : 2);
+  const int chars = ascii ? 1 + 2 * bytes + 2 : bytes;
+  return gap_us + chars * char_us;
+}
+
+double WireTime::read_us(int function, int count) const {
+  if (!serial) return 0;
+  const int data = (function == 1 || function == 2) ? (count + 7) / 8 : 2 * count;
+  return frame_us(5) + frame_us(2 + data);
+}
+
+int WireTime::max_read_count(int function, double budget_us, int limit) const {
+  if (!serial || budget_us <= 0) return limit;
+  int lo = 1;
+  int hi = limit;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo + 1) / 2;
+    if (read_us(function, mid) <= budget_us) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+} // namespace wiq
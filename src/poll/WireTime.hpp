@@ -0,0 +1,30 @@
+#pragma once
+
+#include "IoContext.hpp"
+
+namespace wiq {
+
+// Bus occupancy of Modbus transactions on a device's serial line, derived
+// from its baud rate and framing. TCP devices are not limited by a shared
+// line and get an empty model (`serial` false, every estimate 0).
+struct WireTime {
+  bool serial{false};
+  bool ascii{false};    // two characters per byte plus ':' and CRLF
+  double char_us{0};    // one character: start + data + parity + stop bits
+  double gap_us{0};     // silence kept before each frame
+
+  static WireTime for_device(const Device& dev);
+
+  // Request plus response of one read of `count` bits or registers,
+  // including the silence before each frame.
+  double read_us(int function, int count) const;
+
+  // Largest count, at most `limit`, whose read fits in `budget_us`; at least
+  // 1 even when a single item does not fit.
+  int max_read_count(int function, double budget_us, int limit) const;
+
+private:
+  double frame_us(int pdu_bytes) const;
+};
+
+} // namespace wiq
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace wiq {
+
+// Groups identical requests that overlap in time. The first caller for a
+// key leads a flight and does the work; later callers for the same key join
+// it as waiters until the leader completes it, so N overlapping requests
+// cost one operation.
+//
+// Only the bookkeeping lives here. It is not synchronised: callers guard it
+// with their own lock and decide how waiters learn the result (a condition
+// variable, a reply queue). forget() detaches every flight in progress, for
+// example after a write: later callers start new flights, and the detached
+// ones still complete the waiters they already have.
+template <class Key, class Waiter, class Hash = std::hash<Key>>
+class Singleflight {
+public:
+  class Flight {
+  public:
+    // False once forget() detached the flight; its result may be stale.
+    bool current() const { return current_; }
+
+  private:
+    friend class Singleflight;
+    std::vector<Waiter> waiters_;
+    bool current_{true};
+  };
+  using Ticket = std::shared_ptr<Flight>;
+
+  // Add `w` to the flight of `key`. Returns the flight if this call started
+  // it, and the caller must do the work and complete() it; null if `w`
+  // joined a flight already in progress.
+  Ticket join(const Key& key, Waiter w) {
+    Ticket& slot = flights_[key];
+    if (slot) {
+      slot->waiters_.push_back(std::move(w));
+      return nullptr;
+    }
+    slot = std::make_shared<Flight>();
+    slot->waiters_.push_back(std::move(w));
+    return slot;
+  }
+
+  // Add `w` to the flight of `key` if one is in progress; false, starting
+  // nothing, if there is none.
+  bool attach(const Key& key, Waiter w) {
+    auto it = flights_.find(key);
+    if (it == flights_.end()) return false;
+    it->second->waiters_.push_back(std::move(w));
+    return true;
+  }
+
+  // End the flight `t` of `key`; returns its waiters, the leader first.
+  std::vector<Waiter> complete(const Key& key, const Ticket& t) {
+    auto it = flights_.find(key);
+    if (it != flights_.end() && it->second == t) flights_.erase(it);
+    return std::move(t->waiters_);
+  }
+
+  void forget() {
+    for (auto& kv : flights_) kv.second->current_ = false;
+    flights_.clear();
+  }
+
+  std::size_t size() const { return flights_.size(); }
+
+private:
+  std::unordered_map<Key, Ticket, Hash> flights_;
+};
+
+} // namespace wiq
@@ -1,3 +1,7 @@
+#if !defined(_WIN32)
+#include "../support/pty_modbus_slave.hpp"
+#endif
+
 #include <cstdio>
 #include <cstring>
 #include <fstream>
@@ -14,14 +18,23 @@ extern "C" {
   int      CallMethod(IoHandle h, const char* method, const char* paramsJson, /*out*/char* outBuf, int outSize);
 }
 
-static std::string writeAsciiConfig(const std::string& filename) {
-  const char* json = R"JSON({
+// The ASCII client talks to a simulated slave on a pseudo-terminal. Ptys
+// only carry 8N1, hence the line settings. Windows has no pty and no serial
+// client yet, so it runs the same sequence against the in-memory stub.
+static std::string writeAsciiConfig(const std::string& filename, const std::string& port) {
+#if defined(_WIN32)
+  const char* backend = "stub";
+#else
+  const char* backend = "serial";
+#endif
+  const std::string json = std::string(R"JSON({
     "transport": "ascii",
     "ascii": {
-      "port": "/dev/ttyS10",
+      "port": ")JSON") + port + R"JSON(",
+      "backend": ")JSON" + backend + R"JSON(",
       "baud": 9600,
-      "parity": "E",
-      "data_bits": 7,
+      "parity": "N",
+      "data_bits": 8,
       "stop_bits": 1,
       "timeout_ms": 1200,
       "lrc_check": true,
@@ -48,7 +61,13 @@ static bool fileExists(const std::string& path) {
 }
 
 int main() {
-  const std::string cfgPath = writeAsciiConfig("test_ascii_config.json");
+#if defined(_WIN32)
+  const std::string port = "COM10";
+#else
+  PtyModbusSlave slave(PtyModbusSlave::Framing::Ascii);
+  const std::string port = slave.path();
+#endif
+  const std::string cfgPath = writeAsciiConfig("test_ascii_config.json", port);
   if (!fileExists(cfgPath)) {
     std::fprintf(stderr, "Failed to write config %s\n", cfgPath.c_str());
     return 1;
@@ -110,6 +129,17 @@ int main() {
 
   std::printf("ASCII diagnostics: %s\n", diagBuf);
 
+#if !defined(_WIN32)
+  // The broadcast got no reply; the slave must still have executed it.
+  for (int i = 0; i < 50 && slave.reg(10) != 123; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (slave.reg(10) != 123 || slave.reg(11) != 456) {
+    std::fprintf(stderr, "broadcast not applied by the slave\n");
+    UnsubscribeItems(h, items, 2);
+    DestroyIoInstance(h);
+    return 9;
+  }
+#endif
+
   UnsubscribeItems(h, items, 2);
   DestroyIoInstance(h);
   std::remove(cfgPath.c_str());
@@ -0,0 +1,224 @@
+#pragma once
+
+// Minimal single-connection Modbus TCP server on 127.0.0.1 for tests and
+// benchmarks (POSIX only). Serves 1000 coils and 1000 holding registers for
+// FC1/2/3/4/5/6/15/16 and answers out-of-range requests with exception 2.
+// Reads of holding register `delay_addr` are answered only after `delay_ms`,
+// which lets tests provoke client timeouts and late replies. Requests keep
+// being read while replies are pending, so pipelined clients can have several
+// in flight; `set_latency` adds a fixed delay to every reply to model a
+// long round trip.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+class LoopbackModbusServer {
+public:
+  static constexpr int kSize = 1000;
+
+  LoopbackModbusServer() : coils_(kSize, 0), regs_(kSize, 0), reads_(kSize, 0) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    a.sin_port = 0;
+    ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&a), sizeof(a));
+    socklen_t len = sizeof(a);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&a), &len);
+    port_ = ntohs(a.sin_port);
+    ::listen(listen_fd_, 4);
+    thread_ = std::thread([this] { run(); });
+  }
+
+  ~LoopbackModbusServer() {
+    stop_ = true;
+    thread_.join();
+    ::close(listen_fd_);
+  }
+
+  int port() const { return port_; }
+  int requests() const { return requests_.load(); }
+  int connections() const { return connections_.load(); }
+
+  void set_reg(int addr, std::uint16_t v) { std::lock_guard<std::mutex> lk(mu_); regs_[addr] = v; }
+  // Set consecutive registers as one update; no response sees half of it.
+  void set_regs(int addr, const std::vector<std::uint16_t>& v) {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::copy(v.begin(), v.end(), regs_.begin() + addr);
+  }
+  void set_coil(int addr, bool on) { std::lock_guard<std::mutex> lk(mu_); coils_[addr] = on ? 1 : 0; }
+  std::uint16_t reg(int addr) { std::lock_guard<std::mutex> lk(mu_); return regs_[addr]; }
+  // FC3/FC4 reads starting at `addr` so far.
+  int reads(int addr) { std::lock_guard<std::mutex> lk(mu_); return reads_[addr]; }
+  void set_delay(int addr, int ms) { delay_addr_ = addr; delay_ms_ = ms; }
+  void set_latency(int ms) { latency_ms_ = ms; }
+  // Close the current connection after replying to the next request.
+  void drop_after_reply() { drop_ = true; }
+
+private:
+  static int u16(const std::uint8_t* p) { return (p[0] << 8) | p[1]; }
+  static void put16(std::vector<std::uint8_t>& v, int x) {
+    v.push_back(static_cast<std::uint8_t>(x >> 8));
+    v.push_back(static_cast<std::uint8_t>(x & 0xFF));
+  }
+
+  bool wait_readable(int fd) {
+    while (!stop_) {
+      pollfd p{fd, POLLIN, 0};
+      int r = ::poll(&p, 1, 20);
+      if (r > 0) return true;
+    }
+    return false;
+  }
+
+  bool read_exact(int fd, std::uint8_t* p, int n) {
+    int got = 0;
+    while (got < n) {
+      if (!wait_readable(fd)) return false;
+      ssize_t r = ::recv(fd, p + got, n - got, 0);
+      if (r <= 0) return false;
+      got += static_cast<int>(r);
+    }
+    return true;
+  }
+
+  void run() {
+    while (!stop_) {
+      if (!wait_readable(listen_fd_)) break;
+      int fd = ::accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) continue;
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      connections_ += 1;
+      serve(fd);
+      ::close(fd);
+    }
+  }
+
+  struct Reply {
+    std::chrono::steady_clock::time_point due;
+    std::vector<std::uint8_t> bytes;
+    bool drop{false};
+  };
+
+  void serve(int fd) {
+    using clock = std::chrono::steady_clock;
+    std::uint8_t hdr[7];
+    std::uint8_t pdu[260];
+    std::deque<Reply> pending;  // ordered by due time
+    while (!stop_) {
+      int wait_ms = 20;
+      if (!pending.empty()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(pending.front().due - clock::now()).count();
+        wait_ms = left < 0 ? 0 : (left < 20 ? static_cast<int>(left) : 20);
+      }
+      pollfd p{fd, POLLIN, 0};
+      if (::poll(&p, 1, wait_ms) > 0) {
+        if (!read_exact(fd, hdr, 7)) return;
+        int len = u16(hdr + 4);
+        if (len < 2 || len > 254 || !read_exact(fd, pdu, len - 1)) return;
+        requests_ += 1;
+        std::vector<std::uint8_t> rsp = handle(pdu, len - 1);
+        Reply r;
+        r.bytes.assign(hdr, hdr + 4);
+        put16(r.bytes, static_cast<int>(rsp.size()) + 1);
+        r.bytes.push_back(hdr[6]);
+        r.bytes.insert(r.bytes.end(), rsp.begin(), rsp.end());
+        int delay = latency_ms_.load();
+        if (pdu[0] == 3 && u16(pdu + 1) == delay_addr_.load()) delay += delay_ms_.load();
+        r.due = clock::now() + std::chrono::milliseconds(delay);
+        r.drop = drop_.exchange(false);
+        auto at = pending.end();
+        while (at != pending.begin() && (at - 1)->due > r.due) --at;
+        pending.insert(at, std::move(r));
+      }
+      while (!pending.empty() && pending.front().due <= clock::now()) {
+        const std::vector<std::uint8_t>& out = pending.front().bytes;
+        if (::send(fd, out.data(), out.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(out.size())) return;
+        if (pending.front().drop) return;
+        pending.pop_front();
+      }
+    }
+  }
+
+  std::vector<std::uint8_t> handle(const std::uint8_t* pdu, int n) {
+    std::lock_guard<std::mutex> lk(mu_);
+    const std::uint8_t fc = pdu[0];
+    std::vector<std::uint8_t> r{fc};
+    auto exception = [&](std::uint8_t code) { return std::vector<std::uint8_t>{static_cast<std::uint8_t>(fc | 0x80), code}; };
+    if (n < 5) return exception(3);
+    const int addr = u16(pdu + 1);
+    const int qty = u16(pdu + 3);
+    switch (fc) {
+      case 1: case 2: {
+        if (addr + qty > kSize) return exception(2);
+        r.push_back(static_cast<std::uint8_t>((qty + 7) / 8));
+        for (int i = 0; i < (qty + 7) / 8; ++i) {
+          std::uint8_t b = 0;
+          for (int k = 0; k < 8 && i * 8 + k < qty; ++k) if (coils_[addr + i * 8 + k]) b |= 1 << k;
+          r.push_back(b);
+        }
+        return r;
+      }
+      case 3: case 4: {
+        if (addr + qty > kSize) return exception(2);
+        reads_[addr] += 1;
+        r.push_back(static_cast<std::uint8_t>(qty * 2));
+        for (int i = 0; i < qty; ++i) put16(r, regs_[addr + i]);
+        return r;
+      }
+      case 5:
+        if (addr >= kSize) return exception(2);
+        coils_[addr] = (qty == 0xFF00) ? 1 : 0;
+        return std::vector<std::uint8_t>(pdu, pdu + 5);
+      case 6:
+        if (addr >= kSize) return exception(2);
+        regs_[addr] = static_cast<std::uint16_t>(qty);
+        return std::vector<std::uint8_t>(pdu, pdu + 5);
+      case 15:
+        if (addr + qty > kSize) return exception(2);
+        for (int i = 0; i < qty; ++i) coils_[addr + i] = (pdu[6 + i / 8] >> (i % 8)) & 1;
+        return std::vector<std::uint8_t>(pdu, pdu + 5);
+      case 16:
+        if (addr + qty > kSize) return exception(2);
+        for (int i = 0; i < qty; ++i) regs_[addr + i] = static_cast<std::uint16_t>(u16(pdu + 6 + 2 * i));
+        return std::vector<std::uint8_t>(pdu, pdu + 5);
+      default:
+        return exception(1);
+    }
+  }
+
+  int listen_fd_{-1};
+  int port_{0};
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> drop_{false};
+  std::atomic<int> delay_addr_{-1};
+  std::atomic<int> delay_ms_{0};
+  std::atomic<int> latency_ms_{0};
+  std::atomic<int> requests_{0};
+  std::atomic<int> connections_{0};
+  std::mutex mu_;
+  std::vector<std::uint8_t> coils_;
+  std::vector<std::uint16_t> regs_;
+  std::vector<int> reads_;
+  std::thread thread_;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+// Modbus RTU or ASCII slave on the master side of a pseudo-terminal for tests
+// (POSIX only). Clients open `path()` like a serial port. Serves 100 coils
+// and 100 registers (FC3 and FC4 read the same table) for
+// FC1/2/3/4/5/6/15/16 at unit 1, answers out-of-range requests with exception
+// 2 and executes broadcasts (unit 0) without replying. CRC and hex are
+// computed the slow, obvious way, as a cross-check of the clients' table
+// driven ones. `fault_next` damages the next reply to exercise the client's
+// framing and error paths.
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PtyModbusSlave {
+public:
+  static constexpr int kSize = 100;
+
+  enum class Framing { Rtu, Ascii };
+
+  enum class Fault {
+    None,
+    BadCheck,   // flip a bit of the CRC/LRC
+    Silent,     // do not answer
+    WrongUnit,  // answer with another slave address
+    Split,      // pause 5 ms in the middle of the frame
+    LongGap,    // pause 100 ms in the middle of the frame
+    Noise,      // send line noise before the frame (ASCII)
+  };
+
+  explicit PtyModbusSlave(Framing framing = Framing::Rtu)
+  : framing_(framing), coils_(kSize, 0), regs_(kSize, 0) {
+    master_ = ::posix_openpt(O_RDWR | O_NOCTTY);
+    ::grantpt(master_);
+    ::unlockpt(master_);
+    path_ = ::ptsname(master_);
+    // Keep the slave side open so the master does not see a hangup between
+    // client connections, and put it in raw mode before anything is sent.
+    keepalive_ = ::open(path_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    termios tio;
+    ::tcgetattr(keepalive_, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(keepalive_, TCSANOW, &tio);
+    ::fcntl(master_, F_SETFL, ::fcntl(master_, F_GETFL, 0) | O_NONBLOCK);
+    thread_ = std::thread([this] { run(); });
+  }
+
+  ~PtyModbusSlave() {
+    stop_ = true;
+    thread_.join();
+    if (master_ >= 0) ::close(master_);
+    ::close(keepalive_);
+  }
+
+  const std::string& path() const { return path_; }
+  int requests() const { return requests_.load(); }
+
+  void set_reg(int addr, std::uint16_t v) { std::lock_guard<std::mutex> lk(mu_); regs_[addr] = v; }
+  std::uint16_t reg(int addr) { std::lock_guard<std::mutex> lk(mu_); return regs_[addr]; }
+  void fault_next(Fault f) { fault_ = static_cast<int>(f); }
+  // Processing time before each reply, to keep the line busy.
+  void set_delay_ms(int ms) { delay_ms_ = ms; }
+  // Close the master side, as if the adapter had been unplugged.
+  void hang_up() {
+    hangup_ = true;
+    while (hangup_) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  static std::uint16_t crc16(const std::uint8_t* p, std::size_t n) {
+    std::uint16_t crc = 0xFFFF;
+    for (std::size_t i = 0; i < n; ++i) {
+      crc ^= p[i];
+      for (int b = 0; b < 8; ++b) crc = (crc & 1) ? static_cast<std::uint16_t>((crc >> 1) ^ 0xA001) : static_cast<std::uint16_t>(crc >> 1);
+    }
+    return crc;
+  }
+
+  static std::uint8_t lrc(const std::uint8_t* p, std::size_t n) {
+    unsigned sum = 0;
+    for (std::size_t i = 0; i < n; ++i) sum += p[i];
+    return static_cast<std::uint8_t>(-static_cast<int>(sum & 0xFF));
+  }
+
+private:
+  static int u16(const std::uint8_t* p) { return (p[0] << 8) | p[1]; }
+  static void put16(std::vector<std::uint8_t>& v, int x) {
+    v.push_back(static_cast<std::uint8_t>(x >> 8));
+    v.push_back(static_cast<std::uint8_t>(x & 0xFF));
+  }
+
+  // Expected request length once the first 7 bytes are known; 0 if unknown.
+  static std::size_t request_len(const std::vector<std::uint8_t>& b) {
+    if (b.size() < 2) return 0;
+    const int fc = b[1];
+    if (fc >= 1 && fc <= 6) return 8;
+    if ((fc == 15 || fc == 16) && b.size() >= 7) return 9 + b[6];
+    return 0;
+  }
+
+  void run() {
+    std::vector<std::uint8_t> buf;
+    while (!stop_) {
+      if (hangup_) {
+        if (master_ >= 0) { ::close(master_); master_ = -1; }
+        hangup_ = false;
+      }
+      const int fd = master_;
+      if (fd < 0) { std::this_thread::sleep_for(std::chrono::milliseconds(5)); continue; }
+      pollfd p{fd, POLLIN, 0};
+      if (::poll(&p, 1, 20) <= 0 || !(p.revents & POLLIN)) continue;
+      std::uint8_t tmp[256];
+      ssize_t r = ::read(fd, tmp, sizeof(tmp));
+      if (r <= 0) continue;
+      buf.insert(buf.end(), tmp, tmp + r);
+      std::vector<std::uint8_t> frame;
+      while (framing_ == Framing::Rtu ? next_rtu(buf, frame) : next_ascii(buf, frame)) {
+        ++requests_;
+        serve(fd, frame);
+      }
+    }
+  }
+
+  // Take the next CRC-checked RTU request (address + PDU) off `buf`.
+  static bool next_rtu(std::vector<std::uint8_t>& buf, std::vector<std::uint8_t>& frame) {
+    if (buf.size() >= 2 && buf[1] != 1 && buf[1] != 2 && buf[1] != 3 && buf[1] != 4 && buf[1] != 5 &&
+        buf[1] != 6 && buf[1] != 15 && buf[1] != 16) {
+      buf.clear();
+      return false;
+    }
+    const std::size_t need = request_len(buf);
+    if (need == 0 || buf.size() < need) return false;
+    frame.assign(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(need));
+    buf.erase(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(need));
+    const std::uint16_t crc = crc16(frame.data(), need - 2);
+    if (frame[need - 2] != (crc & 0xFF) || frame[need - 1] != (crc >> 8)) { buf.clear(); return false; }
+    frame.resize(need - 2);
+    return true;
+  }
+
+  // Take the next LRC-checked ASCII request (address + PDU) off `buf`.
+  static bool next_ascii(std::vector<std::uint8_t>& buf, std::vector<std::uint8_t>& frame) {
+    for (;;) {
+      auto start = std::find(buf.begin(), buf.end(), ':');
+      buf.erase(buf.begin(), start);
+      auto lf = std::find(buf.begin(), buf.end(), '\n');
+      if (buf.empty() || lf == buf.end()) return false;
+      std::string hex(buf.begin() + 1, lf);
+      buf.erase(buf.begin(), lf + 1);
+      if (hex.empty() || hex.back() != '\r' || hex.size() % 2 != 1) continue;
+      hex.pop_back();
+      frame.clear();
+      for (std::size_t i = 0; i < hex.size(); i += 2) {
+        frame.push_back(static_cast<std::uint8_t>(std::strtoul(hex.substr(i, 2).c_str(), nullptr, 16)));
+      }
+      if (frame.size() < 3 || lrc(frame.data(), frame.size() - 1) != frame.back()) continue;
+      frame.pop_back();
+      return true;
+    }
+  }
+
+  void serve(int fd, const std::vector<std::uint8_t>& req) {
+    const int unit = req[0];
+    if (unit != 0 && unit != 1) return;
+    std::vector<std::uint8_t> pdu = execute(req.data() + 1);
+    if (unit == 0) return;
+    if (delay_ms_ > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_.load()));
+    const Fault fault = static_cast<Fault>(fault_.exchange(static_cast<int>(Fault::None)));
+    if (fault == Fault::Silent) return;
+    std::vector<std::uint8_t> adu;
+    adu.push_back(static_cast<std::uint8_t>(fault == Fault::WrongUnit ? 2 : unit));
+    adu.insert(adu.end(), pdu.begin(), pdu.end());
+    std::vector<std::uint8_t> wire;
+    if (framing_ == Framing::Rtu) {
+      const std::uint16_t crc = crc16(adu.data(), adu.size());
+      adu.push_back(static_cast<std::uint8_t>(crc & 0xFF));
+      adu.push_back(static_cast<std::uint8_t>(crc >> 8));
+      if (fault == Fault::BadCheck) adu.back() ^= 0x01;
+      wire = adu;
+    } else {
+      adu.push_back(lrc(adu.data(), adu.size()));
+      if (fault == Fault::BadCheck) adu.back() ^= 0x01;
+      if (fault == Fault::Noise) wire.assign({'\r', '\n', 0x7F, 'x', '1'});
+      wire.push_back(':');
+      char hex[3];
+      for (std::uint8_t b : adu) {
+        std::snprintf(hex, sizeof(hex), "%02X", b);
+        wire.push_back(static_cast<std::uint8_t>(hex[0]));
+        wire.push_back(static_cast<std::uint8_t>(hex[1]));
+      }
+      wire.push_back('\r');
+      wire.push_back('\n');
+    }
+    if (fault == Fault::Split || fault == Fault::LongGap) {
+      (void)::write(fd, wire.data(), 3);
+      std::this_thread::sleep_for(std::chrono::milliseconds(fault == Fault::Split ? 5 : 100));
+      (void)::write(fd, wire.data() + 3, wire.size() - 3);
+      return;
+    }
+    (void)::write(fd, wire.data(), wire.size());
+  }
+
+  std::vector<std::uint8_t> execute(const std::uint8_t* req) {
+    std::vector<std::uint8_t> rsp;
+    const int fc = req[0];
+    const int addr = u16(req + 1);
+    const int val = u16(req + 3);
+    std::lock_guard<std::mutex> lk(mu_);
+    auto exception = [&](int code) {
+      rsp.assign({static_cast<std::uint8_t>(fc | 0x80), static_cast<std::uint8_t>(code)});
+      return rsp;
+    };
+    switch (fc) {
+      case 1: case 2: {
+        if (addr + val > kSize) return exception(2);
+        rsp.push_back(static_cast<std::uint8_t>(fc));
+        rsp.push_back(static_cast<std::uint8_t>((val + 7) / 8));
+        for (int i = 0; i < (val + 7) / 8; ++i) {
+          std::uint8_t b = 0;
+          for (int j = 0; j < 8 && i * 8 + j < val; ++j) if (coils_[addr + i * 8 + j]) b |= static_cast<std::uint8_t>(1u << j);
+          rsp.push_back(b);
+        }
+        return rsp;
+      }
+      case 3: case 4: {
+        if (addr + val > kSize) return exception(2);
+        rsp.push_back(static_cast<std::uint8_t>(fc));
+        rsp.push_back(static_cast<std::uint8_t>(val * 2));
+        for (int i = 0; i < val; ++i) put16(rsp, regs_[addr + i]);
+        return rsp;
+      }
+      case 5: case 6:
+        if (addr >= kSize) return exception(2);
+        if (fc == 5) coils_[addr] = val == 0xFF00 ? 1 : 0;
+        else regs_[addr] = static_cast<std::uint16_t>(val);
+        rsp.assign(req, req + 5);
+        return rsp;
+      case 15:
+        if (addr + val > kSize) return exception(2);
+        for (int i = 0; i < val; ++i) coils_[addr + i] = (req[6 + i / 8] >> (i % 8)) & 1;
+        rsp.assign(req, req + 5);
+        return rsp;
+      case 16:
+        if (addr + val > kSize) return exception(2);
+        for (int i = 0; i < val; ++i) regs_[addr + i] = static_cast<std::uint16_t>(u16(req + 6 + 2 * i));
+        rsp.assign(req, req + 5);
+        return rsp;
+      default:
+        return exception(1);
+    }
+  }
+
+  Framing framing_;
+  std::mutex mu_;
+  std::vector<std::uint8_t> coils_;
+  std::vector<std::uint16_t> regs_;
+  std::string path_;
+  int master_{-1};
+  int keepalive_{-1};
+  std::atomic<int> fault_{0};
+  std::atomic<int> requests_{0};
+  std::atomic<int> delay_ms_{0};
+  std::atomic<bool> hangup_{false};
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
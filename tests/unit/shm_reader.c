@@ -0,0 +1,15 @@
+/* Plain C consumer of include/ModbusShm.h, as another local process would
+ * use it; test_shm_export calls it from a forked child. */
+#include "ModbusShm.h"
+
+/* Copy the raw slots of `item` from the object `name`. Returns the slot
+ * count, 0 if not polled yet, a negative value on any error. */
+int shm_reader_read_item(const char* name, const char* item, uint16_t* out, uint32_t max, uint64_t* generation) {
+  wiq_shm_view v;
+  if (wiq_shm_open(name, &v) != 0) return -1;
+  int n = -1;
+  const wiq_shm_item* it = wiq_shm_find_item(&v, item);
+  if (it && wiq_shm_alive(&v)) n = wiq_shm_read_segment(&v, it->segment, out, max, generation, NULL);
+  wiq_shm_close(&v);
+  return n;
+}
@@ -0,0 +1,106 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      UnsubscribeItems(IoHandle h, const char** names, int count);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json call(IoHandle h, const char* method) {
+  char buf[4096] = {0};
+  assert(CallMethod(h, method, "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+static int effective_ms(IoHandle h, const std::string& name) {
+  const nlohmann::json rates = call(h, "poll.rates");
+  for (const auto& it : rates["items"]) {
+    if (it["name"] == name) return it["effective_ms"].get<int>();
+  }
+  return -1;
+}
+
+// Wait up to `limit_ms` for `name` to run at `want` ms.
+static bool reaches(IoHandle h, const std::string& name, int want, int limit_ms) {
+  for (int waited = 0; waited < limit_ms; waited += 5) {
+    if (effective_ms(h, name) == want) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return false;
+}
+
+int main() {
+  write_text("unit_adaptive_poll.json", R"JSON({
+    "transport": "tcp",
+    "tcp": { "backend": "stub" },
+    "items": [
+      { "name": "hr.set",   "unit_id": 1, "function": 3, "address": 10, "type": "uint16", "poll_ms": 10,
+        "adaptive": { "max_poll_ms": 80, "stable_polls": 3 } },
+      { "name": "hr.recipe", "unit_id": 1, "function": 3, "address": 11, "type": "uint16", "poll_ms": 10,
+        "adaptive": { "max_poll_ms": 40, "stable_polls": 3, "change_polls": 2 } },
+      { "name": "hr.fixed", "unit_id": 1, "function": 3, "address": 12, "type": "uint16", "poll_ms": 10 },
+      { "name": "w.set",    "unit_id": 1, "function": 6, "address": 10, "type": "uint16" },
+      { "name": "w.recipe", "unit_id": 1, "function": 6, "address": 11, "type": "uint16" }
+    ]
+  })JSON");
+  IoHandle h = CreateIoInstance(nullptr, "unit_adaptive_poll.json");
+  assert(h != nullptr);
+  const char* names[] = {"hr.set", "hr.recipe", "hr.fixed"};
+  assert(SubscribeItems(h, names, 3) == 0);
+  assert(effective_ms(h, "hr.set") == 10);
+
+  // Values hold still: the adaptive items double their period up to the cap,
+  // the fixed item keeps its rate.
+  assert(reaches(h, "hr.set", 80, 3000));
+  assert(reaches(h, "hr.recipe", 40, 3000));
+  assert(effective_ms(h, "hr.fixed") == 10);
+  nlohmann::json c = call(h, "diagnostics.snapshot")["counters"];
+  assert(c["adaptive_slowdowns"].get<int>() == 5);  // 10->20->40->80 and 10->20->40
+  assert(c["adaptive_speedups"].get<int>() == 0);
+
+  // A change snaps hr.set back to its poll_ms.
+  assert(WriteItem(h, "w.set", "7") == 0);
+  assert(reaches(h, "hr.set", 10, 1000));
+  assert(call(h, "diagnostics.snapshot")["counters"]["adaptive_speedups"].get<int>() == 1);
+
+  // hr.recipe needs two changes without a stable run in between.
+  assert(WriteItem(h, "w.recipe", "1") == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));  // sampled once, not three times
+  assert(effective_ms(h, "hr.recipe") == 40);
+  assert(WriteItem(h, "w.recipe", "2") == 0);
+  assert(reaches(h, "hr.recipe", 10, 1000));
+
+  // Resubscribing starts again from poll_ms.
+  assert(reaches(h, "hr.set", 80, 3000));
+  const char* one[] = {"hr.set"};
+  assert(UnsubscribeItems(h, one, 1) == 0);
+  assert(effective_ms(h, "hr.set") == -1);
+  assert(SubscribeItems(h, one, 1) == 0);
+  assert(effective_ms(h, "hr.set") == 10);
+  DestroyIoInstance(h);
+
+  // adaptive needs poll_ms and a larger max_poll_ms.
+  write_text("unit_adaptive_poll_bad.json", R"JSON({ "transport": "tcp", "items": [
+    { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 100,
+      "adaptive": { "max_poll_ms": 100 } } ] })JSON");
+  assert(CreateIoInstance(nullptr, "unit_adaptive_poll_bad.json") == nullptr);
+
+  std::puts("unit_adaptive_poll: ok");
+  return 0;
+}
@@ -20,7 +20,7 @@ int main() {
   // Define a 3-coil window starting at address 20; write with FC15, read with FC1 count=3
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "coils.win.write", "unit_id": 1, "function": 15, "address": 20, "count": 3, "type": "bool" },
       { "name": "coils.win.read",  "unit_id": 1, "function": 1,  "address": 20, "count": 3, "type": "bool" }
@@ -19,7 +19,7 @@ static void write_text(const char* path, const std::string& s) {
 int main() {
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "dbl.w", "unit_id": 1, "function": 16, "address": 110, "count": 4, "type": "double", "word_order": "DCBA" },
       { "name": "dbl.r", "unit_id": 1, "function": 3,  "address": 110, "count": 4, "type": "double", "word_order": "DCBA" }
@@ -18,7 +18,7 @@ static void write_text(const char* path, const std::string& s) {
 int main() {
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "di.single", "unit_id": 1, "function": 2, "address": 0,  "type": "bool" },
       { "name": "di.array",  "unit_id": 1, "function": 2, "address": 10, "count": 3, "type": "bool" }
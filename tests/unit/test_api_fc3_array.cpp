@@ -20,7 +20,7 @@ int main() {
   // We will write 3 holding registers via FC16 array and then read via FC3 array
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "hr.write", "unit_id": 1, "function": 16, "address": 30, "count": 3, "type": "uint16" },
       { "name": "hr.read",  "unit_id": 1, "function": 3,  "address": 30, "count": 3, "type": "uint16" }
@@ -19,7 +19,7 @@ int main() {
   // Read an array of 3 input registers; stub defaults to 0 => expect [0,0,0]
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "ir.read",  "unit_id": 1, "function": 4,  "address": 70, "count": 3, "type": "uint16" }
     ]
@@ -19,7 +19,7 @@ int main() {
   // Read 2 input registers; stub defaults to 0 => expect [0,0] (ensure not parsed as float)
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "ir.read2",  "unit_id": 1, "function": 4,  "address": 72, "count": 2, "type": "uint16" }
     ]
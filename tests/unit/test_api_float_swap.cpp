@@ -22,7 +22,7 @@ int main() {
   // swap_words=true exercises word order handling
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "f.hold",       "unit_id": 1, "function": 16, "address": 50, "count": 2, "type": "float", "swap_words": true },
       { "name": "f.hold.read",  "unit_id": 1, "function": 3,  "address": 50, "count": 2, "type": "float", "swap_words": true }
@@ -19,7 +19,7 @@ static void write_text(const char* path, const std::string& s) {
 int main() {
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "hr.min", "unit_id": 1, "function": 6, "address": 0, "type": "int16", "scale": 1.0, "offset": 0.0 },
       { "name": "hr.min.r", "unit_id": 1, "function": 3, "address": 0, "type": "int16", "scale": 1.0, "offset": 0.0 },
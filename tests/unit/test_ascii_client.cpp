@@ -0,0 +1,135 @@
+#include "AsciiModbusClient.hpp"
+#include "ModbusError.hpp"
+#include "../support/pty_modbus_slave.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+int main() {
+  using wiq::ModbusErr;
+  using clock = std::chrono::steady_clock;
+  using Fault = PtyModbusSlave::Fault;
+  PtyModbusSlave slave(PtyModbusSlave::Framing::Ascii);
+
+  wiq::AsciiConfig cfg;
+  cfg.port = slave.path();
+  cfg.parity = 'N';  // pseudo-terminals only carry 8N1
+  cfg.data_bits = 8;
+  cfg.timeout_ms = 1000;
+  cfg.frame_silence_ms = 1;
+  auto c = wiq::make_ascii_client(cfg);
+  assert(c->connect() == 0);
+
+  // Writes and reads of every function code; the slave decodes the hex and
+  // checks the LRC independently.
+  assert(c->write_single_reg(1, 5, 0xBEEF) == 0);
+  std::uint16_t regs[8] = {0};
+  auto t0 = clock::now();
+  assert(c->read_holding_regs(1, 5, 1, regs) == 0 && regs[0] == 0xBEEF);
+  assert(clock::now() - t0 < std::chrono::milliseconds(100));  // returns on LF, not on timeout
+  std::uint16_t vals[4] = {0x0102, 0xA0B0, 0x00FF, 0xFFFF};
+  assert(c->write_multiple_regs(1, 20, 4, vals) == 0);
+  assert(c->read_input_regs(1, 20, 4, regs) == 0);
+  assert(regs[0] == 0x0102 && regs[1] == 0xA0B0 && regs[2] == 0x00FF && regs[3] == 0xFFFF);
+  std::uint8_t bits_in[10] = {1, 0, 1, 1, 0, 0, 0, 1, 1, 0};
+  assert(c->write_multiple_coils(1, 30, 10, bits_in) == 0);
+  assert(c->write_single_coil(1, 31, true) == 0);
+  std::uint8_t bits[10] = {0};
+  assert(c->read_coils(1, 30, 10, bits) == 0);
+  assert(bits[0] == 1 && bits[1] == 1 && bits[7] == 1 && bits[8] == 1 && bits[9] == 0);
+  assert(c->read_discrete_inputs(1, 30, 2, bits) == 0 && bits[0] == 1 && bits[1] == 1);
+
+  // Exception responses are decoded.
+  assert(c->read_holding_regs(1, 99, 5, regs) == wiq::make_modbus_exception(2));
+
+  // A wrong LRC is reported and the next request works again.
+  slave.fault_next(Fault::BadCheck);
+  assert(c->read_holding_regs(1, 5, 1, regs) == static_cast<int>(ModbusErr::LRC_ERROR));
+  assert(c->read_holding_regs(1, 5, 1, regs) == 0 && regs[0] == 0xBEEF);
+
+  // Noise before ':' is skipped; ASCII tolerates pauses inside a frame.
+  slave.fault_next(Fault::Noise);
+  assert(c->read_holding_regs(1, 20, 2, regs) == 0 && regs[1] == 0xA0B0);
+  slave.fault_next(Fault::Split);
+  assert(c->read_holding_regs(1, 20, 2, regs) == 0 && regs[0] == 0x0102);
+  slave.fault_next(Fault::LongGap);
+  assert(c->read_holding_regs(1, 20, 2, regs) == 0 && regs[0] == 0x0102);
+
+  // No response: IO_TIMEOUT after the configured timeout.
+  c->set_timeout_ms(200);
+  slave.fault_next(Fault::Silent);
+  t0 = clock::now();
+  assert(c->read_holding_regs(1, 5, 1, regs) == static_cast<int>(ModbusErr::IO_TIMEOUT));
+  assert(clock::now() - t0 >= std::chrono::milliseconds(190));
+  c->set_timeout_ms(1000);
+
+  // A response from another slave address is rejected.
+  slave.fault_next(Fault::WrongUnit);
+  assert(c->read_holding_regs(1, 5, 1, regs) == static_cast<int>(ModbusErr::IO_ERROR));
+
+  // Broadcast writes get no response; reads cannot be broadcast.
+  t0 = clock::now();
+  assert(c->write_single_reg(0, 7, 77) == 0);
+  assert(clock::now() - t0 < std::chrono::milliseconds(100));
+  assert(c->read_holding_regs(1, 7, 1, regs) == 0 && regs[0] == 77);
+  assert(c->read_holding_regs(0, 7, 1, regs) == static_cast<int>(ModbusErr::INVALID_ARG));
+  c->close();
+
+  // With lrc_check off a wrong LRC is accepted.
+  cfg.lrc_check = false;
+  auto lax = wiq::make_ascii_client(cfg);
+  assert(lax->connect() == 0);
+  slave.fault_next(Fault::BadCheck);
+  assert(lax->read_holding_regs(1, 5, 1, regs) == 0 && regs[0] == 0xBEEF);
+  lax->close();
+
+  // Through the C API: LRC failures count in lrc_errors.
+  slave.set_reg(2, 321);
+  write_text("unit_ascii.json", std::string(R"JSON({
+    "transport": "ascii",
+    "ascii": { "port": ")JSON") + slave.path() + R"JSON(", "parity": "N", "data_bits": 8, "timeout_ms": 300 },
+    "items": [
+      { "name": "hr.speed", "unit_id": 1, "function": 3, "address": 2, "type": "uint16" },
+      { "name": "hr.set",   "unit_id": 1, "function": 6, "address": 3, "type": "uint16" }
+    ]
+  })JSON");
+  IoHandle h = CreateIoInstance(nullptr, "unit_ascii.json");
+  assert(h != nullptr);
+  char buf[4096] = {0};
+  assert(ReadItem(h, "hr.speed", buf, sizeof(buf)) == 0 && std::string(buf) == "321");
+  assert(WriteItem(h, "hr.set", "55") == 0 && slave.reg(3) == 55);
+  slave.fault_next(Fault::BadCheck);
+  assert(ReadItem(h, "hr.speed", buf, sizeof(buf)) != 0);
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json snap = nlohmann::json::parse(buf);
+  assert(snap["counters"]["lrc_errors"].get<int>() == 1);
+  DestroyIoInstance(h);
+
+  // Unknown backends are rejected.
+  write_text("unit_ascii_bad.json", R"JSON({
+    "transport": "ascii", "ascii": { "port": "/dev/null", "backend": "libmodbus" },
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ]
+  })JSON");
+  assert(CreateIoInstance(nullptr, "unit_ascii_bad.json") == nullptr);
+
+  std::puts("unit_ascii_client: ok");
+  return 0;
+}
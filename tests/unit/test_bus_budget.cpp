@@ -0,0 +1,79 @@
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+// Ten single-register items, each its own block, polled every 100 ms from an
+// RTU line at 9600 baud 8N1. The line is never opened by the budget.
+static IoHandle create(const std::string& poll) {
+  std::string items;
+  for (int i = 0; i < 10; ++i) {
+    items += R"({ "name": "hr.)" + std::to_string(i) + R"(", "unit_id": 1, "function": 3, "address": )" +
+             std::to_string(i * 10) + R"(, "type": "uint16", "poll_ms": 100 },)";
+  }
+  write_text("unit_bus_budget.json", R"({
+    "devices": [
+      { "name": "line", "transport": "rtu", "rtu": { "port": "/dev/wiq-no-such-port", "baud": 9600, "parity": "N" } },
+      { "name": "plc", "transport": "tcp", "tcp": { "host": "127.0.0.1", "port": 1, "backend": "stub" } }
+    ],
+    "poll": )" + poll + R"(,
+    "items": [)" + items + R"(
+      { "name": "tcp.a", "device": "plc", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 10 }
+    ]
+  })");
+  return CreateIoInstance(nullptr, "unit_bus_budget.json");
+}
+
+int main() {
+  // Default: warn at 100 %, instance still created.
+  IoHandle h = create("{}");
+  assert(h != nullptr);
+  char buf[4096] = {0};
+  assert(CallMethod(h, "poll.budget", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json b = nlohmann::json::parse(buf);
+  assert(b["max_utilization_pct"].get<double>() == 100.0);
+  assert(b["admission"] == "warn");
+  const nlohmann::json& line = b["devices"][0];
+  assert(line["device"] == "line" && line["serial"].get<bool>());
+  assert(line["groups"].size() == 1);
+  const nlohmann::json& g = line["groups"][0];
+  assert(g["poll_ms"] == 100 && g["items"] == 10 && g["blocks"] == 10);
+  // Per read: 8-byte request + 7-byte response at 1041.7 us per character,
+  // plus two t3.5 gaps = 22917 us; ten of them per 100 ms cycle.
+  assert(std::fabs(g["wire_us"].get<double>() - 229167) <= 10);
+  assert(std::fabs(line["utilization_pct"].get<double>() - 229.17) < 0.1);
+  assert(line["overloaded"].get<bool>());
+  const nlohmann::json& plc = b["devices"][1];
+  assert(!plc["serial"].get<bool>() && plc["utilization_pct"].get<double>() == 0.0 && !plc["overloaded"].get<bool>());
+  DestroyIoInstance(h);
+
+  // Reject refuses the overloaded line ...
+  assert(create(R"({ "admission": "reject" })") == nullptr);
+  // ... unless the limit leaves room for it.
+  h = create(R"({ "admission": "reject", "max_utilization_pct": 250 })");
+  assert(h != nullptr);
+  assert(CallMethod(h, "poll.budget", "{}", buf, sizeof(buf)) == 0);
+  assert(!nlohmann::json::parse(buf)["devices"][0]["overloaded"].get<bool>());
+  DestroyIoInstance(h);
+
+  // Invalid settings.
+  assert(create(R"({ "admission": "drop" })") == nullptr);
+  assert(create(R"({ "max_utilization_pct": 0 })") == nullptr);
+
+  std::puts("unit_bus_budget: ok");
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include "../support/pty_modbus_slave.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json call(IoHandle h, const char* method) {
+  static char buf[65536];
+  assert(CallMethod(h, method, "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+// 40 contiguous registers polled from an RTU device at 9600 baud 8N1.
+static std::string plan_config(const std::string& port, int max_transaction_ms) {
+  std::string items;
+  for (int i = 0; i < 40; ++i) {
+    if (i) items += ",";
+    items += R"({ "name": "hr.)" + std::to_string(i) + R"(", "unit_id": 1, "function": 3, "address": )" +
+             std::to_string(i) + R"(, "type": "uint16", "poll_ms": 200 })";
+  }
+  return R"({ "transport": "rtu", "rtu": { "port": ")" + port + R"(", "baud": 9600, "parity": "N" },
+    "poll": { "max_transaction_ms": )" + std::to_string(max_transaction_ms) + R"( },
+    "items": [)" + items + "] }";
+}
+
+static nlohmann::json wait_for_plan(IoHandle h) {
+  std::vector<std::string> names;
+  for (int i = 0; i < 40; ++i) names.push_back("hr." + std::to_string(i));
+  std::vector<const char*> ptrs;
+  for (const auto& n : names) ptrs.push_back(n.c_str());
+  assert(SubscribeItems(h, ptrs.data(), static_cast<int>(ptrs.size())) == 0);
+  for (int i = 0; i < 100; ++i) {
+    nlohmann::json plan = call(h, "poll.plan");
+    if (!plan["groups"].empty() && !plan["groups"][0]["blocks"].empty()) return plan["groups"][0]["blocks"];
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(false && "no poll plan");
+  return nlohmann::json();
+}
+
+int main() {
+  using clock = std::chrono::steady_clock;
+  PtyModbusSlave slave;
+
+  // Without a budget the 40 registers are one block.
+  write_text("unit_bus_priority.json", plan_config(slave.path(), 0));
+  IoHandle h = CreateIoInstance(nullptr, "unit_bus_priority.json");
+  assert(h != nullptr);
+  nlohmann::json blocks = wait_for_plan(h);
+  assert(blocks.size() == 1 && blocks[0]["count"].get<int>() == 40);
+  DestroyIoInstance(h);
+
+  // A 30 ms budget splits them: at 9600 baud a 4-register read takes about
+  // 29 ms of line time including both t3.5 gaps.
+  write_text("unit_bus_priority.json", plan_config(slave.path(), 30));
+  h = CreateIoInstance(nullptr, "unit_bus_priority.json");
+  assert(h != nullptr);
+  blocks = wait_for_plan(h);
+  assert(blocks.size() == 10);
+  for (const auto& b : blocks) {
+    assert(b["count"].get<int>() == 4);
+    assert(b["wire_us"].get<int>() > 25000 && b["wire_us"].get<int>() <= 30000);
+  }
+  DestroyIoInstance(h);
+
+  // Writes go ahead of queued poll reads. Ten blocks of 20 ms each keep the
+  // line saturated at poll_ms 50; a write waits for the read in flight only.
+  slave.set_delay_ms(20);
+  std::string items;
+  for (int i = 0; i < 10; ++i) {
+    items += R"({ "name": "hr.)" + std::to_string(i) + R"(", "unit_id": 1, "function": 3, "address": )" +
+             std::to_string(i * 10) + R"(, "type": "uint16", "poll_ms": 50 },)";
+  }
+  write_text("unit_bus_priority.json", R"({ "transport": "rtu", "rtu": { "port": ")" + slave.path() +
+             R"(", "baud": 19200, "parity": "N" }, "items": [)" + items +
+             R"({ "name": "hr.cmd", "unit_id": 1, "function": 6, "address": 99, "type": "uint16" } ] })");
+  h = CreateIoInstance(nullptr, "unit_bus_priority.json");
+  assert(h != nullptr);
+  const char* polled[] = {"hr.0", "hr.1", "hr.2", "hr.3", "hr.4", "hr.5", "hr.6", "hr.7", "hr.8", "hr.9"};
+  assert(SubscribeItems(h, polled, 10) == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  for (int i = 1; i <= 5; ++i) {
+    auto t0 = clock::now();
+    assert(WriteItem(h, "hr.cmd", std::to_string(i).c_str()) == 0);
+    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - t0).count();
+    std::fprintf(stderr, "write %d took %lld ms\n", i, static_cast<long long>(took));
+    assert(took < 120);  // a full poll cycle would be 200 ms
+    assert(slave.reg(99) == i);
+    std::this_thread::sleep_for(std::chrono::milliseconds(37));
+  }
+  nlohmann::json snap = call(h, "diagnostics.snapshot");
+  const nlohmann::json& lat = snap["devices"][0]["write_latency_us"];
+  assert(lat["count"].get<int>() == 5);
+  assert(lat["max"].get<int>() < 60000);
+  assert(lat["avg"].get<int>() <= lat["max"].get<int>());
+  assert(snap["counters"]["deadline_misses"].get<int>() > 0);  // the line really was saturated
+  call(h, "diagnostics.reset");
+  assert(call(h, "diagnostics.snapshot")["devices"][0]["write_latency_us"]["count"].get<int>() == 0);
+  DestroyIoInstance(h);
+
+  std::puts("unit_bus_priority: ok");
+  return 0;
+}
@@ -19,19 +19,19 @@ int main() {
   assert(CreateIoInstance(nullptr, "invalid_transport.json") == nullptr);
 
   // 2) Empty items
-  write_text("empty_items.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502},"items":[]})");
+  write_text("empty_items.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502,"backend":"stub"},"items":[]})");
   assert(CreateIoInstance(nullptr, "empty_items.json") == nullptr);
 
   // 3) Type/function mismatch: FC1 but type=int16
-  write_text("bad_type_fc.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502},"items":[{"name":"x","unit_id":1,"function":1,"address":0,"type":"int16"}]})");
+  write_text("bad_type_fc.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502,"backend":"stub"},"items":[{"name":"x","unit_id":1,"function":1,"address":0,"type":"int16"}]})");
   assert(CreateIoInstance(nullptr, "bad_type_fc.json") == nullptr);
 
   // 4) Invalid unit_id
-  write_text("bad_unit_id.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502},"items":[{"name":"x","unit_id":0,"function":1,"address":0,"type":"bool"}]})");
+  write_text("bad_unit_id.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502,"backend":"stub"},"items":[{"name":"x","unit_id":0,"function":1,"address":0,"type":"bool"}]})");
   assert(CreateIoInstance(nullptr, "bad_unit_id.json") == nullptr);
 
   // 5) Valid minimal config should succeed
-  write_text("ok.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502},"items":[{"name":"ok","unit_id":1,"function":1,"address":0,"type":"bool"}]})");
+  write_text("ok.json", R"({"transport":"tcp","tcp":{"host":"127.0.0.1","port":1502,"backend":"stub"},"items":[{"name":"ok","unit_id":1,"function":1,"address":0,"type":"bool"}]})");
   IoHandle h = CreateIoInstance(nullptr, "ok.json");
   assert(h != nullptr);
   DestroyIoInstance(h);
@@ -0,0 +1,112 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+int main() {
+  using clock = std::chrono::steady_clock;
+  LoopbackModbusServer live;
+  LoopbackModbusServer dead;
+  dead.set_latency(5000);  // accepts connections, never answers in time
+  live.set_reg(10, 7);
+
+  std::string cfg = std::string(R"JSON({
+    "reconnect": { "retries": 0 },
+    "devices": [
+      { "name": "plc1", "transport": "tcp",
+        "tcp": { "host": "127.0.0.1", "port": )JSON") + std::to_string(live.port()) + R"JSON(, "backend": "native", "timeout_ms": 300 } },
+      { "name": "plc2", "transport": "tcp",
+        "tcp": { "host": "127.0.0.1", "port": )JSON" + std::to_string(dead.port()) + R"JSON(, "backend": "native", "timeout_ms": 300 } },
+      { "name": "sim", "transport": "tcp", "tcp": { "backend": "stub" } }
+    ],
+    "items": [
+      { "name": "a.poll", "device": "plc1", "unit_id": 1, "function": 3, "address": 10, "type": "uint16", "poll_ms": 20 },
+      { "name": "a.reg",  "device": "plc1", "unit_id": 1, "function": 3, "address": 11, "type": "uint16" },
+      { "name": "a.w",    "device": "plc1", "unit_id": 1, "function": 6, "address": 11, "type": "uint16" },
+      { "name": "b.poll", "device": "plc2", "unit_id": 1, "function": 3, "address": 10, "type": "uint16", "poll_ms": 20 },
+      { "name": "b.reg",  "device": "plc2", "unit_id": 1, "function": 3, "address": 11, "type": "uint16" },
+      { "name": "s.reg",  "unit_id": 1, "function": 3, "address": 0, "type": "uint16" },
+      { "name": "diag",   "unit_id": 1, "function": 8, "address": 0 }
+    ]
+  })JSON";
+  write_text("unit_devices.json", cfg);
+  IoHandle h = CreateIoInstance(nullptr, "unit_devices.json");
+  assert(h != nullptr);
+  const char* subs[] = {"a.poll", "b.poll"};
+  assert(SubscribeItems(h, subs, 2) == 0);
+
+  // The live device keeps polling while the other one times out.
+  char buf[4096] = {0};
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  assert(ReadItem(h, "a.poll", buf, sizeof(buf)) == 0 && std::string(buf) == "7");
+  live.set_reg(10, 8);
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  assert(ReadItem(h, "a.poll", buf, sizeof(buf)) == 0 && std::string(buf) == "8");
+
+  // On-demand I/O to plc1 does not wait behind a blocked request to plc2.
+  std::thread blocked([&] {
+    char b[256];
+    (void)ReadItem(h, "b.reg", b, sizeof(b));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto t0 = clock::now();
+  assert(WriteItem(h, "a.w", "42") == 0);
+  assert(ReadItem(h, "a.reg", buf, sizeof(buf)) == 0 && std::string(buf) == "42");
+  assert(clock::now() - t0 < std::chrono::milliseconds(200));
+  blocked.join();
+
+  // Items without a device use the first one listed.
+  live.set_reg(0, 3);
+  assert(ReadItem(h, "s.reg", buf, sizeof(buf)) == 0 && std::string(buf) == "3");
+
+  // Per-device diagnostics and plans.
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json snap = nlohmann::json::parse(buf);
+  const nlohmann::json& devices = snap["devices"];
+  assert(devices.is_array() && devices.size() == 3);
+  assert(devices[0]["name"] == "plc1" && devices[0]["operations"].get<int>() > 0);
+  assert(devices[0]["timeouts"].get<int>() == 0);
+  assert(devices[1]["name"] == "plc2" && devices[1]["timeouts"].get<int>() > 0);
+  assert(CallMethod(h, "poll.plan", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json plan = nlohmann::json::parse(buf);
+  assert(plan["groups"].size() == 2);
+  assert(plan["groups"][0]["device"] == "plc1" && plan["groups"][1]["device"] == "plc2");
+
+  assert(CallMethod(h, "connection.reconnect", R"({"device":"plc1"})", buf, sizeof(buf)) == 0);
+  assert(CallMethod(h, "connection.reconnect", R"({"device":"nope"})", buf, sizeof(buf)) < 0);
+  DestroyIoInstance(h);
+
+  // Unknown and duplicate device names are configuration errors.
+  write_text("unit_devices_bad.json", R"JSON({
+    "devices": [ { "name": "a", "tcp": { "backend": "stub" } } ],
+    "items": [ { "name": "x", "device": "b", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ]
+  })JSON");
+  assert(CreateIoInstance(nullptr, "unit_devices_bad.json") == nullptr);
+  write_text("unit_devices_bad.json", R"JSON({
+    "devices": [ { "name": "a", "tcp": { "backend": "stub" } }, { "name": "a", "tcp": { "backend": "stub" } } ],
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ]
+  })JSON");
+  assert(CreateIoInstance(nullptr, "unit_devices_bad.json") == nullptr);
+
+  std::puts("unit_devices: ok");
+  return 0;
+}
@@ -18,6 +18,7 @@ extern "C" {
 static std::string writeConfig(const std::string& filename) {
   nlohmann::json cfg = {
     {"transport", "tcp"},
+    {"tcp", {{"backend", "stub"}}},
     {"items", nlohmann::json::array({
       {
         {"name", "coil.ok"},
@@ -52,7 +53,7 @@ static std::string writeConfig(const std::string& filename) {
 }
 
 static nlohmann::json snapshot(IoHandle h) {
-  char buf[512] = {0};
+  char buf[4096] = {0};
   int rc = CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf));
   assert(rc == 0);
   return nlohmann::json::parse(buf);
@@ -18,6 +18,7 @@ extern "C" {
 static std::string writeConfig(const std::string& filename) {
   nlohmann::json cfg = {
     {"transport", "tcp"},
+    {"tcp", {{"backend", "stub"}}},
     {"items", nlohmann::json::array({
       {
         {"name", "coil.ok"},
@@ -57,7 +58,7 @@ int main() {
   assert(err["error"]["code"].get<int>() == -3202);
   assert(err["error"]["exception"]["name"].get<std::string>() == "ILLEGAL_DATA_ADDRESS");
 
-  char diagBuf[512] = {0};
+  char diagBuf[4096] = {0};
   rc = CallMethod(h, "diagnostics.snapshot", "{}", diagBuf, sizeof(diagBuf));
   assert(rc == 0);
   auto snap = nlohmann::json::parse(diagBuf);
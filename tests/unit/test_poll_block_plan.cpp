@@ -0,0 +1,103 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static void subscribe_all(IoHandle h, const nlohmann::json& items) {
+  std::vector<std::string> names;
+  for (const auto& it : items) names.push_back(it["name"].get<std::string>());
+  std::vector<const char*> ptrs;
+  for (const auto& n : names) ptrs.push_back(n.c_str());
+  assert(SubscribeItems(h, ptrs.data(), static_cast<int>(ptrs.size())) == 0);
+}
+
+static nlohmann::json plan(IoHandle h) {
+  static char buf[16384];
+  buf[0] = 0;
+  int rc = CallMethod(h, "poll.plan", "{}", buf, sizeof(buf));
+  assert(rc == 0);
+  return nlohmann::json::parse(buf);
+}
+
+int main() {
+  // 40 consecutive registers, a float across 50..51 and a register behind a
+  // 3-register hole (max_gap 2 keeps it out), plus coils on another block.
+  nlohmann::json items = nlohmann::json::array();
+  for (int i = 0; i < 40; ++i) {
+    items.push_back({{"name", "hr." + std::to_string(i)}, {"unit_id", 1}, {"function", 3},
+                     {"address", i}, {"type", "uint16"}, {"poll_ms", 20}});
+  }
+  items.push_back({{"name", "hr.f"}, {"unit_id", 1}, {"function", 3}, {"address", 41},
+                   {"type", "float"}, {"poll_ms", 20}});
+  items.push_back({{"name", "hr.far"}, {"unit_id", 1}, {"function", 3}, {"address", 46},
+                   {"type", "uint16"}, {"poll_ms", 20}});
+  items.push_back({{"name", "hr.w"}, {"unit_id", 1}, {"function", 16}, {"address", 0},
+                   {"count", 3}, {"type", "uint16"}});
+  items.push_back({{"name", "co.0"}, {"unit_id", 1}, {"function", 1}, {"address", 0},
+                   {"count", 4}, {"type", "bool"}, {"poll_ms", 20}});
+  nlohmann::json cfg = {{"transport", "tcp"}, {"tcp", {{"backend", "stub"}}}, {"poll", {{"max_gap", 2}}}, {"items", items}};
+  write_text("unit_poll_block_plan.json", cfg.dump());
+
+  IoHandle h = CreateIoInstance(nullptr, "unit_poll_block_plan.json");
+  assert(h != nullptr);
+  subscribe_all(h, items);
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+  auto p = plan(h);
+  assert(p["groups"].size() == 1);
+  auto blocks = p["groups"][0]["blocks"];
+  // coils 0..3 | hr 0..42 (hole of 1 before the float) | hr 46
+  assert(blocks.size() == 3);
+  assert(blocks[0]["function"] == 1 && blocks[0]["count"] == 4);
+  assert(blocks[1]["function"] == 3 && blocks[1]["address"] == 0 && blocks[1]["count"] == 43);
+  assert(blocks[1]["items"].size() == 41);
+  assert(blocks[2]["address"] == 46 && blocks[2]["count"] == 1);
+
+  // Values sliced out of the shared block decode per item.
+  assert(WriteItem(h, "hr.w", "[7,8,9]") == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  char buf[64] = {0};
+  assert(ReadItem(h, "hr.1", buf, sizeof(buf)) == 0);
+  assert(std::string(buf) == "8");
+  assert(ReadItem(h, "hr.2", buf, sizeof(buf)) == 0);
+  assert(std::string(buf) == "9");
+  DestroyIoInstance(h);
+
+  // Limits below 1 and negative gaps are rejected.
+  cfg["poll"] = {{"max_block_regs", 0}};
+  write_text("unit_poll_block_plan_bad.json", cfg.dump());
+  assert(CreateIoInstance(nullptr, "unit_poll_block_plan_bad.json") == nullptr);
+
+  // max_block_regs caps the block length.
+  cfg["poll"] = {{"max_gap", 2}, {"max_block_regs", 10}};
+  write_text("unit_poll_block_plan_cap.json", cfg.dump());
+  h = CreateIoInstance(nullptr, "unit_poll_block_plan_cap.json");
+  assert(h != nullptr);
+  subscribe_all(h, items);
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  auto capped = plan(h);
+  for (const auto& b : capped["groups"][0]["blocks"]) assert(b["count"].get<int>() <= 10);
+  DestroyIoInstance(h);
+
+  std::puts("unit_poll_block_plan: ok");
+  return 0;
+}
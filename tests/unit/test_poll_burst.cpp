@@ -0,0 +1,110 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json call(IoHandle h, const char* method) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, method, "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+static long long effective_ms(IoHandle h, const std::string& name) {
+  const nlohmann::json rates = call(h, "poll.rates");
+  for (const auto& it : rates["items"]) {
+    if (it["name"] == name) return it["effective_ms"].get<long long>();
+  }
+  return -1;
+}
+
+static void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+static std::string config(int port, const std::string& items) {
+  return R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(port) + R"(, "backend": "native", "timeout_ms": 500 },
+    "poll": { "stagger": false },
+    "items": [)" + items + "] }";
+}
+
+int main() {
+  // The state word leaving IDLE (0) bursts the spindle speed; a speed above
+  // 1000 bursts the spindle temperature. Both are otherwise read every 5 s,
+  // so a temperature burst within the first second can only come from the
+  // chain. Staggering is off so that the 5 s group starts at once.
+  LoopbackModbusServer server;
+  write_text("unit_poll_burst.json", config(server.port(), R"(
+    { "name": "machine.state", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 50,
+      "burst": [ { "when": { "ne": 0 }, "items": ["spindle.speed"], "poll_ms": 50, "duration_ms": 600 } ] },
+    { "name": "spindle.speed", "unit_id": 1, "function": 3, "address": 100, "type": "int16", "poll_ms": 5000,
+      "burst": [ { "when": { "gt": 1000 }, "items": ["spindle.temp"], "poll_ms": 50, "duration_ms": 600 } ] },
+    { "name": "spindle.temp", "unit_id": 1, "function": 3, "address": 200, "type": "int16", "poll_ms": 5000 })"));
+  IoHandle h = CreateIoInstance(nullptr, "unit_poll_burst.json");
+  assert(h != nullptr);
+  const char* names[] = {"machine.state", "spindle.speed", "spindle.temp"};
+  assert(SubscribeItems(h, names, 3) == 0);
+  sleep_ms(300);
+  assert(server.reads(100) == 1 && server.reads(200) == 1);
+  assert(call(h, "diagnostics.snapshot")["counters"]["burst_activations"] == 0);
+
+  server.set_reg(100, 1500);
+  server.set_reg(0, 2);
+  sleep_ms(500);
+  assert(effective_ms(h, "spindle.speed") == 50 && effective_ms(h, "spindle.temp") == 50);
+  assert(server.reads(100) >= 6 && server.reads(200) >= 4);
+
+  // Both windows close again; the state word stays RUNNING without
+  // re-triggering, so the items return to their 5 s period.
+  sleep_ms(900);
+  assert(effective_ms(h, "spindle.speed") == 5000 && effective_ms(h, "spindle.temp") == 5000);
+  const int speed = server.reads(100);
+  sleep_ms(400);
+  assert(server.reads(100) - speed <= 1);
+  nlohmann::json c = call(h, "diagnostics.snapshot")["counters"];
+  assert(c["burst_activations"].get<int>() == 2);
+  assert(c["burst_bus_us"].get<long long>() > 0);
+
+  // A fresh edge starts a new window.
+  server.set_reg(0, 0);
+  sleep_ms(150);
+  server.set_reg(0, 3);
+  sleep_ms(150);
+  assert(effective_ms(h, "spindle.speed") == 50);
+  DestroyIoInstance(h);
+
+  // Rules need known, polled targets and a known comparison.
+  write_text("unit_poll_burst_bad.json", config(server.port(), R"(
+    { "name": "a", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 50,
+      "burst": [ { "items": ["nope"], "poll_ms": 50, "duration_ms": 100 } ] })"));
+  assert(CreateIoInstance(nullptr, "unit_poll_burst_bad.json") == nullptr);
+  write_text("unit_poll_burst_bad.json", config(server.port(), R"(
+    { "name": "a", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 50,
+      "burst": [ { "when": { "between": 1 }, "items": ["b"], "poll_ms": 50, "duration_ms": 100 } ] },
+    { "name": "b", "unit_id": 1, "function": 3, "address": 1, "type": "uint16", "poll_ms": 500 })"));
+  assert(CreateIoInstance(nullptr, "unit_poll_burst_bad.json") == nullptr);
+  write_text("unit_poll_burst_bad.json", config(server.port(), R"(
+    { "name": "a", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 50,
+      "burst": [ { "items": ["b"], "poll_ms": 50, "duration_ms": 100 } ] },
+    { "name": "b", "unit_id": 1, "function": 3, "address": 1, "type": "uint16" })"));
+  assert(CreateIoInstance(nullptr, "unit_poll_burst_bad.json") == nullptr);
+
+  std::puts("unit_poll_burst: ok");
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json snapshot(IoHandle h) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+static int shed_level(IoHandle h) { return snapshot(h)["devices"][0]["shed_level"].get<int>(); }
+
+static bool wait_level(IoHandle h, bool (*ok)(int), int limit_ms) {
+  for (int waited = 0; waited < limit_ms; waited += 20) {
+    if (ok(shed_level(h))) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return false;
+}
+
+int main() {
+  // Eight single-register blocks every 100 ms on a link with 20 ms per
+  // reply: 160 ms of bus time per 100 ms cycle. The realtime alarm word sits
+  // last in the plan, so without shedding its read would go stale first.
+  LoopbackModbusServer server;
+  server.set_latency(20);
+  std::string items;
+  auto item = [&](const char* name, int addr, const char* prio) {
+    items += std::string(R"({ "name": ")") + name + R"(", "unit_id": 1, "function": 3, "address": )" +
+             std::to_string(addr) + R"(, "type": "uint16", "poll_ms": 100, "priority": ")" + prio + R"(" },)";
+  };
+  item("trend.1", 10, "background");
+  item("trend.2", 20, "background");
+  item("trend.3", 30, "background");
+  item("trend.4", 40, "background");
+  item("status.1", 50, "normal");
+  item("status.2", 60, "normal");
+  item("status.3", 70, "normal");
+  item("alarm", 90, "realtime");
+  items.pop_back();
+  write_text("unit_poll_shedding.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 500 },
+    "poll": { "cycle_target_pct": 80, "shed_window_ms": 200 },
+    "items": [)" + items + "] }");
+  IoHandle h = CreateIoInstance(nullptr, "unit_poll_shedding.json");
+  assert(h != nullptr);
+  const char* names[] = {"trend.1", "trend.2", "trend.3", "trend.4", "status.1", "status.2", "status.3", "alarm"};
+  assert(SubscribeItems(h, names, 8) == 0);
+
+  // The controller sheds until cycles fit: background gone, normal stretched.
+  assert(wait_level(h, [](int l) { return l >= 2; }, 5000));
+  std::this_thread::sleep_for(std::chrono::milliseconds(600));
+  const int alarm0 = server.reads(90);
+  const int trend0 = server.reads(10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  const int alarm_reads = server.reads(90) - alarm0;
+  const int trend_reads = server.reads(10) - trend0;
+  std::fprintf(stderr, "level %d: alarm %d reads/s, trend %d reads/s\n", shed_level(h), alarm_reads, trend_reads);
+  assert(alarm_reads >= 8);  // keeps its 100 ms rate
+  assert(trend_reads <= 4);
+  nlohmann::json c = snapshot(h)["counters"];
+  assert(c["shed_background"].get<int>() > 0);
+
+  // Load drops: the level returns to 0 and every item is read again.
+  server.set_latency(0);
+  assert(wait_level(h, [](int l) { return l == 0; }, 5000));
+  const int trend1 = server.reads(10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  assert(server.reads(10) - trend1 >= 4);
+  DestroyIoInstance(h);
+
+  // Unknown priority classes are rejected.
+  write_text("unit_poll_shedding_bad.json", R"({ "transport": "tcp", "items": [
+    { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 100, "priority": "high" } ] })");
+  assert(CreateIoInstance(nullptr, "unit_poll_shedding_bad.json") == nullptr);
+
+  std::puts("unit_poll_shedding: ok");
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json call(IoHandle h, const char* method) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, method, "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+static const nlohmann::json* find_period(const nlohmann::json& periods, int ms) {
+  for (const auto& p : periods) if (p["period_ms"].get<int>() == ms) return &p;
+  return nullptr;
+}
+
+int main() {
+  // 170/200/230 ms with base 25: 170 -> 100, 200 and 230 -> 200.
+  write_text("unit_poll_stagger.json", R"JSON({
+    "transport": "tcp",
+    "tcp": { "backend": "stub" },
+    "poll": { "harmonic_base_ms": 25 },
+    "items": [
+      { "name": "hr.a", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 170 },
+      { "name": "hr.b", "unit_id": 1, "function": 3, "address": 1, "type": "uint16", "poll_ms": 200 },
+      { "name": "hr.c", "unit_id": 1, "function": 3, "address": 2, "type": "uint16", "poll_ms": 230 },
+      { "name": "hr.d", "unit_id": 1, "function": 3, "address": 9, "type": "uint16", "poll_ms": 12 }
+    ]
+  })JSON");
+  IoHandle h = CreateIoInstance(nullptr, "unit_poll_stagger.json");
+  assert(h != nullptr);
+  const char* names[] = {"hr.a", "hr.b", "hr.c", "hr.d"};
+  assert(SubscribeItems(h, names, 4) == 0);
+
+  nlohmann::json rates = call(h, "poll.rates");
+  for (const auto& it : rates["items"]) {
+    const std::string n = it["name"];
+    const int eff = it["effective_ms"];
+    assert((n == "hr.a" && eff == 100) || (n == "hr.b" && eff == 200) || (n == "hr.c" && eff == 200) ||
+           (n == "hr.d" && eff == 12));  // below the base: 25 halved to 12
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(450));
+  // hr.b and hr.c share one group and one block plan.
+  nlohmann::json plan = call(h, "poll.plan");
+  assert(plan["groups"].size() == 3);
+  for (const auto& g : plan["groups"]) {
+    if (g["poll_ms"] == 200) assert(g["blocks"].size() == 1 && g["blocks"][0]["count"] == 2);
+  }
+
+  // The 200 ms group releases half way between the 100 ms group's releases.
+  nlohmann::json snap = call(h, "diagnostics.snapshot");
+  const nlohmann::json* p100 = find_period(snap["periods"], 100);
+  const nlohmann::json* p200 = find_period(snap["periods"], 200);
+  assert(p100 && p200);
+  const int d = (((*p200)["phase_ms"].get<int>() - (*p100)["phase_ms"].get<int>()) % 100 + 100) % 100;
+  std::fprintf(stderr, "phase distance %d ms\n", d);
+  assert(d >= 40 && d <= 60);
+  assert((*p100)["releases"].get<int>() >= 3 && (*p200)["releases"].get<int>() >= 2);
+  assert((*p200)["items"] == 2 && (*p200)["blocks"] == 1);
+  assert((*p100)["load_pct"].get<double>() >= 0.0);
+
+  call(h, "diagnostics.reset");
+  assert((*find_period(call(h, "diagnostics.snapshot")["periods"], 100))["releases"].get<int>() <= 1);
+  DestroyIoInstance(h);
+
+  // Without a base, periods stay as configured.
+  write_text("unit_poll_stagger.json", R"JSON({
+    "transport": "tcp",
+    "tcp": { "backend": "stub" },
+    "items": [ { "name": "hr.a", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 170 } ]
+  })JSON");
+  h = CreateIoInstance(nullptr, "unit_poll_stagger.json");
+  const char* a[] = {"hr.a"};
+  assert(SubscribeItems(h, a, 1) == 0);
+  assert(call(h, "poll.rates")["items"][0]["effective_ms"] == 170);
+  DestroyIoInstance(h);
+
+  std::puts("unit_poll_stagger: ok");
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      UnsubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json call(IoHandle h, const char* method) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, method, "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+static std::string read_item(IoHandle h, const char* name) {
+  char buf[256] = {0};
+  assert(ReadItem(h, name, buf, sizeof(buf)) == 0);
+  return buf;
+}
+
+static bool wait_for(bool (*ok)(LoopbackModbusServer&), LoopbackModbusServer& s, int limit_ms) {
+  for (int waited = 0; waited < limit_ms; waited += 10) {
+    if (ok(s)) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+static void sleep_ms(int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+int main() {
+  // A recipe table of ten registers behind a change counter at address 0,
+  // and a batch record read while the enable word at address 50 is set.
+  LoopbackModbusServer server;
+  for (int i = 0; i < 10; ++i) server.set_reg(100 + i, static_cast<std::uint16_t>(i + 1));
+  server.set_reg(200, 7);
+  std::string items =
+    R"({ "name": "recipe.seq", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 50 },
+       { "name": "batch.enable", "unit_id": 1, "function": 3, "address": 50, "type": "uint16", "poll_ms": 50 },
+       { "name": "batch.data", "unit_id": 1, "function": 3, "address": 200, "type": "uint16",
+         "trigger": { "item": "batch.enable", "mode": "gate" } })";
+  for (int i = 0; i < 10; ++i) {
+    items += R"(, { "name": "recipe.)" + std::to_string(i) + R"(", "unit_id": 1, "function": 3, "address": )" +
+             std::to_string(100 + i) + R"(, "type": "uint16", "trigger": { "item": "recipe.seq" } })";
+  }
+  write_text("unit_poll_trigger.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 500 },
+    "items": [)" + items + "] }");
+  IoHandle h = CreateIoInstance(nullptr, "unit_poll_trigger.json");
+  assert(h != nullptr);
+  const char* names[] = {"recipe.0", "recipe.1", "recipe.2", "recipe.3", "recipe.4",
+                         "recipe.5", "recipe.6", "recipe.7", "recipe.8", "recipe.9", "batch.data"};
+  assert(SubscribeItems(h, names, 11) == 0);
+
+  // Subscribing gated items polls their triggers; each table is read once
+  // for a first value and then left alone while the triggers hold still.
+  // The server counts a read before the engine stores it; a ReadItem in
+  // between would miss the poll cache and read the bus itself.
+  assert(wait_for([](LoopbackModbusServer& s) { return s.reads(100) == 1 && s.reads(200) == 1; }, server, 2000));
+  sleep_ms(20);
+  assert(read_item(h, "recipe.3") == "4" && read_item(h, "batch.data") == "7");
+  const int seq0 = server.reads(0);
+  sleep_ms(500);
+  assert(server.reads(0) - seq0 >= 5);
+  assert(server.reads(100) == 1 && server.reads(200) == 1);
+
+  // A new table without a counter bump stays unread; the bump brings it in.
+  server.set_reg(103, 44);
+  sleep_ms(200);
+  assert(read_item(h, "recipe.3") == "4");
+  server.set_reg(0, 1);
+  assert(wait_for([](LoopbackModbusServer& s) { return s.reads(100) == 2; }, server, 1000));
+  sleep_ms(20);
+  assert(read_item(h, "recipe.3") == "44");
+  sleep_ms(300);
+  assert(server.reads(100) == 2);
+
+  // The batch record follows the enable word at the trigger's rate.
+  server.set_reg(50, 1);
+  sleep_ms(500);
+  server.set_reg(50, 0);
+  sleep_ms(100);
+  const int batch = server.reads(200);
+  assert(batch >= 6);
+  sleep_ms(300);
+  assert(server.reads(200) == batch);
+
+  nlohmann::json c = call(h, "diagnostics.snapshot")["counters"];
+  assert(c["trigger_fires"].get<int>() >= 8 && c["trigger_holds"].get<int>() >= 10);
+  nlohmann::json plan = call(h, "poll.plan");
+  bool listed = false;
+  for (const auto& g : plan["groups"]) {
+    if (g.value("trigger", std::string()) == "recipe.seq") {
+      listed = g["mode"] == "change" && g["blocks"].size() == 1 && g["blocks"][0]["count"] == 10;
+    }
+  }
+  assert(listed);
+
+  // Dropping the gated items drops the triggers too.
+  assert(UnsubscribeItems(h, names, 11) == 0);
+  sleep_ms(100);
+  const int seq1 = server.reads(0);
+  sleep_ms(300);
+  assert(server.reads(0) == seq1);
+  DestroyIoInstance(h);
+
+  // Triggers must exist and be polled; gated items take no poll_ms of their own.
+  write_text("unit_poll_trigger_bad.json", R"({ "transport": "tcp", "items": [
+    { "name": "t", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" },
+    { "name": "x", "unit_id": 1, "function": 3, "address": 1, "type": "uint16", "trigger": { "item": "t" } } ] })");
+  assert(CreateIoInstance(nullptr, "unit_poll_trigger_bad.json") == nullptr);
+  write_text("unit_poll_trigger_bad.json", R"({ "transport": "tcp", "items": [
+    { "name": "t", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 100 },
+    { "name": "x", "unit_id": 1, "function": 3, "address": 1, "type": "uint16", "poll_ms": 100, "trigger": { "item": "t" } } ] })");
+  assert(CreateIoInstance(nullptr, "unit_poll_trigger_bad.json") == nullptr);
+  write_text("unit_poll_trigger_bad.json", R"({ "transport": "tcp", "items": [
+    { "name": "t", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 100 },
+    { "name": "x", "unit_id": 1, "function": 3, "address": 1, "type": "uint16", "trigger": { "item": "t", "mode": "edge" } } ] })");
+  assert(CreateIoInstance(nullptr, "unit_poll_trigger_bad.json") == nullptr);
+
+  std::puts("unit_poll_trigger: ok");
+  return 0;
+}
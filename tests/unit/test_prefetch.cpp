@@ -0,0 +1,114 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json prefetch_stats(IoHandle h) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf)["devices"][0]["prefetch"];
+}
+
+static std::string read_item(IoHandle h, const char* name) {
+  char buf[256] = {0};
+  assert(ReadItem(h, name, buf, sizeof(buf)) == 0);
+  return buf;
+}
+
+int main() {
+  // An HMI screen: tags at 10, 11, 13, 14 and a float at 16..17, then a
+  // distant one at 40.
+  LoopbackModbusServer server;
+  const int addrs[] = {10, 11, 13, 14};
+  for (int a : addrs) server.set_reg(a, static_cast<std::uint16_t>(a * 10));
+  server.set_reg(16, 0x3FC0);  // 1.5f
+  server.set_reg(40, 400);
+  server.set_reg(999, 9);
+  write_text("unit_prefetch.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 500 },
+    "on_demand": { "prefetch": { "max_gap": 2, "ttl_ms": 300 } },
+    "items": [
+      { "name": "hmi.a", "unit_id": 1, "function": 3, "address": 10, "type": "uint16" },
+      { "name": "hmi.b", "unit_id": 1, "function": 3, "address": 11, "type": "uint16" },
+      { "name": "hmi.c", "unit_id": 1, "function": 3, "address": 13, "type": "uint16" },
+      { "name": "hmi.d", "unit_id": 1, "function": 3, "address": 14, "type": "uint16" },
+      { "name": "hmi.f", "unit_id": 1, "function": 3, "address": 16, "type": "float" },
+      { "name": "hmi.far", "unit_id": 1, "function": 3, "address": 40, "type": "uint16" },
+      { "name": "hmi.set", "unit_id": 1, "function": 6, "address": 11, "type": "uint16" },
+      { "name": "edge.ok", "unit_id": 1, "function": 3, "address": 999, "type": "uint16" },
+      { "name": "edge.bad", "unit_id": 1, "function": 3, "address": 1000, "type": "uint16" }
+    ] })");
+  IoHandle h = CreateIoInstance(nullptr, "unit_prefetch.json");
+  assert(h != nullptr);
+
+  // The first read covers 10..17; its neighbours then cost no transaction.
+  int before = server.requests();
+  assert(read_item(h, "hmi.a") == "100");
+  assert(server.requests() - before == 1 && server.reads(10) == 1);
+  assert(read_item(h, "hmi.b") == "110" && read_item(h, "hmi.c") == "130" && read_item(h, "hmi.d") == "140");
+  assert(read_item(h, "hmi.f").compare(0, 3, "1.5") == 0);
+  assert(server.requests() - before == 1);
+  nlohmann::json pf = prefetch_stats(h);
+  assert(pf["hits"] == 4 && pf["misses"] == 1 && pf["stored"] == 4);
+
+  // The distant tag is beyond max_gap and needs its own read.
+  assert(read_item(h, "hmi.far") == "400");
+  assert(server.requests() - before == 2);
+
+  // Values expire after ttl_ms; a read from the middle widens both ways.
+  std::this_thread::sleep_for(std::chrono::milliseconds(350));
+  before = server.requests();
+  assert(read_item(h, "hmi.c") == "130");
+  assert(read_item(h, "hmi.a") == "100" && read_item(h, "hmi.f").compare(0, 3, "1.5") == 0);
+  assert(server.requests() - before == 1 && server.reads(10) == 2);
+
+  // A write drops what was prefetched.
+  assert(WriteItem(h, "hmi.set", "111") == 0);
+  assert(read_item(h, "hmi.b") == "111");
+
+  // A write that lands while a widened read is in progress: the neighbours
+  // that read returns are not kept, as they may predate the write. Here the
+  // read starts while the write is on the (slow) line and completes after it.
+  std::this_thread::sleep_for(std::chrono::milliseconds(350));
+  server.set_latency(150);
+  std::thread writer([h] { assert(WriteItem(h, "hmi.set", "112") == 0); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const int stored = prefetch_stats(h)["stored"];
+  assert(read_item(h, "hmi.a") == "100");
+  writer.join();
+  server.set_latency(0);
+  assert(prefetch_stats(h)["stored"] == stored);
+  before = server.requests();
+  assert(read_item(h, "hmi.b") == "112");
+  assert(server.requests() - before == 1);
+
+  // A wider range the device rejects falls back to the item alone.
+  assert(read_item(h, "edge.ok") == "9");
+  DestroyIoInstance(h);
+
+  write_text("unit_prefetch_bad.json", R"({ "transport": "tcp", "on_demand": { "prefetch": { "ttl_ms": 0 } },
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ] })");
+  assert(CreateIoInstance(nullptr, "unit_prefetch_bad.json") == nullptr);
+
+  std::puts("unit_prefetch: ok");
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static int image_read(IoHandle h, const std::string& params, nlohmann::json& out) {
+  char buf[4096] = {0};
+  int rc = CallMethod(h, "image.read", params.c_str(), buf, sizeof(buf));
+  if (rc == 0) out = nlohmann::json::parse(buf);
+  return rc;
+}
+
+int main() {
+  LoopbackModbusServer server;
+  server.set_regs(10, {0x0001, 0x0001});
+  server.set_reg(12, 12);
+  server.set_regs(14, {0x3FC0, 0x0000});  // 1.5f
+  server.set_coil(3, true);
+  write_text("unit_process_image.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 500 },
+    "poll": { "max_gap": 4 },
+    "items": [
+      { "name": "pair", "unit_id": 1, "function": 3, "address": 10, "type": "uint32", "count": 2, "poll_ms": 5 },
+      { "name": "tag", "unit_id": 1, "function": 3, "address": 12, "type": "uint16", "poll_ms": 5 },
+      { "name": "level", "unit_id": 1, "function": 3, "address": 14, "type": "float", "poll_ms": 5 },
+      { "name": "run", "unit_id": 1, "function": 1, "address": 3, "type": "bool", "poll_ms": 5 },
+      { "name": "idle", "unit_id": 1, "function": 3, "address": 40, "type": "uint16", "poll_ms": 5 }
+    ] })");
+  IoHandle h = CreateIoInstance(nullptr, "unit_process_image.json");
+  assert(h != nullptr);
+  const char* names[] = {"pair", "tag", "level", "run"};
+  assert(SubscribeItems(h, names, 4) == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Items decode from the image; unsubscribed ones were never polled.
+  nlohmann::json r;
+  assert(image_read(h, R"({"items":["level","run","tag","idle"]})", r) == 0);
+  assert(r["items"][0]["value"] == 1.5 && r["items"][1]["value"] == true && r["items"][2]["value"] == 12);
+  assert(r["items"][0]["generation"].get<std::uint64_t>() > 0 && r["items"][0]["age_ms"].get<long long>() < 100);
+  assert(r["items"][3]["value"].is_null());
+
+  // Raw ranges may span segments but not addresses no item covers.
+  assert(image_read(h, R"({"unit":1,"function":3,"address":10,"count":3})", r) == 0);
+  assert(r["values"] == nlohmann::json::array({1, 1, 12}));
+  assert(image_read(h, R"({"unit":1,"function":1,"address":3,"count":1})", r) == 0);
+  assert(r["values"][0] == true);
+  assert(image_read(h, R"({"unit":1,"function":3,"address":12,"count":2})", r) < 0);
+  assert(image_read(h, R"({"unit":1,"function":3,"address":40})", r) < 0);
+
+  // Both words of `pair` always change together; no reader may see them
+  // disagree while the poll thread keeps publishing.
+  std::atomic<bool> done{false};
+  std::thread flipper([&] {
+    for (std::uint16_t v = 2; !done; ++v) {
+      server.set_regs(10, {v, v});
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  std::vector<std::thread> readers;
+  std::atomic<int> reads{0};
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      std::uint64_t last = 0;
+      while (!done) {
+        nlohmann::json out;
+        assert(image_read(h, R"({"unit":1,"function":3,"address":10,"count":2})", out) == 0);
+        assert(out["values"][0] == out["values"][1]);
+        const std::uint64_t gen = out["generation"].get<std::uint64_t>();
+        assert(gen >= last);
+        last = gen;
+        reads += 1;
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  done = true;
+  flipper.join();
+  for (auto& t : readers) t.join();
+  assert(reads > 0);
+
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  assert(nlohmann::json::parse(buf)["devices"][0]["image"]["segments"] == 5);
+  DestroyIoInstance(h);
+
+  std::puts("unit_process_image: ok");
+  return 0;
+}
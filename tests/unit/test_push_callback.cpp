@@ -0,0 +1,91 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ModbusPush.hpp"
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+struct Recorder {
+  std::mutex mu;
+  int batches{0};
+  std::vector<std::map<std::string, std::string>> seen;
+};
+
+static void on_batch(const wiq_item_value* values, int count, void* user) {
+  auto* r = static_cast<Recorder*>(user);
+  std::lock_guard<std::mutex> lk(r->mu);
+  r->batches += 1;
+  std::map<std::string, std::string> b;
+  for (int i = 0; i < count; ++i) b[values[i].item] = values[i].value_json;
+  r->seen.push_back(b);
+}
+
+int main() {
+  std::string cfg = R"JSON({
+    "transport": "tcp",
+    "tcp": { "backend": "stub" },
+    "items": [
+      { "name": "hr.w", "unit_id": 1, "function": 16, "address": 10, "count": 2, "type": "uint16" },
+      { "name": "hr.a", "unit_id": 1, "function": 3,  "address": 10, "type": "uint16", "poll_ms": 10 },
+      { "name": "hr.b", "unit_id": 1, "function": 3,  "address": 11, "type": "uint16", "poll_ms": 10 }
+    ]
+  })JSON";
+  write_text("unit_push_callback.json", cfg);
+
+  IoHandle h = CreateIoInstance(nullptr, "unit_push_callback.json");
+  assert(h != nullptr);
+  assert(SetReadCallback(nullptr, on_batch, nullptr) != 0);
+
+  Recorder rec;
+  assert(SetReadCallback(h, on_batch, &rec) == 0);
+  const char* names[] = { "hr.a", "hr.b" };
+  assert(SubscribeItems(h, names, 2) == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(80));
+  {
+    // First tick delivers both items together; unchanged values are not repeated.
+    std::lock_guard<std::mutex> lk(rec.mu);
+    assert(rec.batches == 1);
+    assert(rec.seen[0].size() == 2);
+    assert(rec.seen[0]["hr.a"] == "0");
+    assert(rec.seen[0]["hr.b"] == "0");
+  }
+
+  assert(WriteItem(h, "hr.w", "[0,42]") == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    std::lock_guard<std::mutex> lk(rec.mu);
+    assert(rec.batches == 2);
+    assert(rec.seen[1].size() == 1);
+    assert(rec.seen[1]["hr.b"] == "42");
+  }
+
+  // Clearing the callback stops delivery.
+  assert(SetReadCallback(h, nullptr, nullptr) == 0);
+  assert(WriteItem(h, "hr.w", "[1,1]") == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  {
+    std::lock_guard<std::mutex> lk(rec.mu);
+    assert(rec.batches == 2);
+  }
+
+  DestroyIoInstance(h);
+  std::puts("unit_push_callback: ok");
+  return 0;
+}
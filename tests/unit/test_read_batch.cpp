@@ -0,0 +1,123 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json device_stats(IoHandle h) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf)["devices"][0];
+}
+
+static std::string config(int port, int window_us) {
+  std::string items;
+  for (int i = 0; i < 16; ++i) {
+    items += R"({ "name": "screen.)" + std::to_string(i) + R"(", "unit_id": 1, "function": 3, "address": )" +
+             std::to_string(i) + R"(, "type": "uint16" },)";
+  }
+  items += R"({ "name": "edge.ok", "unit_id": 1, "function": 3, "address": 995, "type": "uint16" },
+              { "name": "edge.bad", "unit_id": 1, "function": 3, "address": 1000, "type": "uint16" })";
+  return R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(port) + R"(, "backend": "native", "timeout_ms": 1000 },
+    "poll": { "max_gap": 8 },
+    "on_demand": { "batch_window_us": )" + std::to_string(window_us) + R"( },
+    "items": [)" + items + "] }";
+}
+
+// Read `names` from one thread each, all released at once. Returns the
+// wall time in ms; `values` receives the replies.
+static long long read_all(IoHandle h, const std::vector<std::string>& names, std::vector<std::string>& values,
+                          std::vector<int>& rcs) {
+  std::atomic<bool> go{false};
+  values.assign(names.size(), std::string());
+  rcs.assign(names.size(), 0);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    threads.emplace_back([&, i] {
+      while (!go) std::this_thread::yield();
+      char buf[256] = {0};
+      rcs[i] = ReadItem(h, names[i].c_str(), buf, sizeof(buf));
+      values[i] = buf;
+    });
+  }
+  const auto t0 = std::chrono::steady_clock::now();
+  go = true;
+  for (auto& t : threads) t.join();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+  // A screen switch: 16 tags read at once on a link with 20 ms per reply.
+  LoopbackModbusServer server;
+  server.set_latency(20);
+  for (int i = 0; i < 16; ++i) server.set_reg(i, static_cast<std::uint16_t>(100 + i));
+  server.set_reg(995, 77);
+  std::vector<std::string> names;
+  for (int i = 0; i < 16; ++i) names.push_back("screen." + std::to_string(i));
+  std::vector<std::string> values;
+  std::vector<int> rcs;
+
+  // Without a window every tag is its own transaction.
+  write_text("unit_read_batch.json", config(server.port(), 0));
+  IoHandle h = CreateIoInstance(nullptr, "unit_read_batch.json");
+  assert(h != nullptr);
+  int before = server.requests();
+  long long ms = read_all(h, names, values, rcs);
+  assert(server.requests() - before == 16);
+  assert(ms >= 16 * 20);
+  DestroyIoInstance(h);
+
+  // With a 5 ms window they merge into one block read.
+  write_text("unit_read_batch.json", config(server.port(), 5000));
+  h = CreateIoInstance(nullptr, "unit_read_batch.json");
+  assert(h != nullptr);
+  before = server.requests();
+  ms = read_all(h, names, values, rcs);
+  std::fprintf(stderr, "16 reads: %d transaction(s), %lld ms\n", server.requests() - before, ms);
+  for (int i = 0; i < 16; ++i) assert(rcs[i] == 0 && values[i] == std::to_string(100 + i));
+  assert(server.requests() - before <= 2);
+  assert(ms < 8 * 20);
+  nlohmann::json dev = device_stats(h);
+  assert(dev["batched_reads"] == 16 && dev["batch_transactions"].get<int>() <= 2);
+
+  // A merged range the device rejects falls back to single reads, so one
+  // bad address does not fail its neighbours.
+  std::vector<std::string> edge = {"edge.ok", "edge.bad"};
+  read_all(h, edge, values, rcs);
+  assert(rcs[0] == 0 && values[0] == "77");
+  assert(rcs[1] != 0);
+
+  // A lone read still works and takes a single transaction.
+  char buf[256] = {0};
+  before = server.requests();
+  assert(ReadItem(h, "screen.3", buf, sizeof(buf)) == 0 && std::string(buf) == "103");
+  assert(server.requests() - before == 1);
+  DestroyIoInstance(h);
+
+  write_text("unit_read_batch_bad.json", R"({ "transport": "tcp", "on_demand": { "batch_window_us": -1 },
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ] })");
+  assert(CreateIoInstance(nullptr, "unit_read_batch_bad.json") == nullptr);
+
+  std::puts("unit_read_batch: ok");
+  return 0;
+}
@@ -0,0 +1,148 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static int coalesced_reads(IoHandle h) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf)["devices"][0]["coalesced_reads"];
+}
+
+// Read `first` now and `second` 20 ms later, while the first is still on the bus.
+static void read_overlapping(IoHandle h, const char* first, const char* second, int& rc1, std::string& v1,
+                             int& rc2, std::string& v2) {
+  std::thread t([&] {
+    char buf[256] = {0};
+    rc1 = ReadItem(h, first, buf, sizeof(buf));
+    v1 = buf;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  char buf[256] = {0};
+  rc2 = ReadItem(h, second, buf, sizeof(buf));
+  v2 = buf;
+  t.join();
+}
+
+int main() {
+  LoopbackModbusServer server;
+  server.set_reg(10, 0xFFFE);
+  write_text("unit_read_coalesce.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 1000 },
+    "poll": { "stagger": false },
+    "items": [
+      { "name": "raw", "unit_id": 1, "function": 3, "address": 10, "type": "uint16" },
+      { "name": "signed", "unit_id": 1, "function": 3, "address": 10, "type": "int16" },
+      { "name": "far", "unit_id": 1, "function": 3, "address": 999, "type": "uint32", "count": 2 },
+      { "name": "far.alias", "unit_id": 1, "function": 3, "address": 999, "type": "int32", "count": 2 },
+      { "name": "blocker", "unit_id": 1, "function": 3, "address": 500, "type": "uint16" },
+      { "name": "polled", "unit_id": 1, "function": 3, "address": 20, "type": "uint16", "poll_ms": 60000 },
+      { "name": "direct", "unit_id": 1, "function": 3, "address": 20, "type": "int16" },
+      { "name": "polled.b", "unit_id": 1, "function": 3, "address": 100, "type": "uint16", "poll_ms": 50000 },
+      { "name": "direct.b", "unit_id": 1, "function": 3, "address": 100, "type": "int16" }
+    ] })");
+  IoHandle h = CreateIoInstance(nullptr, "unit_read_coalesce.json");
+  assert(h != nullptr);
+
+  // Two items over the same registers: the second read waits for the first
+  // one's transaction instead of queueing its own.
+  server.set_delay(10, 100);
+  int rc1 = 1, rc2 = 1;
+  std::string v1, v2;
+  read_overlapping(h, "raw", "signed", rc1, v1, rc2, v2);
+  assert(rc1 == 0 && rc2 == 0 && v1 == "65534" && v2 == "-2.000000");
+  assert(server.reads(10) == 1 && coalesced_reads(h) == 1);
+
+  // Reads that do not overlap each take their own transaction.
+  server.set_delay(-1, 0);
+  char buf[256] = {0};
+  assert(ReadItem(h, "signed", buf, sizeof(buf)) == 0);
+  assert(server.reads(10) == 2 && coalesced_reads(h) == 1);
+
+  // Errors are shared too: both callers get the device's exception.
+  server.set_delay(999, 100);
+  const int before = server.requests();
+  read_overlapping(h, "far", "far.alias", rc1, v1, rc2, v2);
+  assert(rc1 < 0 && rc2 == rc1);
+  assert(server.requests() == before + 1 && coalesced_reads(h) == 2);
+
+  // An on-demand read does not join a poll read of the same range queued
+  // behind the bus: that read would be served after every on-demand read.
+  // It takes its own transaction in its own lane instead.
+  server.set_delay(500, 200);
+  std::thread busy([&] {
+    char b[256] = {0};
+    assert(ReadItem(h, "blocker", b, sizeof(b)) == 0);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  const char* polled[] = {"polled"};
+  assert(SubscribeItems(h, polled, 1) == 0);  // its first poll queues behind "blocker"
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  assert(ReadItem(h, "direct", buf, sizeof(buf)) == 0);
+  busy.join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(server.reads(20) == 2 && coalesced_reads(h) == 2);
+
+  // A poll read does join an on-demand read in flight.
+  server.set_delay(100, 200);
+  std::thread direct([&] {
+    char b[256] = {0};
+    assert(ReadItem(h, "direct.b", b, sizeof(b)) == 0);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  const char* polled_b[] = {"polled.b"};
+  assert(SubscribeItems(h, polled_b, 1) == 0);
+  direct.join();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(server.reads(100) == 1 && coalesced_reads(h) == 3);
+
+  DestroyIoInstance(h);
+
+  // A micro-batch planned into one block shares an identical read in flight.
+  server.set_reg(30, 1);
+  server.set_reg(31, 2);
+  write_text("unit_read_coalesce_batch.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 1000 },
+    "on_demand": { "batch_window_us": 50000 },
+    "items": [
+      { "name": "pair", "unit_id": 1, "function": 3, "address": 30, "type": "uint32", "count": 2 },
+      { "name": "lo", "unit_id": 1, "function": 3, "address": 30, "type": "uint16" },
+      { "name": "hi", "unit_id": 1, "function": 3, "address": 31, "type": "uint16" }
+    ] })");
+  h = CreateIoInstance(nullptr, "unit_read_coalesce_batch.json");
+  assert(h != nullptr);
+  server.set_delay(30, 200);
+  std::thread pair([&] {
+    char b[256] = {0};
+    assert(ReadItem(h, "pair", b, sizeof(b)) == 0);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));  // "pair" is on the wire
+  read_overlapping(h, "lo", "hi", rc1, v1, rc2, v2);
+  pair.join();
+  assert(rc1 == 0 && rc2 == 0 && v1 == "1" && v2 == "2");
+  assert(server.reads(30) == 1 && coalesced_reads(h) == 1);
+
+  DestroyIoInstance(h);
+  std::puts("unit_read_coalesce: ok");
+  return 0;
+}
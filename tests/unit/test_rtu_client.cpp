@@ -0,0 +1,145 @@
+#include "RtuModbusClient.hpp"
+#include "ModbusError.hpp"
+#include "../support/pty_modbus_slave.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+int main() {
+  using wiq::ModbusErr;
+  using clock = std::chrono::steady_clock;
+  using Fault = PtyModbusSlave::Fault;
+  PtyModbusSlave slave;
+
+  wiq::RtuConfig cfg;
+  cfg.port = slave.path();
+  cfg.baud = 19200;
+  cfg.parity = 'N';  // some kernels reject parity on pseudo-terminals
+  cfg.timeout_ms = 1000;
+  auto c = wiq::make_rtu_client(cfg);
+  assert(c->connect() == 0);
+
+  // Writes and reads of every function code.
+  assert(c->write_single_reg(1, 5, 1234) == 0);
+  std::uint16_t regs[8] = {0};
+  auto t0 = clock::now();
+  assert(c->read_holding_regs(1, 5, 1, regs) == 0 && regs[0] == 1234);
+  // The frame length is known from its header, so the read completes on the
+  // last byte rather than after a timeout.
+  assert(clock::now() - t0 < std::chrono::milliseconds(100));
+  std::uint16_t vals[4] = {10, 20, 30, 40};
+  assert(c->write_multiple_regs(1, 20, 4, vals) == 0);
+  assert(c->read_input_regs(1, 20, 4, regs) == 0 && regs[0] == 10 && regs[3] == 40);
+  std::uint8_t bits_in[10] = {1, 0, 1, 1, 0, 0, 0, 1, 1, 0};
+  assert(c->write_multiple_coils(1, 30, 10, bits_in) == 0);
+  assert(c->write_single_coil(1, 31, true) == 0);
+  std::uint8_t bits[10] = {0};
+  assert(c->read_coils(1, 30, 10, bits) == 0);
+  assert(bits[0] == 1 && bits[1] == 1 && bits[7] == 1 && bits[8] == 1 && bits[9] == 0);
+  assert(c->read_discrete_inputs(1, 30, 2, bits) == 0 && bits[0] == 1 && bits[1] == 1);
+
+  // Exception responses are decoded.
+  assert(c->read_holding_regs(1, 99, 5, regs) == wiq::make_modbus_exception(2));
+
+  // A damaged CRC is reported and the next request works again.
+  slave.fault_next(Fault::BadCheck);
+  assert(c->read_holding_regs(1, 5, 1, regs) == static_cast<int>(ModbusErr::CRC_ERROR));
+  assert(c->read_holding_regs(1, 5, 1, regs) == 0 && regs[0] == 1234);
+
+  // No response: IO_TIMEOUT after the configured timeout.
+  c->set_timeout_ms(200);
+  slave.fault_next(Fault::Silent);
+  t0 = clock::now();
+  assert(c->read_holding_regs(1, 5, 1, regs) == static_cast<int>(ModbusErr::IO_TIMEOUT));
+  assert(clock::now() - t0 >= std::chrono::milliseconds(190));
+  c->set_timeout_ms(1000);
+
+  // A response from another slave address is rejected.
+  slave.fault_next(Fault::WrongUnit);
+  assert(c->read_holding_regs(1, 5, 1, regs) == static_cast<int>(ModbusErr::IO_ERROR));
+
+  // A pause inside a frame longer than t1.5 (859 us at 19200 baud) breaks it.
+  slave.fault_next(Fault::Split);
+  assert(c->read_holding_regs(1, 20, 4, regs) == static_cast<int>(ModbusErr::IO_ERROR));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(c->read_holding_regs(1, 20, 4, regs) == 0 && regs[0] == 10);
+
+  // With an allowance for USB adapters, which deliver in bursts, short
+  // pauses are tolerated; a long one still breaks the frame.
+  c->close();
+  cfg.char_gap_allowance_ms = 20;
+  c = wiq::make_rtu_client(cfg);
+  assert(c->connect() == 0);
+  slave.fault_next(Fault::Split);
+  assert(c->read_holding_regs(1, 20, 4, regs) == 0 && regs[1] == 20);
+  slave.fault_next(Fault::LongGap);
+  assert(c->read_holding_regs(1, 20, 4, regs) == static_cast<int>(ModbusErr::IO_ERROR));
+  // The tail of the broken frame is discarded before the next request.
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  assert(c->read_holding_regs(1, 20, 4, regs) == 0 && regs[2] == 30);
+
+  // Broadcast writes get no response; reads cannot be broadcast.
+  t0 = clock::now();
+  assert(c->write_single_reg(0, 7, 77) == 0);
+  assert(clock::now() - t0 < std::chrono::milliseconds(100));
+  assert(c->read_holding_regs(1, 7, 1, regs) == 0 && regs[0] == 77);
+  assert(c->read_holding_regs(0, 7, 1, regs) == static_cast<int>(ModbusErr::INVALID_ARG));
+  c->close();
+  assert(c->read_holding_regs(1, 7, 1, regs) == static_cast<int>(ModbusErr::NOT_CONNECTED));
+
+  // Through the C API with transport "rtu".
+  slave.set_reg(2, 321);
+  write_text("unit_rtu.json", std::string(R"JSON({
+    "transport": "rtu",
+    "rtu": { "port": ")JSON") + slave.path() + R"JSON(", "baud": 19200, "parity": "N", "timeout_ms": 300 },
+    "items": [
+      { "name": "hr.speed", "unit_id": 1, "function": 3, "address": 2, "type": "uint16" },
+      { "name": "hr.set",   "unit_id": 1, "function": 6, "address": 3, "type": "uint16" }
+    ]
+  })JSON");
+  IoHandle h = CreateIoInstance(nullptr, "unit_rtu.json");
+  assert(h != nullptr);
+  char buf[4096] = {0};
+  assert(ReadItem(h, "hr.speed", buf, sizeof(buf)) == 0 && std::string(buf) == "321");
+  assert(WriteItem(h, "hr.set", "55") == 0 && slave.reg(3) == 55);
+  slave.fault_next(Fault::BadCheck);
+  assert(ReadItem(h, "hr.speed", buf, sizeof(buf)) != 0);
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json snap = nlohmann::json::parse(buf);
+  assert(snap["counters"]["crc_errors"].get<int>() == 1);
+  DestroyIoInstance(h);
+
+  // An `rtu` section without a port is a configuration error.
+  write_text("unit_rtu_bad.json", R"JSON({
+    "transport": "rtu", "rtu": { "baud": 9600 },
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ]
+  })JSON");
+  assert(CreateIoInstance(nullptr, "unit_rtu_bad.json") == nullptr);
+
+  // Losing the line reports NOT_CONNECTED.
+  assert(c->connect() == 0);
+  slave.hang_up();
+  assert(c->read_holding_regs(1, 7, 1, regs) == static_cast<int>(ModbusErr::NOT_CONNECTED));
+
+  std::puts("unit_rtu_client: ok");
+  return 0;
+}
@@ -19,7 +19,7 @@ int main() {
   // Create a minimal config with a single holding register item and scale=0.0
   std::string cfg = R"JSON({
     "transport": "tcp",
-    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000 },
+    "tcp": { "host": "127.0.0.1", "port": 1502, "timeout_ms": 1000, "backend": "stub" },
     "items": [
       { "name": "holding.zero", "unit_id": 1, "function": 6, "address": 0, "type": "int16", "scale": 0.0, "offset": 0.0 }
     ]
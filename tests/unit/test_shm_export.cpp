@@ -0,0 +1,171 @@
+#include "../support/loopback_modbus_server.hpp"
+#include "ModbusShm.h"
+
+#include <nlohmann/json.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+  int      shm_reader_read_item(const char* name, const char* item, uint16_t* out, uint32_t max, uint64_t* generation);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+// A pid that no longer belongs to any process.
+static pid_t dead_pid() {
+  pid_t child = fork();
+  if (child == 0) _exit(0);
+  int status = 0;
+  waitpid(child, &status, 0);
+  return child;
+}
+
+static std::uint64_t now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+int main() {
+  LoopbackModbusServer server;
+  server.set_regs(14, {0x3FC0, 0x0000});  // 1.5f
+  server.set_reg(20, 20);
+  server.set_coil(3, true);
+  const std::string name = "/wiq_unit_shm_" + std::to_string(getpid());
+  write_text("unit_shm_export.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 500 },
+    "shared_memory": { "name": ")" + name + R"(" },
+    "items": [
+      { "name": "level", "unit_id": 1, "function": 3, "address": 14, "type": "float", "poll_ms": 5 },
+      { "name": "count", "unit_id": 1, "function": 3, "address": 20, "type": "uint16", "poll_ms": 5 },
+      { "name": "run", "unit_id": 1, "function": 1, "address": 3, "type": "bool", "poll_ms": 5 },
+      { "name": "idle", "unit_id": 1, "function": 3, "address": 40, "type": "uint16" },
+      { "name": "setpoint", "unit_id": 1, "function": 6, "address": 40, "type": "uint16" }
+    ] })");
+  IoHandle h = CreateIoInstance(nullptr, "unit_shm_export.json");
+  assert(h != nullptr);
+
+  // The layout is there before anything was polled.
+  wiq_shm_view v;
+  assert(wiq_shm_open(name.c_str(), &v) == 0);
+  assert(v.header->segment_count == 4 && v.header->item_count == 4);
+  assert(v.header->writer_pid == static_cast<std::uint32_t>(getpid()) && wiq_shm_alive(&v));
+  assert(wiq_shm_find_item(&v, "setpoint") == nullptr && wiq_shm_find_item(&v, "nope") == nullptr);
+  const wiq_shm_item* level = wiq_shm_find_item(&v, "level");
+  assert(level && std::strcmp(level->type, "float") == 0);
+  std::uint16_t regs[8];
+  std::uint64_t gen = 0, ns = 0;
+  assert(wiq_shm_read_segment(&v, level->segment, regs, 8, &gen, &ns) == 0 && gen == 0);
+
+  const char* names[] = {"level", "count", "run"};
+  assert(SubscribeItems(h, names, 3) == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  assert(wiq_shm_read_segment(&v, level->segment, regs, 8, &gen, &ns) == 2);
+  assert(regs[0] == 0x3FC0 && regs[1] == 0 && gen > 0);
+  assert(now_ns() - ns < 100000000ull);
+  assert(wiq_shm_read_segment(&v, level->segment, regs, 1, &gen, &ns) == -1);
+  const wiq_shm_item* run = wiq_shm_find_item(&v, "run");
+  assert(run && wiq_shm_read_segment(&v, run->segment, regs, 8, nullptr, nullptr) == 1 && regs[0] == 1);
+  assert(wiq_shm_segments(&v)[run->segment].function == 1);
+
+  // Another process reads it through the plain C header.
+  server.set_reg(20, 21);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  pid_t child = fork();
+  if (child == 0) {
+    std::uint16_t out[4];
+    std::uint64_t g = 0;
+    int n = shm_reader_read_item(name.c_str(), "count", out, 4, &g);
+    _exit(n == 1 && out[0] == 21 && g > 0 ? 0 : 1);
+  }
+  int status = 0;
+  assert(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // A segment left mid-update is not waited on forever: the reader gives up
+  // after its retries while the writer runs, and at once when it is gone.
+  const wiq_shm_item* idle = wiq_shm_find_item(&v, "idle");
+  assert(idle);
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  assert(fd >= 0);
+  void* rw = mmap(nullptr, v.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  assert(rw != MAP_FAILED);
+  auto* wh = static_cast<wiq_shm_header*>(rw);
+  auto* ws = reinterpret_cast<wiq_shm_segment*>(static_cast<char*>(rw) + wh->segments_offset) + idle->segment;
+  ws->seq += 1;
+  assert(wiq_shm_read_segment(&v, idle->segment, regs, 8, nullptr, nullptr) == WIQ_SHM_EBUSY);
+  const std::uint32_t writer = wh->writer_pid;
+  wh->writer_pid = static_cast<std::uint32_t>(dead_pid());
+  assert(!wiq_shm_writer_alive(&v));
+  assert(wiq_shm_read_segment(&v, idle->segment, regs, 8, nullptr, nullptr) == WIQ_SHM_EDEAD);
+  wh->writer_pid = writer;
+  ws->seq += 1;
+  assert(wiq_shm_read_segment(&v, idle->segment, regs, 8, nullptr, nullptr) == 0);
+  munmap(rw, v.size);
+
+  // The name belongs to this instance while it runs: a second one is refused.
+  write_text("unit_shm_twin.json", R"({
+    "transport": "tcp", "tcp": { "backend": "stub" },
+    "shared_memory": { "name": ")" + name + R"(" },
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 50 } ] })");
+  assert(CreateIoInstance(nullptr, "unit_shm_twin.json") == nullptr);
+  assert(wiq_shm_alive(&v));
+
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json snap = nlohmann::json::parse(buf);
+  assert(snap["shared_memory"]["name"] == name && snap["shared_memory"]["segments"] == 4);
+
+  // Destroying the instance marks the object dead and unlinks the name.
+  DestroyIoInstance(h);
+  assert(!wiq_shm_alive(&v));
+  wiq_shm_close(&v);
+  assert(wiq_shm_open(name.c_str(), &v) != 0);
+
+  // A leftover whose handler died without clearing `alive` is replaced.
+  fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  assert(fd >= 0 && ftruncate(fd, sizeof(wiq_shm_header)) == 0);
+  wiq_shm_header stale{};
+  stale.magic = WIQ_SHM_MAGIC;
+  stale.version = WIQ_SHM_VERSION;
+  stale.header_size = sizeof(wiq_shm_header);
+  stale.segment_size = sizeof(wiq_shm_segment);
+  stale.item_size = sizeof(wiq_shm_item);
+  stale.writer_pid = static_cast<std::uint32_t>(dead_pid());
+  stale.alive = 1;
+  stale.total_size = sizeof(wiq_shm_header);
+  assert(pwrite(fd, &stale, sizeof(stale), 0) == static_cast<ssize_t>(sizeof(stale)));
+  close(fd);
+  h = CreateIoInstance(nullptr, "unit_shm_twin.json");
+  assert(h != nullptr);
+  assert(wiq_shm_open(name.c_str(), &v) == 0);
+  assert(v.header->writer_pid == static_cast<std::uint32_t>(getpid()) && v.header->item_count == 1);
+  wiq_shm_close(&v);
+  DestroyIoInstance(h);
+
+  write_text("unit_shm_bad.json", R"({ "transport": "tcp", "shared_memory": { "name": "no/slash" },
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ] })");
+  assert(CreateIoInstance(nullptr, "unit_shm_bad.json") == nullptr);
+
+  std::puts("unit_shm_export: ok");
+  return 0;
+}
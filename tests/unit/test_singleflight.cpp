@@ -0,0 +1,55 @@
+#include "util/Singleflight.hpp"
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main() {
+  using Flights = wiq::Singleflight<std::string, int>;
+
+  // The first caller leads; overlapping callers join and get completed with it.
+  {
+    Flights f;
+    Flights::Ticket t = f.join("a", 1);
+    assert(t && t->current());
+    assert(!f.join("a", 2) && !f.join("a", 3));
+    Flights::Ticket u = f.join("b", 4);
+    assert(u && f.size() == 2);
+    assert((f.complete("a", t) == std::vector<int>{1, 2, 3}));
+    assert(f.size() == 1);
+    // Once completed, the key starts a new flight.
+    Flights::Ticket again = f.join("a", 5);
+    assert(again && again != t);
+    assert((f.complete("b", u) == std::vector<int>{4}));
+    assert((f.complete("a", again) == std::vector<int>{5}));
+    assert(f.size() == 0);
+  }
+
+  // forget() detaches flights: later callers lead new ones, and the old
+  // flight completes only its own waiters without touching the new one.
+  {
+    Flights f;
+    Flights::Ticket old = f.join("a", 1);
+    assert(!f.join("a", 2));
+    f.forget();
+    assert(!old->current() && f.size() == 0);
+    Flights::Ticket fresh = f.join("a", 3);
+    assert(fresh && fresh->current());
+    assert((f.complete("a", old) == std::vector<int>{1, 2}));
+    assert(f.size() == 1 && !f.join("a", 4));
+    assert((f.complete("a", fresh) == std::vector<int>{3, 4}));
+  }
+
+  // attach() joins only a flight already in progress.
+  {
+    Flights f;
+    assert(!f.attach("a", 1) && f.size() == 0);
+    Flights::Ticket t = f.join("a", 2);
+    assert(f.attach("a", 3));
+    assert((f.complete("a", t) == std::vector<int>{2, 3}));
+    assert(!f.attach("a", 4));
+  }
+
+  std::puts("unit_singleflight: ok");
+  return 0;
+}
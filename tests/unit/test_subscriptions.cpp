@@ -0,0 +1,92 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      UnsubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static std::uint64_t cycles(IoHandle h) {
+  char buf[1024] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf)["counters"]["poll_cycles"].get<std::uint64_t>();
+}
+
+static std::size_t planned_items(IoHandle h) {
+  char buf[4096] = {0};
+  assert(CallMethod(h, "poll.plan", "{}", buf, sizeof(buf)) == 0);
+  auto plan = nlohmann::json::parse(buf);
+  std::size_t n = 0;
+  for (const auto& g : plan["groups"])
+    for (const auto& b : g["blocks"]) n += b["items"].size();
+  return n;
+}
+
+int main() {
+  std::string cfg = R"JSON({
+    "transport": "tcp",
+    "tcp": { "backend": "stub" },
+    "items": [
+      { "name": "hr.a", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "poll_ms": 10 },
+      { "name": "hr.b", "unit_id": 1, "function": 3, "address": 1, "type": "uint16", "poll_ms": 10 },
+      { "name": "hr.c", "unit_id": 1, "function": 3, "address": 2, "type": "uint16", "poll_ms": 20 },
+      { "name": "hr.pull", "unit_id": 1, "function": 3, "address": 3, "type": "uint16" }
+    ]
+  })JSON";
+  write_text("unit_subscriptions.json", cfg);
+
+  IoHandle h = CreateIoInstance(nullptr, "unit_subscriptions.json");
+  assert(h != nullptr);
+
+  // Nothing is subscribed: nothing goes on the bus.
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  assert(cycles(h) == 0);
+
+  const char* ab[] = { "hr.a", "hr.b" };
+  const char* a[] = { "hr.a" };
+  const char* pull[] = { "hr.pull" };
+  const char* unknown[] = { "nope", "hr.c" };
+  assert(SubscribeItems(h, ab, 2) == 0);
+  assert(SubscribeItems(h, a, 1) == 0);          // hr.a now has two references
+  assert(SubscribeItems(h, pull, 1) == 0);       // pull-only items are accepted
+  assert(SubscribeItems(h, unknown, 2) != 0);    // unknown name reported, hr.c still added
+  assert(SubscribeItems(h, nullptr, 1) != 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  assert(cycles(h) > 0);
+  assert(planned_items(h) == 3);
+
+  // Dropping one of two references keeps hr.a polled.
+  assert(UnsubscribeItems(h, a, 1) == 0);
+  const char* bc[] = { "hr.b", "hr.c" };
+  assert(UnsubscribeItems(h, bc, 2) == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  assert(planned_items(h) == 1);
+
+  // Last reference gone: the engine goes quiet.
+  assert(UnsubscribeItems(h, a, 1) == 0);
+  assert(UnsubscribeItems(h, a, 1) == 0);        // extra unsubscribe is harmless
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  std::uint64_t idle = cycles(h);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(cycles(h) == idle);
+  assert(planned_items(h) == 0);
+
+  DestroyIoInstance(h);
+  std::puts("unit_subscriptions: ok");
+  return 0;
+}
@@ -0,0 +1,194 @@
+#include "TcpModbusClient.hpp"
+#include "ModbusError.hpp"
+#include "../support/loopback_modbus_server.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+int main() {
+  using wiq::ModbusErr;
+  LoopbackModbusServer server;
+
+  auto c = wiq::make_tcp_client("127.0.0.1", server.port());
+  c->set_timeout_ms(1000);
+  std::uint16_t regs[4] = {0};
+  assert(c->read_holding_regs(1, 0, 1, regs) == static_cast<int>(ModbusErr::NOT_CONNECTED));
+  assert(c->connect() == 0);
+
+  // Register and coil round trips.
+  const std::uint16_t w[3] = {0x1234, 0xBEEF, 7};
+  assert(c->write_multiple_regs(1, 10, 3, w) == 0);
+  assert(c->read_holding_regs(1, 10, 3, regs) == 0);
+  assert(regs[0] == 0x1234 && regs[1] == 0xBEEF && regs[2] == 7);
+  assert(c->write_single_reg(1, 12, 99) == 0);
+  assert(c->read_input_regs(1, 12, 1, regs) == 0 && regs[0] == 99);
+
+  const std::uint8_t bits[10] = {1, 0, 1, 1, 0, 0, 0, 0, 1, 1};
+  std::uint8_t rb[10] = {0};
+  assert(c->write_multiple_coils(1, 3, 10, bits) == 0);
+  assert(c->read_coils(1, 3, 10, rb) == 0);
+  for (int i = 0; i < 10; ++i) assert(rb[i] == bits[i]);
+  assert(c->write_single_coil(1, 4, true) == 0);
+  assert(c->read_discrete_inputs(1, 4, 1, rb) == 0 && rb[0] == 1);
+
+  // Exceptions and argument checks.
+  int rc = c->read_holding_regs(1, 999, 2, regs);
+  assert(wiq::is_modbus_exception(rc) && wiq::decode_modbus_exception(rc) == 2);
+  assert(c->read_holding_regs(1, 0, 126, regs) == static_cast<int>(ModbusErr::INVALID_ARG));
+  assert(c->read_coils(1, 0, 8, nullptr) == static_cast<int>(ModbusErr::INVALID_ARG));
+
+  // A timed-out request leaves the connection usable; its late reply is skipped.
+  server.set_reg(500, 5);
+  server.set_delay(500, 150);
+  c->set_timeout_ms(50);
+  assert(c->read_holding_regs(1, 500, 1, regs) == static_cast<int>(ModbusErr::IO_TIMEOUT));
+  c->set_timeout_ms(1000);
+  server.set_delay(-1, 0);
+  assert(c->read_holding_regs(1, 10, 1, regs) == 0 && regs[0] == 0x1234);
+  assert(server.connections() == 1);
+
+  // Peer close surfaces as NOT_CONNECTED so the caller reconnects.
+  server.drop_after_reply();
+  assert(c->read_holding_regs(1, 10, 1, regs) == 0);
+  assert(c->read_holding_regs(1, 10, 1, regs) == static_cast<int>(ModbusErr::NOT_CONNECTED));
+  assert(c->connect() == 0);
+  assert(c->read_holding_regs(1, 11, 1, regs) == 0 && regs[0] == 0xBEEF);
+  c->close();
+
+  // Pipelined reads: replies are matched by transaction id, whatever their order.
+  {
+    LoopbackModbusServer slow;
+    for (int i = 0; i < 8; ++i) slow.set_reg(100 + i, static_cast<std::uint16_t>(1000 + i));
+    auto p = wiq::make_tcp_client("127.0.0.1", slow.port());
+    p->set_timeout_ms(1000);
+    p->set_pipeline_window(4);
+    assert(p->connect() == 0);
+    std::uint16_t out[8];
+    wiq::ReadRequest reqs[8];
+    auto prepare = [&](int n) {
+      for (int i = 0; i < n; ++i) {
+        reqs[i] = wiq::ReadRequest{};
+        reqs[i].function = 3; reqs[i].unit = 1; reqs[i].addr = 100 + i; reqs[i].count = 1;
+        reqs[i].regs = &out[i];
+        out[i] = 0;
+      }
+    };
+
+    // With 20 ms per round trip, 8 sequential reads need at least 160 ms.
+    slow.set_latency(20);
+    prepare(8);
+    auto t0 = std::chrono::steady_clock::now();
+    p->read_batch(reqs, 8);
+    auto took = std::chrono::steady_clock::now() - t0;
+    for (int i = 0; i < 8; ++i) assert(reqs[i].rc == 0 && out[i] == 1000 + i);
+    assert(took < std::chrono::milliseconds(120));
+    slow.set_latency(0);
+
+    // The first reply arrives last.
+    slow.set_delay(100, 50);
+    prepare(4);
+    reqs[2].count = 126;  // rejected locally; the others are unaffected
+    p->read_batch(reqs, 4);
+    assert(reqs[0].rc == 0 && out[0] == 1000);
+    assert(reqs[1].rc == 0 && out[1] == 1001);
+    assert(reqs[2].rc == static_cast<int>(ModbusErr::INVALID_ARG));
+    assert(reqs[3].rc == 0 && out[3] == 1003);
+
+    // An overdue reply fails only its own request and is drained when it arrives.
+    slow.set_delay(100, 150);
+    p->set_timeout_ms(60);
+    prepare(4);
+    p->read_batch(reqs, 4);
+    assert(reqs[0].rc == static_cast<int>(ModbusErr::IO_TIMEOUT));
+    for (int i = 1; i < 4; ++i) assert(reqs[i].rc == 0 && out[i] == 1000 + i);
+    slow.set_delay(-1, 0);
+    p->set_timeout_ms(1000);
+    slow.set_latency(120);
+    prepare(4);
+    p->read_batch(reqs, 4);
+    for (int i = 0; i < 4; ++i) assert(reqs[i].rc == 0 && out[i] == 1000 + i);
+    assert(slow.connections() == 1);
+  }
+
+  // Selected through the config; reconnects transparently after a drop.
+  std::string cfg = std::string(R"JSON({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )JSON") + std::to_string(server.port()) + R"JSON(, "backend": "native", "pipeline_window": 4 },
+    "items": [
+      { "name": "hr.w", "unit_id": 1, "function": 16, "address": 20, "count": 2, "type": "uint16" },
+      { "name": "hr.r", "unit_id": 1, "function": 3,  "address": 20, "count": 2, "type": "uint16" }
+    ]
+  })JSON";
+  write_text("unit_tcp_client.json", cfg);
+  IoHandle h = CreateIoInstance(nullptr, "unit_tcp_client.json");
+  assert(h != nullptr);
+  assert(WriteItem(h, "hr.w", "[11,22]") == 0);
+  assert(server.reg(20) == 11 && server.reg(21) == 22);
+  server.drop_after_reply();
+  char buf[64] = {0};
+  assert(ReadItem(h, "hr.r", buf, sizeof(buf)) == 0);
+  assert(std::string(buf) == "[11,22]");
+  assert(ReadItem(h, "hr.r", buf, sizeof(buf)) == 0);
+  assert(std::string(buf) == "[11,22]");
+  DestroyIoInstance(h);
+
+  // The poll engine sends the blocks of one release through the pipeline.
+  {
+    LoopbackModbusServer slow;
+    slow.set_latency(10);
+    for (int i = 0; i < 4; ++i) slow.set_reg(200 + 10 * i, static_cast<std::uint16_t>(40 + i));
+    std::string pcfg = std::string(R"JSON({
+      "transport": "tcp",
+      "tcp": { "host": "127.0.0.1", "port": )JSON") + std::to_string(slow.port()) + R"JSON(, "backend": "native", "pipeline_window": 4 },
+      "items": [
+        { "name": "u1", "unit_id": 1, "function": 3, "address": 200, "type": "uint16", "poll_ms": 50 },
+        { "name": "u2", "unit_id": 2, "function": 3, "address": 210, "type": "uint16", "poll_ms": 50 },
+        { "name": "u3", "unit_id": 3, "function": 3, "address": 220, "type": "uint16", "poll_ms": 50 },
+        { "name": "u4", "unit_id": 4, "function": 3, "address": 230, "type": "uint16", "poll_ms": 50 }
+      ]
+    })JSON";
+    write_text("unit_tcp_client_poll.json", pcfg);
+    IoHandle ph = CreateIoInstance(nullptr, "unit_tcp_client_poll.json");
+    assert(ph != nullptr);
+    const char* names[] = {"u1", "u2", "u3", "u4"};
+    assert(SubscribeItems(ph, names, 4) == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (int i = 0; i < 4; ++i) {
+      assert(ReadItem(ph, names[i], buf, sizeof(buf)) == 0);
+      assert(std::string(buf) == std::to_string(40 + i));
+    }
+    DestroyIoInstance(ph);
+  }
+
+  write_text("unit_tcp_client_bad.json", R"JSON({
+    "transport": "tcp", "tcp": { "backend": "fast" },
+    "items": [ { "name": "hr", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ]
+  })JSON");
+  assert(CreateIoInstance(nullptr, "unit_tcp_client_bad.json") == nullptr);
+  write_text("unit_tcp_client_bad.json", R"JSON({
+    "transport": "tcp", "tcp": { "backend": "native", "pipeline_window": 0 },
+    "items": [ { "name": "hr", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ]
+  })JSON");
+  assert(CreateIoInstance(nullptr, "unit_tcp_client_bad.json") == nullptr);
+
+  std::puts("unit_tcp_client: ok");
+  return 0;
+}
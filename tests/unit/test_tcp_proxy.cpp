@@ -0,0 +1,211 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+// Polling off: everything the device sees comes through the proxy.
+static std::string config(int device_port, const std::string& server) {
+  return R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(device_port) + R"(, "backend": "native", "timeout_ms": 500 },
+    "poll": { "enabled": false },
+    "server": )" + server + R"(,
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ] })";
+}
+
+// Minimal Modbus TCP master; send() and recv() are split so several
+// masters can have a request outstanding at once.
+struct Master {
+  int fd{-1};
+  std::uint16_t tid{0};
+
+  explicit Master(int port) {
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(static_cast<std::uint16_t>(port));
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(::connect(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) == 0);
+  }
+  ~Master() { ::close(fd); }
+
+  void send(int unit, const std::vector<std::uint8_t>& pdu) {
+    ++tid;
+    std::vector<std::uint8_t> f = {static_cast<std::uint8_t>(tid >> 8), static_cast<std::uint8_t>(tid), 0, 0,
+                                   static_cast<std::uint8_t>((pdu.size() + 1) >> 8), static_cast<std::uint8_t>(pdu.size() + 1),
+                                   static_cast<std::uint8_t>(unit)};
+    f.insert(f.end(), pdu.begin(), pdu.end());
+    assert(::send(fd, f.data(), f.size(), 0) == static_cast<ssize_t>(f.size()));
+  }
+
+  std::vector<std::uint8_t> recv() {
+    std::uint8_t h[7];
+    assert(::recv(fd, h, 7, MSG_WAITALL) == 7);
+    assert(((h[0] << 8) | h[1]) == tid);
+    std::vector<std::uint8_t> rsp(static_cast<std::size_t>(((h[4] << 8) | h[5]) - 1));
+    assert(::recv(fd, rsp.data(), rsp.size(), MSG_WAITALL) == static_cast<ssize_t>(rsp.size()));
+    return rsp;
+  }
+
+  std::vector<std::uint8_t> call(int unit, const std::vector<std::uint8_t>& pdu) {
+    send(unit, pdu);
+    return recv();
+  }
+};
+
+static std::vector<std::uint8_t> read_req(int fc, int addr, int qty) {
+  return {static_cast<std::uint8_t>(fc), static_cast<std::uint8_t>(addr >> 8), static_cast<std::uint8_t>(addr),
+          static_cast<std::uint8_t>(qty >> 8), static_cast<std::uint8_t>(qty)};
+}
+
+static nlohmann::json server_snapshot(IoHandle h) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf)["server"];
+}
+
+int main() {
+  LoopbackModbusServer device;
+  device.set_regs(100, {1, 2, 3, 4});
+  device.set_coil(7, true);
+
+  write_text("unit_tcp_proxy.json", config(device.port(), R"({ "mode": "proxy", "port": 0 })"));
+  IoHandle h = CreateIoInstance(nullptr, "unit_tcp_proxy.json");
+  assert(h != nullptr);
+  const int port = server_snapshot(h)["port"];
+  {
+    // Three masters polling the same table while the line is slow: one
+    // transaction serves all of them.
+    Master a(port), b(port), c(port);
+    device.set_latency(100);
+    a.send(1, read_req(3, 100, 4));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    b.send(1, read_req(3, 100, 4));
+    c.send(1, read_req(3, 100, 4));
+    const std::vector<std::uint8_t> want{3, 8, 0, 1, 0, 2, 0, 3, 0, 4};
+    assert(a.recv() == want && b.recv() == want && c.recv() == want);
+    assert(device.reads(100) == 1);
+    device.set_latency(0);
+
+    // Without a cache the next request goes to the device again.
+    assert(a.call(1, read_req(3, 100, 4)) == want);
+    assert(device.reads(100) == 2);
+
+    // Any address and unit id passes through, exceptions included.
+    assert((a.call(5, read_req(1, 7, 1)) == std::vector<std::uint8_t>{1, 1, 1}));
+    assert((a.call(1, read_req(3, 999, 2)) == std::vector<std::uint8_t>{0x83, 0x02}));
+    assert((a.call(1, read_req(3, 0, 126)) == std::vector<std::uint8_t>{0x83, 0x03}));
+  }
+  nlohmann::json s = server_snapshot(h);
+  assert(s["mode"] == "proxy" && s["downstream"] == 4 && s["coalesced"] == 2 && s["cache_hits"] == 0);
+  assert(s["exceptions"] == 2);
+  DestroyIoInstance(h);
+
+  // With cache_ms a repeated request within the window stays off the bus,
+  // and a write through the proxy drops the cached responses.
+  write_text("unit_tcp_proxy_cache.json", config(device.port(), R"({ "mode": "proxy", "port": 0, "cache_ms": 5000 })"));
+  h = CreateIoInstance(nullptr, "unit_tcp_proxy_cache.json");
+  assert(h != nullptr);
+  {
+    Master m(server_snapshot(h)["port"]);
+    const int before = device.reads(100);
+    assert((m.call(1, read_req(3, 100, 1)) == std::vector<std::uint8_t>{3, 2, 0, 1}));
+    assert((m.call(1, read_req(3, 100, 1)) == std::vector<std::uint8_t>{3, 2, 0, 1}));
+    assert(device.reads(100) == before + 1);
+    assert((m.call(1, {6, 0, 100, 0, 9}) == std::vector<std::uint8_t>{6, 0, 100, 0, 9}));
+    assert((m.call(1, read_req(3, 100, 1)) == std::vector<std::uint8_t>{3, 2, 0, 9}));
+    assert(device.reads(100) == before + 2);
+  }
+  s = server_snapshot(h);
+  assert(s["downstream"] == 2 && s["cache_hits"] == 1 && s["writes"] == 1);
+  DestroyIoInstance(h);
+
+  // Each device has its own read queue: reads of a stalled device wait for
+  // it alone, and only its own queue fills up (read_queue 2, exception 06).
+  LoopbackModbusServer slow;
+  slow.set_latency(500);
+  write_text("unit_tcp_proxy_devices.json", R"({
+    "devices": [
+      { "name": "fast", "transport": "tcp",
+        "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(device.port()) + R"(, "backend": "native", "timeout_ms": 2000 } },
+      { "name": "slow", "transport": "tcp",
+        "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(slow.port()) + R"(, "backend": "native", "timeout_ms": 2000 } }
+    ],
+    "poll": { "enabled": false },
+    "server": { "mode": "proxy", "port": 0, "read_queue": 2 },
+    "items": [
+      { "name": "f", "device": "fast", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" },
+      { "name": "s", "device": "slow", "unit_id": 2, "function": 3, "address": 0, "type": "uint16" }
+    ] })");
+  h = CreateIoInstance(nullptr, "unit_tcp_proxy_devices.json");
+  assert(h != nullptr);
+  {
+    const int sp = server_snapshot(h)["port"];
+    Master s1(sp), s2(sp), s3(sp), s4(sp), f(sp);
+    s1.send(2, read_req(3, 1, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));  // on the slow bus now
+    s2.send(2, read_req(3, 2, 1));
+    s3.send(2, read_req(3, 3, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert((s4.call(2, read_req(3, 4, 1)) == std::vector<std::uint8_t>{0x83, 0x06}));
+    for (int i = 0; i < 3; ++i) {
+      const auto t0 = std::chrono::steady_clock::now();
+      assert((f.call(1, read_req(3, 100, 1)) == std::vector<std::uint8_t>{3, 2, 0, 9}));
+      assert(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(100));
+    }
+    assert((s1.recv() == std::vector<std::uint8_t>{3, 2, 0, 0}));
+  }
+  DestroyIoInstance(h);
+
+  write_text("unit_tcp_proxy_bad.json", config(device.port(), R"({ "mode": "mirror", "port": 0 })"));
+  assert(CreateIoInstance(nullptr, "unit_tcp_proxy_bad.json") == nullptr);
+  // Image mode still needs polling.
+  write_text("unit_tcp_proxy_image.json", config(device.port(), R"({ "port": 0 })"));
+  assert(CreateIoInstance(nullptr, "unit_tcp_proxy_image.json") == nullptr);
+  // A unit id with items on two devices cannot be routed unless
+  // server.device picks one.
+  const std::string shared = R"({
+    "devices": [
+      { "name": "fast", "transport": "tcp",
+        "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(device.port()) + R"(, "backend": "native" } },
+      { "name": "slow", "transport": "tcp",
+        "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(slow.port()) + R"(, "backend": "native" } }
+    ],
+    "poll": { "enabled": false },
+    "items": [
+      { "name": "f", "device": "fast", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" },
+      { "name": "s", "device": "slow", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" }
+    ],
+    "server": { "mode": "proxy", "port": 0)";
+  write_text("unit_tcp_proxy_shared.json", shared + " } }");
+  assert(CreateIoInstance(nullptr, "unit_tcp_proxy_shared.json") == nullptr);
+  write_text("unit_tcp_proxy_shared.json", shared + R"(, "device": "fast" } })");
+  h = CreateIoInstance(nullptr, "unit_tcp_proxy_shared.json");
+  assert(h != nullptr);
+  DestroyIoInstance(h);
+
+  std::puts("unit_tcp_proxy: ok");
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static std::string config(int device_port, const std::string& server) {
+  return R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(device_port) + R"(, "backend": "native", "timeout_ms": 500 },
+    "server": )" + server + R"(,
+    "items": [
+      { "name": "level", "unit_id": 1, "function": 3, "address": 14, "type": "float", "poll_ms": 5 },
+      { "name": "count", "unit_id": 1, "function": 3, "address": 20, "type": "uint16", "poll_ms": 5 },
+      { "name": "run", "unit_id": 1, "function": 1, "address": 3, "type": "bool", "poll_ms": 5 },
+      { "name": "idle", "unit_id": 1, "function": 3, "address": 60, "type": "uint16" },
+      { "name": "setpoint", "unit_id": 1, "function": 6, "address": 40, "type": "uint16" }
+    ] })";
+}
+
+// Minimal Modbus TCP master: one blocking request, returns the response PDU.
+struct Master {
+  int fd{-1};
+  std::uint16_t tid{0};
+
+  explicit Master(int port) {
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(static_cast<std::uint16_t>(port));
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(::connect(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) == 0);
+  }
+  ~Master() { ::close(fd); }
+
+  std::vector<std::uint8_t> call(int unit, const std::vector<std::uint8_t>& pdu) {
+    ++tid;
+    std::vector<std::uint8_t> f = {static_cast<std::uint8_t>(tid >> 8), static_cast<std::uint8_t>(tid), 0, 0,
+                                   static_cast<std::uint8_t>((pdu.size() + 1) >> 8), static_cast<std::uint8_t>(pdu.size() + 1),
+                                   static_cast<std::uint8_t>(unit)};
+    f.insert(f.end(), pdu.begin(), pdu.end());
+    assert(::send(fd, f.data(), f.size(), 0) == static_cast<ssize_t>(f.size()));
+    std::uint8_t h[7];
+    assert(::recv(fd, h, 7, MSG_WAITALL) == 7);
+    assert(((h[0] << 8) | h[1]) == tid && h[6] == unit);
+    std::vector<std::uint8_t> rsp(static_cast<std::size_t>(((h[4] << 8) | h[5]) - 1));
+    assert(::recv(fd, rsp.data(), rsp.size(), MSG_WAITALL) == static_cast<ssize_t>(rsp.size()));
+    return rsp;
+  }
+};
+
+static std::vector<std::uint8_t> read_req(int fc, int addr, int qty) {
+  return {static_cast<std::uint8_t>(fc), static_cast<std::uint8_t>(addr >> 8), static_cast<std::uint8_t>(addr),
+          static_cast<std::uint8_t>(qty >> 8), static_cast<std::uint8_t>(qty)};
+}
+
+static bool is_exception(const std::vector<std::uint8_t>& rsp, int fc, int code) {
+  return rsp.size() == 2 && rsp[0] == (fc | 0x80) && rsp[1] == code;
+}
+
+int main() {
+  LoopbackModbusServer device;
+  device.set_regs(14, {0x3FC0, 0x0000});  // 1.5f
+  device.set_reg(20, 20);
+  device.set_coil(3, true);
+
+  write_text("unit_tcp_server.json", config(device.port(), R"({ "port": 0, "max_age_ms": 1000 })"));
+  IoHandle h = CreateIoInstance(nullptr, "unit_tcp_server.json");
+  assert(h != nullptr);
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  const int port = nlohmann::json::parse(buf)["server"]["port"];
+  assert(port > 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));  // server.subscribe polls every item
+
+  {
+    Master m(port);
+    // Reads come from the image, not from the device.
+    auto rsp = m.call(1, read_req(3, 14, 2));
+    assert((rsp == std::vector<std::uint8_t>{3, 4, 0x3F, 0xC0, 0, 0}));
+    rsp = m.call(1, read_req(1, 3, 1));
+    assert((rsp == std::vector<std::uint8_t>{1, 1, 1}));
+    rsp = m.call(1, read_req(3, 20, 1));
+    assert((rsp == std::vector<std::uint8_t>{3, 2, 0, 20}));
+
+    assert(is_exception(m.call(1, read_req(3, 14, 3)), 3, 0x02));    // 16 is not in the image
+    assert(is_exception(m.call(1, read_req(3, 60, 1)), 3, 0x0B));    // in the image, never polled
+    assert(is_exception(m.call(1, read_req(3, 14, 0)), 3, 0x03));
+    assert(is_exception(m.call(1, read_req(3, 14, 126)), 3, 0x03));
+    assert(is_exception(m.call(9, read_req(3, 14, 2)), 3, 0x0A));    // no device has unit 9
+    assert(is_exception(m.call(1, {0x2B, 0x0E, 0x01, 0x00}), 0x2B, 0x01));
+
+    // Writes are forwarded; the reply waits for the device.
+    rsp = m.call(1, {6, 0, 40, 0, 77});
+    assert((rsp == std::vector<std::uint8_t>{6, 0, 40, 0, 77}));
+    assert(device.reg(40) == 77);
+    rsp = m.call(1, {16, 0, 50, 0, 2, 4, 0x12, 0x34, 0x56, 0x78});
+    assert((rsp == std::vector<std::uint8_t>{16, 0, 50, 0, 2}));
+    assert(device.reg(50) == 0x1234 && device.reg(51) == 0x5678);
+    assert(is_exception(m.call(1, {16, 0, 50, 0, 2, 3, 0, 0, 0}), 16, 0x03));
+    assert(is_exception(m.call(1, {5, 0, 3, 0x12, 0x34}), 5, 0x03));
+  }
+
+  // Many masters at once share the same polled image.
+  {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 16; ++t) {
+      threads.emplace_back([port] {
+        Master m(port);
+        for (int i = 0; i < 50; ++i) {
+          auto rsp = m.call(1, read_req(3, 14, 2));
+          assert(rsp.size() == 6 && rsp[2] == 0x3F);
+        }
+      });
+    }
+    for (auto& t : threads) t.join();
+  }
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  nlohmann::json snap = nlohmann::json::parse(buf);
+  assert(snap["server"]["requests"].get<int>() >= 16 * 50 + 13);
+  assert(snap["server"]["exceptions"] == 8 && snap["server"]["writes"] == 2);
+  DestroyIoInstance(h);
+
+  // writes: reject answers 01 without touching the bus.
+  write_text("unit_tcp_server_reject.json", config(device.port(), R"({ "port": 0, "writes": "reject" })"));
+  h = CreateIoInstance(nullptr, "unit_tcp_server_reject.json");
+  assert(h != nullptr);
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  {
+    Master m(nlohmann::json::parse(buf)["server"]["port"]);
+    assert(is_exception(m.call(1, {6, 0, 40, 0, 5}), 6, 0x01));
+    assert(device.reg(40) == 77);
+  }
+  DestroyIoInstance(h);
+
+  // writes: queue acknowledges at once and writes in the background.
+  write_text("unit_tcp_server_queue.json", config(device.port(), R"({ "port": 0, "writes": "queue" })"));
+  h = CreateIoInstance(nullptr, "unit_tcp_server_queue.json");
+  assert(h != nullptr);
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  {
+    Master m(nlohmann::json::parse(buf)["server"]["port"]);
+    device.set_latency(100);
+    const auto t0 = std::chrono::steady_clock::now();
+    auto rsp = m.call(1, {6, 0, 40, 0, 88});
+    assert((rsp == std::vector<std::uint8_t>{6, 0, 40, 0, 88}));
+    assert(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(80));
+    for (int i = 0; i < 100 && device.reg(40) != 88; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert(device.reg(40) == 88);
+    device.set_latency(0);
+  }
+  DestroyIoInstance(h);
+
+  write_text("unit_tcp_server_bad.json", config(device.port(), R"({ "port": 0, "writes": "maybe" })"));
+  assert(CreateIoInstance(nullptr, "unit_tcp_server_bad.json") == nullptr);
+  write_text("unit_tcp_server_nopoll.json",
+             R"({ "transport": "tcp", "poll": { "enabled": false }, "server": { "port": 0 },
+                  "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16" } ] })");
+  assert(CreateIoInstance(nullptr, "unit_tcp_server_nopoll.json") == nullptr);
+
+  std::puts("unit_tcp_server: ok");
+  return 0;
+}
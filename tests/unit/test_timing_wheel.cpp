@@ -0,0 +1,58 @@
+#include "poll/TimingWheel.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+int main() {
+  using wiq::TimingWheel;
+
+  // Timers across all levels fire exactly at their tick, in order.
+  {
+    TimingWheel w(0);
+    const std::uint64_t ticks[] = { 1, 5, 63, 64, 65, 200, 4095, 4096, 5000, 300000 };
+    std::uint64_t id = 0;
+    for (auto t : ticks) w.schedule(id++, t);
+    assert(w.size() == 10);
+
+    std::map<std::uint64_t, std::uint64_t> fired_at;
+    std::uint64_t now = 0;
+    while (!w.empty()) {
+      std::uint64_t hint = w.next_expiry_hint();
+      assert(hint != TimingWheel::kNoExpiry && hint > now);
+      now = hint;
+      w.advance(now, [&](std::uint64_t fired) { fired_at[fired] = now; });
+    }
+    for (std::uint64_t i = 0; i < 10; ++i) assert(fired_at[i] == ticks[i]);
+  }
+
+  // Overdue timers fire on the next advance; coarse advances still fire everything.
+  {
+    TimingWheel w(1000);
+    w.schedule(1, 10);
+    w.schedule(2, 1000 + 70);
+    std::vector<std::uint64_t> fired;
+    w.advance(1001, [&](std::uint64_t id) { fired.push_back(id); });
+    assert(fired.size() == 1 && fired[0] == 1);
+    w.advance(50000, [&](std::uint64_t id) { fired.push_back(id); });
+    assert(fired.size() == 2 && fired[1] == 2);
+    assert(w.empty());
+    assert(w.next_expiry_hint() == TimingWheel::kNoExpiry);
+  }
+
+  // Timers beyond the wheel horizon are re-placed until due.
+  {
+    TimingWheel w(0);
+    const std::uint64_t far = (std::uint64_t(1) << 24) + 12345;
+    w.schedule(7, far);
+    bool fired = false;
+    w.advance(far - 1, [&](std::uint64_t) { fired = true; });
+    assert(!fired);
+    w.advance(far, [&](std::uint64_t id) { fired = (id == 7); });
+    assert(fired);
+  }
+
+  std::puts("unit_timing_wheel: ok");
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      SubscribeItems(IoHandle h, const char** names, int count);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json unit_counters(IoHandle h, int unit) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, "diagnostics.snapshot", "{}", buf, sizeof(buf)) == 0);
+  const nlohmann::json snap = nlohmann::json::parse(buf);
+  for (const auto& u : snap["units"]) {
+    if (u["unit"] == unit) return u;
+  }
+  return {{"deadline_misses", 0}, {"backoffs", 0}};
+}
+
+int main() {
+  // Unit 2 stops answering (its register is held back past the timeout)
+  // while unit 1 on the same line stays healthy.
+  LoopbackModbusServer server;
+  server.set_delay(500, 2000);
+  write_text("unit_unit_backoff.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 50 },
+    "poll": { "unit_backoff_ms": 100, "unit_backoff_max_ms": 400 },
+    "items": [
+      { "name": "healthy", "unit_id": 1, "function": 3, "address": 10, "type": "uint16", "poll_ms": 20 },
+      { "name": "stalled", "unit_id": 2, "function": 3, "address": 500, "type": "uint16", "poll_ms": 20 }
+    ] })");
+  IoHandle h = CreateIoInstance(nullptr, "unit_unit_backoff.json");
+  assert(h != nullptr);
+  const char* names[] = {"healthy", "stalled"};
+  assert(SubscribeItems(h, names, 2) == 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+  const nlohmann::json u1 = unit_counters(h, 1);
+  const nlohmann::json u2 = unit_counters(h, 2);
+  DestroyIoInstance(h);
+
+  // The stalled unit is held off 100, 200, 400, 400 ms after its timeouts:
+  // about 4 attempts instead of one per 20 ms cycle (or ~8 with a fixed hold).
+  const int stalled = server.reads(500);
+  assert(stalled >= 3 && stalled <= 6);
+
+  // Meanwhile the healthy unit keeps most of its 20 ms rate (60 cycles).
+  const int healthy = server.reads(10);
+  assert(healthy >= 35);
+
+  // Every timeout of unit 2 started a hold-off, and its cycles missed their
+  // deadlines while held off; unit 1 was never held off.
+  assert(u2["backoffs"].get<int>() >= 3 && u2["backoffs"].get<int>() <= stalled);
+  assert(u2["deadline_misses"].get<int>() >= 20);
+  assert(u1["backoffs"] == 0);
+  std::puts("unit_unit_backoff: ok");
+  return 0;
+}
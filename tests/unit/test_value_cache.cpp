@@ -0,0 +1,126 @@
+#include "../support/loopback_modbus_server.hpp"
+
+#include <nlohmann/json.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+  using IoHandle = void*;
+  IoHandle CreateIoInstance(void* user_param, const char* jsonConfigPath);
+  void     DestroyIoInstance(IoHandle h);
+  int      ReadItem(IoHandle h, const char* name, char* outJson, int outSize);
+  int      ReadItemMaxAge(IoHandle h, const char* name, int max_age_ms, char* outJson, int outSize);
+  int      WriteItem(IoHandle h, const char* name, const char* valueJson);
+  int      CallMethod(IoHandle h, const char* method, const char* paramsJson, char* outJson, int outSize);
+}
+
+static void write_text(const char* path, const std::string& s) {
+  std::ofstream ofs(path, std::ios::binary); ofs << s; ofs.close();
+}
+
+static nlohmann::json call(IoHandle h, const char* method, const char* params) {
+  char buf[8192] = {0};
+  assert(CallMethod(h, method, params, buf, sizeof(buf)) == 0);
+  return nlohmann::json::parse(buf);
+}
+
+static std::string read_max_age(IoHandle h, const char* name, int max_age_ms) {
+  char buf[256] = {0};
+  assert(ReadItemMaxAge(h, name, max_age_ms, buf, sizeof(buf)) == 0);
+  return buf;
+}
+
+static std::string read_item(IoHandle h, const char* name) {
+  char buf[256] = {0};
+  assert(ReadItem(h, name, buf, sizeof(buf)) == 0);
+  return buf;
+}
+
+int main() {
+  LoopbackModbusServer server;
+  server.set_reg(10, 100);
+  server.set_reg(20, 200);
+  write_text("unit_value_cache.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 1000 },
+    "on_demand": { "cache_ttl_ms": 300 },
+    "items": [
+      { "name": "tag", "unit_id": 1, "function": 3, "address": 10, "type": "uint16" },
+      { "name": "tag.set", "unit_id": 1, "function": 6, "address": 10, "type": "uint16" },
+      { "name": "live", "unit_id": 1, "function": 3, "address": 20, "type": "uint16", "cache_ttl_ms": 0 }
+    ] })");
+  IoHandle h = CreateIoInstance(nullptr, "unit_value_cache.json");
+  assert(h != nullptr);
+
+  // Identical reads issued together share one transaction.
+  server.set_latency(100);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; ++i) readers.emplace_back([h] { assert(read_max_age(h, "tag", 0) == "100"); });
+  for (auto& t : readers) t.join();
+  server.set_latency(0);
+  assert(server.reads(10) == 1);
+  nlohmann::json cache = call(h, "diagnostics.snapshot", "{}")["devices"][0]["cache"];
+  assert(cache["shared_reads"] == 7);
+
+  // A value read a moment ago satisfies a generous max_age, not max_age 0.
+  assert(read_max_age(h, "tag", 5000) == "100" && server.reads(10) == 1);
+  assert(read_max_age(h, "tag", 0) == "100" && server.reads(10) == 2);
+
+  // ReadItem applies cache_ttl_ms; an item overriding it with 0 always reads.
+  assert(read_item(h, "tag") == "100" && server.reads(10) == 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(350));
+  assert(read_item(h, "tag") == "100" && server.reads(10) == 3);
+  assert(read_item(h, "live") == "200" && read_item(h, "live") == "200" && server.reads(20) == 2);
+
+  // cache.peek reports the cached value and its age without a bus read.
+  nlohmann::json peek = call(h, "cache.peek", R"({"items":["tag","tag.set"]})")["items"];
+  assert(peek[0]["name"] == "tag" && peek[0]["value"] == 100);
+  assert(peek[0]["age_ms"].get<long long>() < 300 && peek[0]["timestamp"].is_string());
+  assert(peek[1]["value"].is_null());
+  assert(server.reads(10) == 3);
+
+  // A write drops the cached value.
+  assert(WriteItem(h, "tag.set", "111") == 0);
+  assert(call(h, "cache.peek", R"({"items":["tag"]})")["items"][0]["value"].is_null());
+  assert(read_item(h, "tag") == "111" && server.reads(10) == 4);
+
+  char buf[64];
+  assert(ReadItemMaxAge(h, "tag", -1, buf, sizeof(buf)) < 0);
+  assert(CallMethod(h, "cache.peek", R"({"items":["nope"]})", buf, sizeof(buf)) < 0);
+  DestroyIoInstance(h);
+
+  // A max age also bounds values prefetched along with a neighbour: within
+  // it they are served, beyond it (and always for 0) the bus is read.
+  server.set_regs(30, {1, 1});
+  write_text("unit_value_cache_prefetch.json", R"({
+    "transport": "tcp",
+    "tcp": { "host": "127.0.0.1", "port": )" + std::to_string(server.port()) + R"(, "backend": "native", "timeout_ms": 1000 },
+    "on_demand": { "prefetch": { "max_gap": 2, "ttl_ms": 5000 } },
+    "items": [
+      { "name": "a", "unit_id": 1, "function": 3, "address": 30, "type": "uint16" },
+      { "name": "b", "unit_id": 1, "function": 3, "address": 31, "type": "uint16" }
+    ] })");
+  h = CreateIoInstance(nullptr, "unit_value_cache_prefetch.json");
+  assert(h != nullptr);
+  assert(read_item(h, "a") == "1");  // prefetches "b"
+  server.set_reg(31, 2);
+  int before = server.requests();
+  assert(read_max_age(h, "b", 5000) == "1" && server.requests() == before);
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  assert(read_max_age(h, "b", 10) == "2" && server.requests() == before + 1);
+  server.set_reg(31, 3);
+  assert(read_max_age(h, "b", 0) == "3" && server.requests() == before + 2);
+  DestroyIoInstance(h);
+
+  write_text("unit_value_cache_bad.json", R"({ "transport": "tcp",
+    "items": [ { "name": "x", "unit_id": 1, "function": 3, "address": 0, "type": "uint16", "cache_ttl_ms": -5 } ] })");
+  assert(CreateIoInstance(nullptr, "unit_value_cache_bad.json") == nullptr);
+
+  std::puts("unit_value_cache: ok");
+  return 0;
+}